@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "atlasPacker.h"
+
+#include <random>
+
+namespace ToyBench
+{
+	//只测试装箱本身，不需要GPU：随机尺寸的矩形依次插入，页满时开新页
+	static BenchResult packRects(const std::string& name,
+		const BenchOptions& options,
+		uint32_t minSize,
+		uint32_t maxSize)
+	{
+		const size_t count = options.count ? options.count : 20000;
+		const uint32_t pageSize = 2048;
+
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<uint32_t> sizeDist(minSize, maxSize);
+		std::vector<std::pair<uint32_t, uint32_t>> rects(count);
+		for (auto& rect : rects)
+		{
+			rect = { sizeDist(rng), sizeDist(rng) };
+		}
+
+		std::vector<double> samples;
+		double occupancy = 0.0;
+		size_t pages = 0;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			std::vector<ToyEngine::SkylinePacker> packers;
+			packers.emplace_back(pageSize, pageSize);
+
+			Timer timer;
+			for (const auto& [w, h] : rects)
+			{
+				//运行时插入的策略：只尝试最新的一页，放不下就开新页
+				if (!packers.back().insert(w, h))
+				{
+					packers.emplace_back(pageSize, pageSize);
+					packers.back().insert(w, h);
+				}
+			}
+			samples.push_back(timer.elapsedMs());
+
+			//最后一页通常没装满，不计入占用率
+			double sum = 0.0;
+			size_t full = packers.size() > 1 ? packers.size() - 1 : 1;
+			for (size_t i = 0; i < full; i++)
+			{
+				sum += packers[i].getOccupancy();
+			}
+			occupancy = sum / static_cast<double>(full);
+			pages = packers.size();
+		}
+
+		auto result = summarize(name, samples, static_cast<double>(count), "rects/s");
+		result.extra["occupancy_pct"] = occupancy * 100.0;
+		result.extra["pages"] = static_cast<double>(pages);
+		return result;
+	}
+
+	static std::vector<BenchResult> atlasPack(const BenchOptions& options)
+	{
+		return {
+			packRects("atlas_pack.small", options, 8, 64),
+			packRects("atlas_pack.mixed", options, 16, 256),
+		};
+	}
+
+	TOY_BENCH("atlas_pack", atlasPack);
+
+} // ToyBench
@@ -0,0 +1,274 @@
+#include "bench.h"
+#include "gpuBench.h"
+#include "logger.h"
+#include "binaryLog.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+namespace ToyBench
+{
+	std::map<std::string, BenchFunc>& benchRegistry()
+	{
+		static std::map<std::string, BenchFunc> registry;
+		return registry;
+	}
+
+	static void printResult(const BenchResult& result)
+	{
+		std::printf("%-32s %10.3f ms (min %8.3f, max %8.3f)  %14.1f %s",
+			result.name.c_str(), result.msMean, result.msMin, result.msMax, result.throughput, result.unit.c_str());
+		for (const auto& [key, value] : result.extra)
+		{
+			std::printf("  %s=%.3f", key.c_str(), value);
+		}
+		std::printf("\n");
+	}
+
+	static void printUsage()
+	{
+		std::printf("usage: toy2d_bench [--filter <name>] [--count <n>] [--iterations <n>] [--list]\n"
+					"                   [--no-gpu] [--shaders <dir>] [--validation]\n"
+					"                   [--json <file>] [--baseline <file>] [--threshold <percent>]\n"
+					"       toy2d_bench --decode-log <file>\n");
+	}
+
+	static void writeJsonString(std::ofstream& out, const std::string& text)
+	{
+		out << '"';
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out << '\\';
+			}
+			out << c;
+		}
+		out << '"';
+	}
+
+	//每个结果单独一行，--baseline按行读取，不需要完整的JSON解析
+	static bool writeJson(const std::string& path, const std::vector<BenchResult>& results)
+	{
+		std::ofstream out(path, std::ios::out | std::ios::trunc);
+		if (!out.is_open())
+		{
+			LOG_E("Failed to open bench result file {}.", path);
+			return false;
+		}
+
+#ifdef NDEBUG
+		const char* build = "release";
+#else
+		const char* build = "debug";
+#endif
+		out << std::setprecision(9);
+		out << "{\n\"host\":{\"cpuThreads\":" << std::thread::hardware_concurrency() << ",\"build\":\"" << build
+			<< "\"},\n\"device\":{";
+		bool first = true;
+		for (const auto& [key, value] : getGpuInfo())
+		{
+			out << (first ? "" : ",");
+			writeJsonString(out, key);
+			out << ":";
+			writeJsonString(out, value);
+			first = false;
+		}
+		out << "},\n\"results\":[";
+
+		first = true;
+		for (const auto& result : results)
+		{
+			out << (first ? "\n" : ",\n") << "{\"name\":";
+			writeJsonString(out, result.name);
+			out << ",\"unit\":";
+			writeJsonString(out, result.unit);
+			out << ",\"msMean\":" << result.msMean << ",\"msMin\":" << result.msMin << ",\"msMax\":" << result.msMax
+				<< ",\"throughput\":" << result.throughput << ",\"iterations\":" << result.iterations << ",\"extra\":{";
+			bool firstExtra = true;
+			for (const auto& [key, value] : result.extra)
+			{
+				out << (firstExtra ? "" : ",");
+				writeJsonString(out, key);
+				out << ":" << value;
+				firstExtra = false;
+			}
+			out << "}}";
+			first = false;
+		}
+		out << "\n]\n}\n";
+		return true;
+	}
+
+	//只读取writeJson写出的格式：每行一个结果，取name和msMean
+	static std::map<std::string, double> readBaseline(const std::string& path)
+	{
+		std::map<std::string, double> baseline;
+		std::ifstream in(path);
+		if (!in.is_open())
+		{
+			LOG_E("Failed to open baseline file {}.", path);
+			return baseline;
+		}
+
+		const std::string nameKey = "{\"name\":\"";
+		const std::string meanKey = "\"msMean\":";
+		std::string line;
+		while (std::getline(in, line))
+		{
+			size_t namePos = line.find(nameKey);
+			size_t meanPos = line.find(meanKey);
+			if (namePos == std::string::npos || meanPos == std::string::npos)
+			{
+				continue;
+			}
+
+			size_t nameBegin = namePos + nameKey.size();
+			size_t nameEnd = line.find('"', nameBegin);
+			if (nameEnd == std::string::npos)
+			{
+				continue;
+			}
+			baseline[line.substr(nameBegin, nameEnd - nameBegin)] =
+				std::strtod(line.c_str() + meanPos + meanKey.size(), nullptr);
+		}
+		return baseline;
+	}
+
+	//平均耗时比基线慢超过threshold百分比的记为回退，返回回退的数量
+	static uint32_t compareBaseline(const std::map<std::string, double>& baseline,
+		const std::vector<BenchResult>& results,
+		double thresholdPercent)
+	{
+		uint32_t regressions = 0;
+		std::printf("\n%-32s %12s %12s %9s\n", "compare", "baseline ms", "current ms", "delta");
+		for (const auto& result : results)
+		{
+			auto it = baseline.find(result.name);
+			if (it == baseline.end() || it->second <= 0.0)
+			{
+				std::printf("%-32s %12s %12.3f %9s\n", result.name.c_str(), "-", result.msMean, "new");
+				continue;
+			}
+
+			double delta = (result.msMean - it->second) / it->second * 100.0;
+			bool regressed = delta > thresholdPercent;
+			regressions += regressed ? 1 : 0;
+			std::printf("%-32s %12.3f %12.3f %+8.1f%%%s\n", result.name.c_str(), it->second, result.msMean, delta,
+				regressed ? "  REGRESSION" : "");
+		}
+		return regressions;
+	}
+} // ToyBench
+
+int main(int argc, char** argv)
+{
+	using namespace ToyBench;
+
+	BenchOptions options{};
+	std::string jsonPath;
+	std::string baselinePath;
+	double threshold = 10.0;
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+		{
+			options.filter = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--count") == 0 && hasValue)
+		{
+			options.count = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--iterations") == 0 && hasValue)
+		{
+			options.iterations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--no-gpu") == 0)
+		{
+			options.gpu = false;
+		}
+		else if (std::strcmp(argv[i], "--validation") == 0)
+		{
+			options.validation = true;
+		}
+		else if (std::strcmp(argv[i], "--shaders") == 0 && hasValue)
+		{
+			options.shaderDir = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--json") == 0 && hasValue)
+		{
+			jsonPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue)
+		{
+			baselinePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+		{
+			threshold = std::strtod(argv[++i], nullptr);
+		}
+		else if (std::strcmp(argv[i], "--decode-log") == 0 && hasValue)
+		{
+			//把TOY2D_BINARY_LOG写出的二进制日志还原成文本，输出到stdout
+			Log::Init();
+			bool decoded = BinaryLog::Decode(argv[++i], std::cout);
+			Log::End();
+			return decoded ? 0 : 1;
+		}
+		else if (std::strcmp(argv[i], "--list") == 0)
+		{
+			for (const auto& [name, func] : benchRegistry())
+			{
+				std::printf("%s\n", name.c_str());
+			}
+			return 0;
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	Log::Init();
+
+	std::vector<BenchResult> results;
+	for (const auto& [name, func] : benchRegistry())
+	{
+		if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		for (const auto& result : func(options))
+		{
+			printResult(result);
+			results.push_back(result);
+		}
+	}
+
+	if (!jsonPath.empty())
+	{
+		writeJson(jsonPath, results);
+	}
+
+	//有回退时返回2，方便CI直接判断
+	int exitCode = 0;
+	if (!baselinePath.empty())
+	{
+		auto baseline = readBaseline(baselinePath);
+		if (compareBaseline(baseline, results, threshold) > 0)
+		{
+			exitCode = 2;
+		}
+	}
+
+	releaseGpu();
+	Log::End();
+	return exitCode;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ToyBench
+{
+	struct BenchOptions
+	{
+		std::string filter;		//只运行名字包含filter的场景
+		uint64_t count{ 0 };	//0表示使用场景自己的默认规模
+		uint32_t iterations{ 10 };
+		bool gpu{ true };				//false时跳过所有需要Vulkan设备的场景
+		std::string shaderDir{ ".." };	//sprite_vs.spv/sprite_fs.spv所在目录，与sandbox相同
+		bool validation{ false };		//GPU场景开启验证层，与不开启的结果对比得到验证层的开销
+	};
+
+	struct BenchResult
+	{
+		std::string name;
+		std::string unit;			//throughput的单位
+		double throughput{ 0.0 };
+		double msMean{ 0.0 };
+		double msMin{ 0.0 };
+		double msMax{ 0.0 };
+		uint32_t iterations{ 0 };
+		std::map<std::string, double> extra;
+	};
+
+	using BenchFunc = std::function<std::vector<BenchResult>(const BenchOptions&)>;
+
+	std::map<std::string, BenchFunc>& benchRegistry();
+
+	struct BenchRegistrar
+	{
+		BenchRegistrar(const std::string& name, BenchFunc func)
+		{
+			benchRegistry()[name] = std::move(func);
+		}
+	};
+
+#define TOY_BENCH(name, func) static ToyBench::BenchRegistrar s_benchRegistrar_##func{ name, func }
+
+	class Timer
+	{
+	 public:
+		Timer()
+			: m_start(std::chrono::steady_clock::now())
+		{
+		}
+
+		[[nodiscard]] double elapsedMs() const
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+		}
+
+	 private:
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+	//把每次迭代的耗时汇总成结果，workPerIteration用于计算吞吐量(每秒)
+	inline BenchResult summarize(const std::string& name,
+		const std::vector<double>& samplesMs,
+		double workPerIteration,
+		const std::string& unit)
+	{
+		BenchResult result;
+		result.name = name;
+		result.unit = unit;
+		result.iterations = static_cast<uint32_t>(samplesMs.size());
+		if (samplesMs.empty())
+		{
+			return result;
+		}
+
+		double sum = 0.0;
+		result.msMin = samplesMs.front();
+		result.msMax = samplesMs.front();
+		for (double ms : samplesMs)
+		{
+			sum += ms;
+			result.msMin = std::min(result.msMin, ms);
+			result.msMax = std::max(result.msMax, ms);
+		}
+		result.msMean = sum / static_cast<double>(samplesMs.size());
+		result.throughput = result.msMean > 0.0 ? workPerIteration / (result.msMean / 1000.0) : 0.0;
+		return result;
+	}
+
+} // ToyBench
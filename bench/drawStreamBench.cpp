@@ -0,0 +1,98 @@
+#include "bench.h"
+#include "drawStream.h"
+#include "jobSystem.h"
+#include "quadIndexBuffer.h"
+
+#include <random>
+
+namespace ToyBench
+{
+	using namespace ToyEngine;
+
+	//pass | 半透明 | pipeline | material，相邻两条命令在这些位上不同就需要切换状态
+	static uint32_t stateChanges(const std::vector<uint64_t>& keys)
+	{
+		uint32_t changes = 0;
+		for (size_t i = 1; i < keys.size(); i++)
+		{
+			changes += (keys[i] >> 36) != (keys[i - 1] >> 36) ? 1 : 0;
+		}
+		return changes;
+	}
+
+	//随机顺序、多线程提交，然后排序；对比提交顺序与排序后的状态切换次数
+	static std::vector<BenchResult> drawStreamSort(const BenchOptions& options)
+	{
+		const auto count = static_cast<uint32_t>(options.count ? options.count : 100000);
+		const uint32_t pipelineCount = 8;
+		const uint32_t materialCount = 64;
+
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<uint32_t> pipeline(0, pipelineCount - 1);
+		std::uniform_int_distribution<uint32_t> material(0, materialCount - 1);
+		std::uniform_int_distribution<uint32_t> texture(0, 1023);
+		std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+		std::vector<uint64_t> keys(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t pass = i % 3;
+			if (i % 4 == 0)
+			{
+				keys[i] = DrawKey::transparent(pass, pipeline(rng), material(rng), depth(rng), texture(rng));
+			}
+			else
+			{
+				keys[i] = DrawKey::opaque(pass, pipeline(rng), material(rng), depth(rng), texture(rng));
+			}
+		}
+
+		glm::mat4 pushConstants(1.0f);
+		DrawStream stream(count, count * static_cast<uint32_t>(sizeof(pushConstants)));
+		auto& jobSystem = JobSystem::getInstance();
+
+		std::vector<double> submitSamples;
+		std::vector<double> sortSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			stream.reset();
+
+			Timer submit;
+			jobSystem.parallelFor(0, count, 1024, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++)
+				{
+					//与SpriteRenderer::submit的命令相同；这里只测提交和排序，不会execute，不需要真实的index buffer
+					DrawCommand command{};
+					command.indexType = VK_INDEX_TYPE_UINT16;
+					command.pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT;
+					command.vertexCount = QuadIndexBuffer::INDICES_PER_QUAD;
+					command.firstInstance = i;
+					stream.submit(keys[i], command, pushConstants);
+				}
+			});
+			submitSamples.push_back(submit.elapsedMs());
+
+			Timer sort;
+			stream.sort();
+			sortSamples.push_back(sort.elapsedMs());
+		}
+
+		//多线程提交后槽位的顺序不确定，用keys的原始顺序作为未排序的参照
+		std::vector<uint64_t> sorted(stream.size());
+		for (size_t i = 0; i < sorted.size(); i++)
+		{
+			sorted[i] = stream.getSortedKey(i);
+		}
+
+		auto submitResult = summarize("draw_stream.submit", submitSamples, static_cast<double>(count), "cmds/s");
+		submitResult.extra["workers"] = jobSystem.getWorkerCount();
+		submitResult.extra["dropped"] = stream.getStats().dropped;
+		auto sortResult = summarize("draw_stream.sort", sortSamples, static_cast<double>(count), "cmds/s");
+		sortResult.extra["stateChangesUnsorted"] = stateChanges(keys);
+		sortResult.extra["stateChangesSorted"] = stateChanges(sorted);
+		return { submitResult, sortResult };
+	}
+
+	TOY_BENCH("draw_stream", drawStreamSort);
+
+} // ToyBench
@@ -0,0 +1,330 @@
+#include "gpuBench.h"
+#include "logger.h"
+#include "buffer.h"
+#include "image.h"
+#include "fence.h"
+#include "shader.h"
+#include "spriteBatch.h"
+
+namespace ToyBench
+{
+	using namespace ToyEngine;
+
+	static bool s_gpuTried = false;
+	static bool s_gpuReady = false;
+
+	bool requireGpu(const BenchOptions& options)
+	{
+		if (!options.gpu)
+		{
+			return false;
+		}
+
+		if (!s_gpuTried)
+		{
+			s_gpuTried = true;
+			try
+			{
+				ValidationConfig validation{};
+				validation.validation = options.validation;
+				Context::Init(validation, nullptr);
+				s_gpuReady = true;
+			}
+			catch (const std::exception& e)
+			{
+				LOG_W("No usable Vulkan device, GPU scenarios are skipped: {}", e.what());
+			}
+		}
+
+		return s_gpuReady;
+	}
+
+	void releaseGpu()
+	{
+		if (s_gpuReady)
+		{
+			vkDeviceWaitIdle(vkContext.vk_device);
+			Context::Quit();
+			s_gpuReady = false;
+		}
+	}
+
+	static const char* deviceTypeName(VkPhysicalDeviceType type)
+	{
+		switch (type)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+			return "discrete";
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+			return "integrated";
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+			return "virtual";
+		case VK_PHYSICAL_DEVICE_TYPE_CPU:
+			return "cpu";
+		default:
+			return "other";
+		}
+	}
+
+	std::vector<std::pair<std::string, std::string>> getGpuInfo()
+	{
+		if (!s_gpuReady)
+		{
+			return {};
+		}
+
+		const auto& properties = vkContext.vk_physicalDeviceProperties;
+		const auto& properties12 = vkContext.vk_vulkan12Properties;
+		char vendor[16];
+		std::snprintf(vendor, sizeof(vendor), "0x%04x", properties.vendorID);
+		char device[16];
+		std::snprintf(device, sizeof(device), "0x%04x", properties.deviceID);
+
+		//driverVersion的编码由厂商决定，原样输出
+		return {
+			{ "name", properties.deviceName },
+			{ "type", deviceTypeName(properties.deviceType) },
+			{ "vendorID", vendor },
+			{ "deviceID", device },
+			{ "apiVersion", std::to_string(VK_API_VERSION_MAJOR(properties.apiVersion)) + "."
+				+ std::to_string(VK_API_VERSION_MINOR(properties.apiVersion)) + "."
+				+ std::to_string(VK_API_VERSION_PATCH(properties.apiVersion)) },
+			{ "driverVersion", std::to_string(properties.driverVersion) },
+			{ "driverName", properties12.driverName },
+			{ "driverInfo", properties12.driverInfo },
+			{ "validation", vkContext.getValidationConfig().validation ? "on" : "off" },
+		};
+	}
+
+	double submitAndWait(const CommandPoolPtr& commandPool, const std::function<void(const CommandBufferPtr&)>& record)
+	{
+		auto commandBuffer = CommandBuffer::create(vkContext.vk_device, commandPool);
+		commandBuffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		record(commandBuffer);
+		commandBuffer->end();
+
+		auto fence = Fence::create(vkContext.vk_device, false);
+		VkCommandBuffer handle = commandBuffer->getCommandBuffer();
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &handle;
+
+		Timer timer;
+		if (vkQueueSubmit(vkContext.vk_graphicsQueue, 1, &submitInfo, fence->getFence()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit bench command buffer.");
+		}
+		fence->block();
+		return timer.elapsedMs();
+	}
+
+	bool hasSpriteShaders(const BenchOptions& options)
+	{
+		for (const char* name : { "/sprite_vs.spv", "/sprite_fs.spv" })
+		{
+			std::ifstream file(options.shaderDir + name, std::ios::binary);
+			if (!file)
+			{
+				LOG_W("{}{} not found, use --shaders to point at the compiled shaders.", options.shaderDir, name);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	PipelinePtr createSpritePipeline(const BenchOptions& options,
+		const BindlessHeapPtr& bindlessHeap,
+		VkFormat colorFormat,
+		VkFormat depthFormat,
+		uint32_t width,
+		uint32_t height)
+	{
+		auto pipeline = Pipeline::create(vkContext.vk_device, nullptr);
+		pipeline->setRenderingFormats({ colorFormat }, depthFormat);
+
+		VkViewport viewport{ 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f };
+		pipeline->setViewport({ viewport });
+		pipeline->setScissors({ VkRect2D{ { 0, 0 }, { width, height } } });
+
+		pipeline->setShaderGroup({
+			Shader::create(vkContext.vk_device, options.shaderDir + "/sprite_vs.spv", "main", VK_SHADER_STAGE_VERTEX_BIT),
+			Shader::create(vkContext.vk_device, options.shaderDir + "/sprite_fs.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT),
+		});
+		pipeline->setVertexInput(SpriteRenderer::getBindingDescription(), SpriteRenderer::getAttributeDescription());
+
+		pipeline->m_inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		pipeline->m_inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		pipeline->m_rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		pipeline->m_rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		pipeline->m_rasterizer.lineWidth = 1.0f;
+		pipeline->m_rasterizer.cullMode = VK_CULL_MODE_NONE;
+		pipeline->m_rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+		pipeline->setSampleCount(VK_SAMPLE_COUNT_1_BIT);
+		pipeline->m_multisampling.minSampleShading = 1.0f;
+		pipeline->setDepthTest(true, true, VK_COMPARE_OP_LESS);
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		colorBlendAttachment.colorWriteMask =
+			VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.blendEnable = VK_FALSE;
+		pipeline->pushBlendAttachment(colorBlendAttachment);
+		pipeline->m_colorBlending.logicOpEnable = VK_FALSE;
+
+		pipeline->m_layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline->setDescriptorSetLayouts({ bindlessHeap->getDescriptorSetLayout() });
+		pipeline->addPushConstant<SpritePushConstants>(VK_SHADER_STAGE_VERTEX_BIT);
+		return pipeline;
+	}
+
+	static std::vector<VkDeviceSize> transferSizes(const BenchOptions& options)
+	{
+		if (options.count != 0)
+		{
+			return { options.count };
+		}
+		return { 64ull * 1024, 1024ull * 1024, 16ull * 1024 * 1024, 64ull * 1024 * 1024 };
+	}
+
+	static std::string sizeLabel(VkDeviceSize size)
+	{
+		if (size >= 1024 * 1024 && size % (1024 * 1024) == 0)
+		{
+			return std::to_string(size / (1024 * 1024)) + "MB";
+		}
+		if (size >= 1024 && size % 1024 == 0)
+		{
+			return std::to_string(size / 1024) + "KB";
+		}
+		return std::to_string(size) + "B";
+	}
+
+	//读回优先使用HOST_CACHED内存，从uncached内存读取会慢一个数量级
+	static BufferPtr createReadbackBuffer(VkDeviceSize size)
+	{
+		const VkMemoryPropertyFlags coherent = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		uint32_t typeIndex = 0;
+		bool cached = tryFindMemoryTypeIndex(vkContext.vk_physicalDevice, UINT32_MAX,
+			coherent | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, typeIndex);
+
+		auto buffer = Buffer::create(vkContext.vk_device, vkContext.vk_physicalDevice, size,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT, cached ? coherent | VK_MEMORY_PROPERTY_HOST_CACHED_BIT : coherent);
+		buffer->map();
+		return buffer;
+	}
+
+	//staging写入 + 拷贝到设备本地buffer，计时包含memcpy和GPU拷贝
+	static std::vector<BenchResult> gpuUpload(const BenchOptions& options)
+	{
+		if (!requireGpu(options))
+		{
+			return {};
+		}
+
+		auto commandPool = CommandPool::create(vkContext.vk_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+		std::vector<BenchResult> results;
+		for (VkDeviceSize size : transferSizes(options))
+		{
+			auto staging = Buffer::create(vkContext.vk_device, vkContext.vk_physicalDevice, size,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			staging->map();
+			auto target = Buffer::create(vkContext.vk_device, vkContext.vk_physicalDevice, size,
+				VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			std::vector<uint8_t> source(size, 0x5A);
+
+			std::vector<double> samples;
+			double gpuMs = 0.0;
+			for (uint32_t it = 0; it < options.iterations; it++)
+			{
+				Timer timer;
+				std::memcpy(staging->getMappedData(), source.data(), size);
+				gpuMs += submitAndWait(commandPool, [&](const CommandBufferPtr& commandBuffer) {
+					VkBufferCopy region{ 0, 0, size };
+					commandBuffer->copyBuffer(staging->getBuffer(), target->getBuffer(), 1, { region });
+				});
+				samples.push_back(timer.elapsedMs());
+			}
+
+			auto result = summarize("gpu_upload." + sizeLabel(size), samples, static_cast<double>(size) / 1.0e6, "MB/s");
+			result.extra["submitMs"] = gpuMs / std::max(options.iterations, 1u);
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	//设备本地buffer/图像拷贝到主机可见buffer并复制出来，计时包含等待和memcpy
+	static std::vector<BenchResult> gpuReadback(const BenchOptions& options)
+	{
+		if (!requireGpu(options))
+		{
+			return {};
+		}
+
+		auto commandPool = CommandPool::create(vkContext.vk_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+		std::vector<BenchResult> results;
+		for (VkDeviceSize size : transferSizes(options))
+		{
+			auto source = Buffer::create(vkContext.vk_device, vkContext.vk_physicalDevice, size,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			auto readback = createReadbackBuffer(size);
+			std::vector<uint8_t> destination(size);
+
+			std::vector<double> samples;
+			for (uint32_t it = 0; it < options.iterations; it++)
+			{
+				Timer timer;
+				submitAndWait(commandPool, [&](const CommandBufferPtr& commandBuffer) {
+					VkBufferCopy region{ 0, 0, size };
+					commandBuffer->copyBuffer(source->getBuffer(), readback->getBuffer(), 1, { region });
+				});
+				std::memcpy(destination.data(), readback->getMappedData(), size);
+				samples.push_back(timer.elapsedMs());
+			}
+
+			results.push_back(summarize("gpu_readback." + sizeLabel(size), samples, static_cast<double>(size) / 1.0e6,
+				"MB/s"));
+		}
+
+		//一帧1080p的颜色附件，截图/测试比对的典型用法
+		ImageDesc desc{};
+		desc.width = 1920;
+		desc.height = 1080;
+		desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+		desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		desc.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		auto image = Image::create(vkContext.vk_device, vkContext.vk_physicalDevice, desc);
+		const VkDeviceSize imageSize = static_cast<VkDeviceSize>(desc.width) * desc.height * 4;
+		auto readback = createReadbackBuffer(imageSize);
+		std::vector<uint8_t> pixels(imageSize);
+
+		submitAndWait(commandPool, [&](const CommandBufferPtr& commandBuffer) {
+			commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+				{ image->transition(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0, VK_ACCESS_TRANSFER_READ_BIT) });
+		});
+
+		std::vector<double> samples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			submitAndWait(commandPool, [&](const CommandBufferPtr& commandBuffer) {
+				VkBufferImageCopy region{};
+				region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				region.imageExtent = { desc.width, desc.height, 1 };
+				commandBuffer->copyImageToBuffer(image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					readback->getBuffer(), { region });
+			});
+			std::memcpy(pixels.data(), readback->getMappedData(), imageSize);
+			samples.push_back(timer.elapsedMs());
+		}
+		results.push_back(summarize("gpu_readback.image1080p", samples, 1.0, "frames/s"));
+
+		return results;
+	}
+
+	TOY_BENCH("gpu_upload", gpuUpload);
+	TOY_BENCH("gpu_readback", gpuReadback);
+
+} // ToyBench
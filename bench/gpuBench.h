@@ -0,0 +1,38 @@
+#pragma once
+
+#include "bench.h"
+#include "context.h"
+#include "commandpool.h"
+#include "commandBuffer.h"
+#include "pipeline.h"
+#include "bindlessHeap.h"
+
+#include <utility>
+
+namespace ToyBench
+{
+	//第一次调用时创建无窗口的Context(只有指定--validation时开启验证层)，创建失败或指定了--no-gpu时返回false，GPU场景直接跳过
+	bool requireGpu(const BenchOptions& options);
+
+	//退出前调用，所有GPU对象必须已经释放
+	void releaseGpu();
+
+	//设备与驱动信息，写入JSON结果；没有创建Context时为空
+	std::vector<std::pair<std::string, std::string>> getGpuInfo();
+
+	//录制一次性命令，提交并等待完成，返回从提交到完成的毫秒数
+	double submitAndWait(const ToyEngine::CommandPoolPtr& commandPool,
+		const std::function<void(const ToyEngine::CommandBufferPtr&)>& record);
+
+	//shaderDir下存在sprite的spv时返回true，否则输出警告
+	bool hasSpriteShaders(const BenchOptions& options);
+
+	//与Application中不透明精灵管线相同的状态，走动态渲染，返回时还没有build
+	ToyEngine::PipelinePtr createSpritePipeline(const BenchOptions& options,
+		const ToyEngine::BindlessHeapPtr& bindlessHeap,
+		VkFormat colorFormat,
+		VkFormat depthFormat,
+		uint32_t width,
+		uint32_t height);
+
+} // ToyBench
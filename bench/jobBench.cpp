@@ -0,0 +1,106 @@
+#include "bench.h"
+#include "jobSystem.h"
+
+#include <cmath>
+#include <thread>
+
+namespace ToyBench
+{
+	using namespace ToyEngine;
+
+	//1, 2, 4...直到CPU线程数，线程数包含参与执行的当前线程
+	static std::vector<uint32_t> threadCounts()
+	{
+		uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		std::vector<uint32_t> counts;
+		for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+		{
+			counts.push_back(threads);
+		}
+		counts.push_back(maxThreads);
+		return counts;
+	}
+
+	//纯计算的parallelFor，与剔除、变换等每帧任务的形态相同
+	static std::vector<BenchResult> jobScaling(const BenchOptions& options)
+	{
+		const uint32_t count = options.count ? static_cast<uint32_t>(options.count) : (1u << 22);
+		const uint32_t grainSize = 4096;
+
+		std::vector<float> input(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			input[i] = static_cast<float>(i % 1000) * 0.01f;
+		}
+		std::vector<float> output(count);
+
+		std::vector<BenchResult> results;
+		double baseMs = 0.0;
+		for (uint32_t threads : threadCounts())
+		{
+			JobSystem jobSystem(threads - 1);
+
+			std::vector<double> samples;
+			for (uint32_t it = 0; it < options.iterations; it++)
+			{
+				Timer timer;
+				jobSystem.parallelFor(0, count, grainSize, [&](uint32_t begin, uint32_t end) {
+					for (uint32_t i = begin; i < end; i++)
+					{
+						float x = input[i];
+						output[i] = std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+					}
+				});
+				samples.push_back(timer.elapsedMs());
+			}
+
+			auto result = summarize("job_parallel_for.threads" + std::to_string(threads), samples,
+				static_cast<double>(count), "items/s");
+			baseMs = threads == 1 ? result.msMean : baseMs;
+			result.extra["threads"] = threads;
+			result.extra["speedup"] = result.msMean > 0.0 ? baseMs / result.msMean : 0.0;
+			result.extra["efficiency_pct"] = result.extra["speedup"] / threads * 100.0;
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	//空任务的吞吐量：从当前线程提交(走公共队列)，以及在任务中提交(走工作线程自己的队列)
+	static std::vector<BenchResult> jobOverhead(const BenchOptions& options)
+	{
+		const uint32_t count = options.count ? static_cast<uint32_t>(options.count) : 100000;
+		JobSystem jobSystem(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
+		std::vector<double> externalSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			JobCounter counter;
+			Timer timer;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				jobSystem.submit([]() {}, &counter);
+			}
+			jobSystem.wait(counter);
+			externalSamples.push_back(timer.elapsedMs());
+		}
+
+		//grainSize为1时每个元素都经过一次二分提交
+		std::vector<double> nestedSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			jobSystem.parallelFor(0, count, 1, [](uint32_t, uint32_t) {});
+			nestedSamples.push_back(timer.elapsedMs());
+		}
+
+		auto external = summarize("job_submit.external", externalSamples, static_cast<double>(count), "jobs/s");
+		auto nested = summarize("job_submit.parallel_for", nestedSamples, static_cast<double>(count), "jobs/s");
+		external.extra["workers"] = jobSystem.getWorkerCount();
+		nested.extra["workers"] = jobSystem.getWorkerCount();
+		return { external, nested };
+	}
+
+	TOY_BENCH("job_parallel_for", jobScaling);
+	TOY_BENCH("job_submit", jobOverhead);
+
+} // ToyBench
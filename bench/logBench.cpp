@@ -0,0 +1,99 @@
+#include "bench.h"
+#include "binaryLog.h"
+
+#include <filesystem>
+#include <sstream>
+
+namespace ToyBench
+{
+	//与验证层回调的消息长度相近
+	static const std::string s_message(200, 'v');
+
+	//调用线程上的开销：文本日志需要先格式化，二进制日志只拷贝参数
+	static BenchResult formatText(const BenchOptions& options)
+	{
+		const size_t count = options.count ? options.count : 100000;
+
+		std::vector<double> samples;
+		size_t bytes = 0;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			fmt::memory_buffer buffer;
+			Timer timer;
+			for (size_t i = 0; i < count; i++)
+			{
+				buffer.clear();
+				fmt::format_to(std::back_inserter(buffer), "Validation layer: {} frame {} {:.3f} ms", s_message, i,
+					static_cast<double>(i) * 0.5);
+			}
+			samples.push_back(timer.elapsedMs());
+			bytes = buffer.size();
+		}
+
+		auto result = summarize("log.format", samples, static_cast<double>(count), "msgs/s");
+		result.extra["bytes"] = static_cast<double>(bytes);
+		return result;
+	}
+
+	//写入二进制文件，每CHUNK条在计时之外Flush一次，避免环形缓冲写满后只测到丢弃的开销
+	static BenchResult writeBinary(const BenchOptions& options)
+	{
+		const size_t count = options.count ? options.count : 100000;
+		const size_t CHUNK = 1000;
+
+		if (BinaryLog::IsRunning())
+		{
+			return {};
+		}
+		auto path = (std::filesystem::temp_directory_path() / "toy2d_bench.blog").string();
+		BinaryLog::Init(path.c_str());
+
+		std::vector<double> samples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			double ms = 0.0;
+			for (size_t begin = 0; begin < count; begin += CHUNK)
+			{
+				size_t end = std::min(begin + CHUNK, count);
+				Timer timer;
+				for (size_t i = begin; i < end; i++)
+				{
+					LOG_BIN(I, "Validation layer: {} frame {} {:.3f} ms", s_message, i, static_cast<double>(i) * 0.5);
+				}
+				ms += timer.elapsedMs();
+				BinaryLog::Flush();
+			}
+			samples.push_back(ms);
+		}
+		auto dropped = BinaryLog::GetDroppedCount();
+		BinaryLog::End();
+
+		//顺便确认文件能完整解码
+		std::ostringstream decoded;
+		BinaryLog::Decode(path, decoded);
+		auto text = decoded.str();
+		auto lines = std::count(text.begin(), text.end(), '\n');
+		auto fileBytes = std::filesystem::file_size(path);
+		std::filesystem::remove(path);
+
+		auto result = summarize("log.binary", samples, static_cast<double>(count), "msgs/s");
+		result.extra["dropped"] = static_cast<double>(dropped);
+		result.extra["decodedLines"] = static_cast<double>(lines);
+		result.extra["fileBytes"] = static_cast<double>(fileBytes);
+		return result;
+	}
+
+	static std::vector<BenchResult> logBench(const BenchOptions& options)
+	{
+		std::vector<BenchResult> results{ formatText(options) };
+		auto binary = writeBinary(options);
+		if (!binary.name.empty())
+		{
+			results.push_back(binary);
+		}
+		return results;
+	}
+
+	TOY_BENCH("log", logBench);
+
+} // ToyBench
@@ -0,0 +1,444 @@
+#include "gpuBench.h"
+#include "logger.h"
+#include "image.h"
+#include "imageUploader.h"
+#include "samplerCache.h"
+#include "spriteBatch.h"
+#include "jobSystem.h"
+#include "frameAllocator.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <random>
+
+namespace ToyBench
+{
+	using namespace ToyEngine;
+
+	static const uint32_t TARGET_WIDTH = 1920;
+	static const uint32_t TARGET_HEIGHT = 1080;
+	static const VkFormat TARGET_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+	//渲染相关的场景都走动态渲染，不需要为离屏目标额外维护renderpass
+	static bool requireRendering(const BenchOptions& options)
+	{
+		if (!requireGpu(options))
+		{
+			return false;
+		}
+
+		if (!vkContext.vk_dynamicRenderingSupported || !vkContext.vk_descriptorIndexingSupported)
+		{
+			LOG_W("Dynamic rendering or descriptor indexing is not supported, rendering scenarios are skipped.");
+			return false;
+		}
+
+		return hasSpriteShaders(options);
+	}
+
+	/**
+	 * 同一个管线重复build：
+	 * 	cold - 每次使用新的空VkPipelineCache
+	 * 	warm - 使用已经包含这个管线的VkPipelineCache
+	 * 驱动自身的磁盘缓存(例如Mesa的shader cache)不受VkPipelineCache控制，测冷启动时应通过环境变量关闭
+	 */
+	static std::vector<BenchResult> gpuPipelineBuild(const BenchOptions& options)
+	{
+		if (!requireRendering(options))
+		{
+			return {};
+		}
+
+		const uint32_t count = options.count ? static_cast<uint32_t>(options.count) : 32;
+		auto bindlessHeap = BindlessHeap::create(vkContext.vk_device, 1);
+		auto pipeline = createSpritePipeline(options, bindlessHeap, TARGET_FORMAT,
+			findDepthFormat(vkContext.vk_physicalDevice), TARGET_WIDTH, TARGET_HEIGHT);
+
+		VkPipelineCacheCreateInfo cacheInfo{};
+		cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+		std::vector<double> coldSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				VkPipelineCache cache = VK_NULL_HANDLE;
+				vkCreatePipelineCache(vkContext.vk_device, &cacheInfo, nullptr, &cache);
+				pipeline->buildPipeline(cache);
+				vkDestroyPipelineCache(vkContext.vk_device, cache, nullptr);
+			}
+			coldSamples.push_back(timer.elapsedMs());
+		}
+
+		VkPipelineCache warmCache = VK_NULL_HANDLE;
+		vkCreatePipelineCache(vkContext.vk_device, &cacheInfo, nullptr, &warmCache);
+		pipeline->buildPipeline(warmCache);
+
+		std::vector<double> warmSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				pipeline->buildPipeline(warmCache);
+			}
+			warmSamples.push_back(timer.elapsedMs());
+		}
+
+		size_t cacheBytes = 0;
+		vkGetPipelineCacheData(vkContext.vk_device, warmCache, &cacheBytes, nullptr);
+		vkDestroyPipelineCache(vkContext.vk_device, warmCache, nullptr);
+		pipeline.reset();
+
+		auto cold = summarize("gpu_pipeline_build.cold", coldSamples, count, "pipelines/s");
+		auto warm = summarize("gpu_pipeline_build.warm", warmSamples, count, "pipelines/s");
+		warm.extra["cacheBytes"] = static_cast<double>(cacheBytes);
+		return { cold, warm };
+	}
+
+	//每个draw都换push constant，管线、set和index buffer在第一次之后被CommandBuffer过滤
+	//draw与SpriteRenderer相同：共用index buffer的一个四边形，按实例取数据
+	static void recordDraws(const CommandBufferPtr& commandBuffer,
+		const PipelinePtr& pipeline,
+		VkDescriptorSet descriptorSet,
+		const QuadIndexBufferPtr& quadIndexBuffer,
+		uint32_t firstDraw,
+		uint32_t drawCount)
+	{
+		SpritePushConstants pushConstants{};
+		for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++)
+		{
+			pushConstants.viewProjection[3][0] = static_cast<float>(i);
+			commandBuffer->bindGraphicPipeline(pipeline->getPipeline());
+			commandBuffer->bindDescriptorSet(pipeline->getPipelineLayout(), 0, descriptorSet);
+			commandBuffer->pushConstants(pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, pushConstants);
+			quadIndexBuffer->bind(commandBuffer);
+			commandBuffer->drawIndexed(QuadIndexBuffer::INDICES_PER_QUAD, 1, 0, 0, i);
+		}
+	}
+
+	/**
+	 * 录制N个draw到secondary命令缓冲，只计录制时间，不提交
+	 * 单线程录到一个缓冲；多线程时每个线程有自己的command pool，各录N/T个
+	 */
+	static std::vector<BenchResult> gpuRecord(const BenchOptions& options)
+	{
+		if (!requireRendering(options))
+		{
+			return {};
+		}
+
+		const uint32_t drawCount = options.count ? static_cast<uint32_t>(options.count) : 100000;
+		//任务系统的工作线程加上参与执行的当前线程
+		const uint32_t threadCount = std::clamp(JobSystem::getInstance().getWorkerCount() + 1, 2u, 8u);
+		const VkFormat depthFormat = findDepthFormat(vkContext.vk_physicalDevice);
+
+		auto bindlessHeap = BindlessHeap::create(vkContext.vk_device, 1);
+		auto pipeline = createSpritePipeline(options, bindlessHeap, TARGET_FORMAT, depthFormat,
+			TARGET_WIDTH, TARGET_HEIGHT);
+		pipeline->buildPipeline();
+		auto quadIndexBuffer = QuadIndexBuffer::create(vkContext.vk_device, vkContext.vk_physicalDevice, 1);
+
+		std::vector<CommandPoolPtr> commandPools(threadCount);
+		std::vector<CommandBufferPtr> commandBuffers(threadCount);
+		for (uint32_t t = 0; t < threadCount; t++)
+		{
+			commandPools[t] = CommandPool::create(vkContext.vk_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+			commandBuffers[t] = CommandBuffer::create(vkContext.vk_device, commandPools[t], true);
+		}
+
+		//secondary在动态渲染内执行，需要声明继承的附件格式
+		VkCommandBufferInheritanceRenderingInfoKHR renderingInheritance{};
+		renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+		renderingInheritance.colorAttachmentCount = 1;
+		renderingInheritance.pColorAttachmentFormats = &TARGET_FORMAT;
+		renderingInheritance.depthAttachmentFormat = depthFormat;
+		renderingInheritance.stencilAttachmentFormat =
+			(getFormatAspect(depthFormat) & VK_IMAGE_ASPECT_STENCIL_BIT) ? depthFormat : VK_FORMAT_UNDEFINED;
+		renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.pNext = &renderingInheritance;
+
+		const VkCommandBufferUsageFlags flags =
+			VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		const VkDescriptorSet descriptorSet = bindlessHeap->getDescriptorSet();
+
+		std::vector<double> singleSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			commandBuffers[0]->begin(flags, inheritance);
+			recordDraws(commandBuffers[0], pipeline, descriptorSet, quadIndexBuffer, 0, drawCount);
+			commandBuffers[0]->end();
+			singleSamples.push_back(timer.elapsedMs());
+		}
+
+		//每个分段一个任务，由任务系统分发，计时包含分发和等待
+		std::vector<double> multiSamples;
+		const uint32_t drawsPerThread = (drawCount + threadCount - 1) / threadCount;
+		auto& jobSystem = JobSystem::getInstance();
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			jobSystem.parallelFor(0, threadCount, 1, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t t = begin; t < end; t++)
+				{
+					uint32_t first = t * drawsPerThread;
+					uint32_t count = first < drawCount ? std::min(drawsPerThread, drawCount - first) : 0;
+					commandBuffers[t]->begin(flags, inheritance);
+					recordDraws(commandBuffers[t], pipeline, descriptorSet, quadIndexBuffer, first, count);
+					commandBuffers[t]->end();
+				}
+			});
+			multiSamples.push_back(timer.elapsedMs());
+		}
+
+		//最后一次单线程录制的计数，begin时清零
+		const auto stats = commandBuffers[0]->getStats();
+		commandBuffers.clear();
+		commandPools.clear();
+
+		auto single = summarize("gpu_record.single", singleSamples, drawCount, "draws/s");
+		single.extra["pushConstantUpdates"] = stats.pushConstantUpdates;
+		single.extra["elidedCalls"] = stats.elidedCalls;
+		auto multi = summarize("gpu_record.threads" + std::to_string(threadCount), multiSamples, drawCount, "draws/s");
+		multi.extra["threads"] = threadCount;
+		multi.extra["speedup"] = multi.msMean > 0.0 ? single.msMean / multi.msMean : 0.0;
+		return { single, multi };
+	}
+
+	/**
+	 * 每个draw一个mat4，对比两条per-draw数据路径的录制开销，只计录制时间，不提交：
+	 * 	push - 写进push constant
+	 * 	uniform - 由FrameUniformAllocator分配，重新绑定set时换dynamic offset
+	 */
+	static std::vector<BenchResult> gpuPerDrawData(const BenchOptions& options)
+	{
+		if (!requireGpu(options))
+		{
+			return {};
+		}
+
+		const uint32_t drawCount = options.count ? static_cast<uint32_t>(options.count) : 100000;
+		const VkDeviceSize alignment =
+			std::max<VkDeviceSize>(vkContext.vk_physicalDeviceProperties.limits.minUniformBufferOffsetAlignment, 16);
+		const VkDeviceSize stride = (sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+		auto allocator = FrameUniformAllocator::create(vkContext.vk_device, vkContext.vk_physicalDevice,
+			stride * drawCount, 1, static_cast<uint32_t>(sizeof(glm::mat4)));
+
+		//不绑定管线时也可以绑定set和push constant，只需要一个兼容的layout
+		VkDescriptorSetLayout setLayout = allocator->getDescriptorSetLayout();
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = static_cast<uint32_t>(sizeof(glm::mat4));
+
+		VkPipelineLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &setLayout;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		if (vkCreatePipelineLayout(vkContext.vk_device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+		{
+			LOG_E("Failed to create pipeline layout, per draw data scenario is skipped.");
+			return {};
+		}
+
+		auto commandPool = CommandPool::create(vkContext.vk_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+		auto commandBuffer = CommandBuffer::create(vkContext.vk_device, commandPool);
+		glm::mat4 model(1.0f);
+
+		std::vector<double> pushSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			commandBuffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+			for (uint32_t i = 0; i < drawCount; i++)
+			{
+				model[3][0] = static_cast<float>(i);
+				commandBuffer->pushConstants(layout, VK_SHADER_STAGE_VERTEX_BIT, model);
+			}
+			commandBuffer->end();
+			pushSamples.push_back(timer.elapsedMs());
+		}
+		const auto pushStats = commandBuffer->getStats();
+
+		std::vector<double> uniformSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			allocator->beginFrame(it);
+			commandBuffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+			for (uint32_t i = 0; i < drawCount; i++)
+			{
+				model[3][0] = static_cast<float>(i);
+				commandBuffer->bindDescriptorSet(layout, 0, allocator->getDescriptorSet(), { allocator->push(model) });
+			}
+			commandBuffer->end();
+			uniformSamples.push_back(timer.elapsedMs());
+		}
+		const auto uniformStats = commandBuffer->getStats();
+
+		auto push = summarize("gpu_per_draw_data.push", pushSamples, drawCount, "draws/s");
+		push.extra["pushConstantUpdates"] = pushStats.pushConstantUpdates;
+		auto uniform = summarize("gpu_per_draw_data.uniform", uniformSamples, drawCount, "draws/s");
+		uniform.extra["descriptorBinds"] = uniformStats.descriptorBinds;
+		uniform.extra["uniformBytes"] = static_cast<double>(allocator->getUsedBytes());
+
+		commandBuffer.reset();
+		commandPool.reset();
+		vkDestroyPipelineLayout(vkContext.vk_device, layout, nullptr);
+		return { push, uniform };
+	}
+
+	/**
+	 * N个sprite渲染到离屏的1080p颜色和深度附件，每次迭代完整走一帧：
+	 * 	填充SpriteBatch -> SpriteRenderer排序写实例并录制 -> 提交并等待
+	 */
+	static std::vector<BenchResult> gpuSprites(const BenchOptions& options)
+	{
+		if (!requireRendering(options))
+		{
+			return {};
+		}
+
+		const size_t count = options.count ? options.count : 100000;
+		const VkFormat depthFormat = findDepthFormat(vkContext.vk_physicalDevice);
+
+		auto bindlessHeap = BindlessHeap::create(vkContext.vk_device, 1);
+		auto samplerCache = SamplerCache::create(vkContext.vk_device);
+		auto commandPool = CommandPool::create(vkContext.vk_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+
+		//一张白色纹理，所有sprite共用
+		ImageDesc textureDesc{};
+		textureDesc.width = 4;
+		textureDesc.height = 4;
+		auto texture = Image::create(vkContext.vk_device, vkContext.vk_physicalDevice, textureDesc);
+		std::vector<uint32_t> pixels(16, 0xFFFFFFFF);
+		auto uploader = ImageUploader::create(vkContext.vk_device, vkContext.vk_physicalDevice);
+		uploader->enqueue(texture, pixels.data(), pixels.size() * sizeof(uint32_t), false);
+		uploader->flush();
+		uint32_t textureIndex = bindlessHeap->registerTexture(texture->getImageView(),
+			samplerCache->get(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE));
+
+		ImageDesc colorDesc{};
+		colorDesc.width = TARGET_WIDTH;
+		colorDesc.height = TARGET_HEIGHT;
+		colorDesc.format = TARGET_FORMAT;
+		colorDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		colorDesc.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		auto color = Image::create(vkContext.vk_device, vkContext.vk_physicalDevice, colorDesc);
+
+		ImageDesc depthDesc = colorDesc;
+		depthDesc.format = depthFormat;
+		depthDesc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		depthDesc.aspect = getFormatAspect(depthFormat);
+		auto depth = Image::create(vkContext.vk_device, vkContext.vk_physicalDevice, depthDesc);
+
+		auto pipeline = createSpritePipeline(options, bindlessHeap, TARGET_FORMAT, depthFormat,
+			TARGET_WIDTH, TARGET_HEIGHT);
+		pipeline->buildPipeline();
+
+		auto renderer = SpriteRenderer::create(vkContext.vk_device, vkContext.vk_physicalDevice, bindlessHeap, 1,
+			static_cast<uint32_t>(count));
+		uint16_t pipelineId = renderer->addPipeline(pipeline);
+		renderer->setViewProjection(glm::ortho(0.0f, (float)TARGET_WIDTH, 0.0f, (float)TARGET_HEIGHT));
+
+		std::mt19937 rng(4321);
+		std::uniform_real_distribution<float> x(0.0f, (float)TARGET_WIDTH);
+		std::uniform_real_distribution<float> y(0.0f, (float)TARGET_HEIGHT);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<glm::vec3> sprites(count);
+		for (auto& sprite : sprites)
+		{
+			sprite = { x(rng), y(rng), unit(rng) };
+		}
+
+		SpriteBatch batch(count);
+		std::vector<double> samples;
+		double recordMs = 0.0;
+		double gpuMs = 0.0;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			batch.clear();
+			for (const auto& sprite : sprites)
+			{
+				batch.add({ sprite.x, sprite.y }, { 16.0f, 16.0f }, sprite.z * 6.2831853f, 0xFFFFFFFF, textureIndex,
+					{ 0.0f, 0.0f, 1.0f, 1.0f }, 0, pipelineId, sprite.z);
+			}
+
+			gpuMs += submitAndWait(commandPool, [&](const CommandBufferPtr& commandBuffer) {
+				Timer recordTimer;
+
+				//每帧都从UNDEFINED开始，附件内容由clear给出
+				color->setLayout(VK_IMAGE_LAYOUT_UNDEFINED);
+				depth->setLayout(VK_IMAGE_LAYOUT_UNDEFINED);
+				commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, {
+						color->transition(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 0,
+							VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT),
+						depth->transition(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 0,
+							VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT),
+					});
+
+				VkRenderingAttachmentInfoKHR colorAttachment{};
+				colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+				colorAttachment.imageView = color->getImageView();
+				colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+				colorAttachment.clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+				VkRenderingAttachmentInfoKHR depthAttachment{};
+				depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+				depthAttachment.imageView = depth->getImageView();
+				depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+				VkRenderingInfoKHR renderingInfo{};
+				renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+				renderingInfo.renderArea = { { 0, 0 }, { TARGET_WIDTH, TARGET_HEIGHT } };
+				renderingInfo.layerCount = 1;
+				renderingInfo.colorAttachmentCount = 1;
+				renderingInfo.pColorAttachments = &colorAttachment;
+				renderingInfo.pDepthAttachment = &depthAttachment;
+				if (depthDesc.aspect & VK_IMAGE_ASPECT_STENCIL_BIT)
+				{
+					renderingInfo.pStencilAttachment = &depthAttachment;
+				}
+
+				commandBuffer->beginRendering(renderingInfo);
+				renderer->record(commandBuffer, 0, batch);
+				commandBuffer->endRendering();
+				recordMs += recordTimer.elapsedMs();
+			});
+			samples.push_back(timer.elapsedMs());
+		}
+
+		auto result = summarize("gpu_sprites", samples, static_cast<double>(count), "sprites/s");
+		const double iterations = std::max(options.iterations, 1u);
+		result.extra["sprites"] = static_cast<double>(count);
+		result.extra["batches"] = static_cast<double>(batch.getBatches().size());
+		result.extra["recordMs"] = recordMs / iterations;
+		result.extra["gpuMs"] = gpuMs / iterations;
+
+		renderer.reset();
+		pipeline.reset();
+		bindlessHeap->releaseTexture(textureIndex);
+		return { result };
+	}
+
+	TOY_BENCH("gpu_pipeline_build", gpuPipelineBuild);
+	TOY_BENCH("gpu_record", gpuRecord);
+	TOY_BENCH("gpu_per_draw_data", gpuPerDrawData);
+	TOY_BENCH("gpu_sprites", gpuSprites);
+
+} // ToyBench
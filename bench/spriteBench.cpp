@@ -0,0 +1,73 @@
+#include "bench.h"
+#include "spriteBatch.h"
+
+#include <random>
+
+namespace ToyBench
+{
+	//CPU侧的sprite填充与排序，实例写入普通内存，模拟写持久映射buffer
+	static std::vector<BenchResult> spriteFillSort(const BenchOptions& options)
+	{
+		const size_t count = options.count ? options.count : 1000000;
+		const uint32_t textureCount = 64;
+		const uint16_t pipelineCount = 4;
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(0.0f, 4096.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+		std::uniform_int_distribution<uint32_t> texture(0, textureCount - 1);
+		std::uniform_int_distribution<uint32_t> pipeline(0, pipelineCount - 1);
+
+		//随机数提前生成，不计入填充时间
+		std::vector<glm::vec2> positions(count);
+		std::vector<float> rotations(count);
+		std::vector<uint32_t> textures(count);
+		std::vector<uint16_t> pipelines(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			positions[i] = { position(rng), position(rng) };
+			rotations[i] = angle(rng);
+			textures[i] = texture(rng);
+			pipelines[i] = static_cast<uint16_t>(pipeline(rng));
+		}
+
+		ToyEngine::SpriteBatch batch(count);
+		std::vector<ToyEngine::SpriteInstance> instances(count);
+
+		std::vector<double> fillSamples;
+		std::vector<double> buildSamples;
+		std::vector<double> totalSamples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer total;
+
+			Timer fill;
+			batch.clear();
+			for (size_t i = 0; i < count; i++)
+			{
+				batch.add(positions[i], { 16.0f, 16.0f }, rotations[i], 0xFFFFFFFF, textures[i],
+					{ 0.0f, 0.0f, 1.0f, 1.0f }, 0, pipelines[i]);
+			}
+			fillSamples.push_back(fill.elapsedMs());
+
+			Timer build;
+			batch.build(instances.data(), instances.size());
+			buildSamples.push_back(build.elapsedMs());
+
+			totalSamples.push_back(total.elapsedMs());
+		}
+
+		auto totalResult = summarize("sprite_fill_sort", totalSamples, static_cast<double>(count), "sprites/s");
+		totalResult.extra["sprites"] = static_cast<double>(count);
+		totalResult.extra["batches"] = static_cast<double>(batch.getBatches().size());
+
+		return {
+			totalResult,
+			summarize("sprite_fill_sort.fill", fillSamples, static_cast<double>(count), "sprites/s"),
+			summarize("sprite_fill_sort.build", buildSamples, static_cast<double>(count), "sprites/s"),
+		};
+	}
+
+	TOY_BENCH("sprite_fill_sort", spriteFillSort);
+
+} // ToyBench
@@ -0,0 +1,159 @@
+#include "gpuBench.h"
+#include "logger.h"
+#include "samplerCache.h"
+#include "textureStreamer.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace ToyBench
+{
+	using namespace ToyEngine;
+
+	static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	//带完整mip链的RGBA8 KTX2，只写Ktx2File会读取的头部和level索引，不写DFD
+	static void writeKtx2(const std::string& path, uint32_t size, uint8_t value)
+	{
+		uint32_t levelCount = 1;
+		while ((size >> levelCount) > 0)
+		{
+			levelCount++;
+		}
+
+		std::vector<uint8_t> header(80 + static_cast<size_t>(levelCount) * 24, 0);
+		auto put32 = [&header](size_t offset, uint32_t v) { std::memcpy(header.data() + offset, &v, sizeof(v)); };
+		auto put64 = [&header](size_t offset, uint64_t v) { std::memcpy(header.data() + offset, &v, sizeof(v)); };
+
+		std::memcpy(header.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+		put32(12, VK_FORMAT_R8G8B8A8_UNORM);
+		put32(16, 1);			//typeSize
+		put32(20, size);
+		put32(24, size);
+		put32(36, 1);			//faceCount
+		put32(40, levelCount);
+
+		uint64_t offset = header.size();
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			uint64_t bytes = static_cast<uint64_t>(size >> level) * (size >> level) * 4;
+			put64(80 + level * 24, offset);
+			put64(80 + level * 24 + 8, bytes);
+			put64(80 + level * 24 + 16, bytes);
+			offset += bytes;
+		}
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+		std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4, value);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			out.write(reinterpret_cast<const char*>(pixels.data()),
+				static_cast<std::streamsize>(static_cast<size_t>(size >> level) * (size >> level) * 4));
+		}
+	}
+
+	/**
+	 * N张1024的纹理，每帧只有一个窗口内的几张请求第0级，窗口每隔几帧向后移动：
+	 * 	预算只够放下比窗口多两张的detail，移出窗口的纹理按LRU被淘汰，退回常驻的tail
+	 * 	每帧的update单独提交并等待，计时包括回收读取、录制上传和提交
+	 */
+	static std::vector<BenchResult> gpuTextureStreaming(const BenchOptions& options)
+	{
+		if (!requireGpu(options))
+		{
+			return {};
+		}
+
+		const uint32_t textureCount = options.count ? static_cast<uint32_t>(options.count) : 16;
+		const uint32_t textureSize = 1024;
+		const uint32_t visibleCount = std::min(4u, textureCount);
+		const uint32_t framesPerStep = 8;
+		const uint32_t framesInFlight = 2;
+
+		auto directory = std::filesystem::temp_directory_path() / "toy2d_streaming";
+		std::filesystem::create_directories(directory);
+		std::vector<std::string> basePaths;
+		for (uint32_t i = 0; i < textureCount; i++)
+		{
+			auto basePath = (directory / ("texture" + std::to_string(i))).string();
+			writeKtx2(basePath + ".ktx2", textureSize, static_cast<uint8_t>(i * 16));
+			basePaths.push_back(basePath);
+		}
+
+		//detail是从第0级开始的整条链，约为第0级的4/3
+		const VkDeviceSize detailBytes = static_cast<VkDeviceSize>(textureSize) * textureSize * 4 * 4 / 3;
+		TextureStreamerConfig config{};
+		config.budgetBytes = detailBytes * (visibleCount + 2);
+		config.budgetQueryInterval = 0;
+
+		auto bindlessHeap = BindlessHeap::create(vkContext.vk_device, framesInFlight);
+		auto samplerCache = SamplerCache::create(vkContext.vk_device);
+		auto commandPool = CommandPool::create(vkContext.vk_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+		auto streamer = TextureStreamer::create(vkContext.vk_device, vkContext.vk_physicalDevice, bindlessHeap,
+			samplerCache, framesInFlight, config);
+
+		Timer registerTimer;
+		auto handles = streamer->registerTextures(basePaths);
+		const double registerMs = registerTimer.elapsedMs();
+
+		std::vector<uint32_t> residentMips(handles.size());
+		for (size_t i = 0; i < handles.size(); i++)
+		{
+			residentMips[i] = streamer->getResidentMip(handles[i]);
+		}
+
+		std::vector<double> samples;
+		double uploadBytes = 0.0;
+		VkDeviceSize peakResidentBytes = 0;
+		uint32_t loads = 0;
+		uint32_t evictions = 0;
+		const uint32_t frameCount = options.iterations * framesPerStep;
+		for (uint32_t frame = 0; frame < frameCount; frame++)
+		{
+			//窗口每步移动半个窗口，新进入的纹理需要读取，移出的成为淘汰候选
+			uint32_t first = (frame / framesPerStep) * std::max(visibleCount / 2, 1u);
+			for (uint32_t v = 0; v < visibleCount; v++)
+			{
+				streamer->requestMip(handles[(first + v) % textureCount], 0);
+			}
+
+			Timer timer;
+			bindlessHeap->nextFrame();
+			submitAndWait(commandPool, [&](const CommandBufferPtr& commandBuffer) {
+				streamer->update(commandBuffer, frame % framesInFlight);
+			});
+			samples.push_back(timer.elapsedMs());
+
+			uploadBytes += static_cast<double>(streamer->getLastUploadBytes());
+			peakResidentBytes = std::max(peakResidentBytes, streamer->getResidentBytes());
+			for (size_t i = 0; i < handles.size(); i++)
+			{
+				uint32_t mip = streamer->getResidentMip(handles[i]);
+				loads += mip < residentMips[i] ? 1 : 0;
+				evictions += mip > residentMips[i] ? 1 : 0;
+				residentMips[i] = mip;
+			}
+		}
+
+		auto result = summarize("gpu_texture_streaming", samples, 1.0, "frames/s");
+		result.extra["textures"] = textureCount;
+		result.extra["registerMs"] = registerMs;
+		result.extra["loads"] = loads;
+		result.extra["evictions"] = evictions;
+		result.extra["uploadMB"] = uploadBytes / (1024.0 * 1024.0);
+		result.extra["peakResidentMB"] = static_cast<double>(peakResidentBytes) / (1024.0 * 1024.0);
+		result.extra["budgetMB"] = static_cast<double>(streamer->getBudget()) / (1024.0 * 1024.0);
+
+		streamer.reset();
+		commandPool.reset();
+		samplerCache.reset();
+		bindlessHeap.reset();
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+		return { result };
+	}
+
+	TOY_BENCH("gpu_texture_streaming", gpuTextureStreaming);
+
+} // ToyBench
@@ -0,0 +1,47 @@
+#include "bench.h"
+#include "textureDecoder.h"
+
+#include <random>
+
+namespace ToyBench
+{
+	//CPU回退解码的吞吐，随机块数据覆盖各种编码模式
+	static BenchResult decode(const std::string& name, const BenchOptions& options, ToyEngine::BlockFormat format)
+	{
+		const uint32_t size = options.count ? static_cast<uint32_t>(options.count) : 1024;
+		const size_t blockCount = static_cast<size_t>((size + 3) / 4) * ((size + 3) / 4);
+
+		std::mt19937 rng(7);
+		std::vector<uint8_t> src(blockCount * ToyEngine::getBlockSize(format));
+		for (auto& byte : src)
+		{
+			byte = static_cast<uint8_t>(rng());
+		}
+		std::vector<uint8_t> dst(static_cast<size_t>(size) * size * 4);
+
+		std::vector<double> samples;
+		for (uint32_t it = 0; it < options.iterations; it++)
+		{
+			Timer timer;
+			ToyEngine::decodeBlocks(format, src.data(), size, size, dst.data());
+			samples.push_back(timer.elapsedMs());
+		}
+
+		auto result = summarize(name, samples, static_cast<double>(size) * size / 1.0e6, "Mpixel/s");
+		result.extra["compression_ratio"] = static_cast<double>(dst.size()) / static_cast<double>(src.size());
+		return result;
+	}
+
+	static std::vector<BenchResult> textureDecode(const BenchOptions& options)
+	{
+		return {
+			decode("texture_decode.bc1", options, ToyEngine::BlockFormat::BC1),
+			decode("texture_decode.bc3", options, ToyEngine::BlockFormat::BC3),
+			decode("texture_decode.etc2_rgb8", options, ToyEngine::BlockFormat::ETC2_RGB8),
+			decode("texture_decode.etc2_rgba8", options, ToyEngine::BlockFormat::ETC2_RGBA8),
+		};
+	}
+
+	TOY_BENCH("texture_decode", textureDecode);
+
+} // ToyBench
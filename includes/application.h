@@ -10,11 +10,57 @@
 #include "commandBuffer.h"
 #include "semaphore.h"
 #include "fence.h"
+#include "bindlessHeap.h"
+#include "spriteBatch.h"
+#include "image.h"
+#include "imageUploader.h"
+#include "samplerCache.h"
+#include "textureAtlas.h"
+#include "textureStreamer.h"
+#include "renderGraph.h"
+#include "renderpassCache.h"
+#include "framebufferCache.h"
+#include "gpuProfiler.h"
+#include "cpuProfiler.h"
+#include "frameStats.h"
+#include "spscQueue.h"
+#include <thread>
 
 namespace ToyEngine
 {
 	const int WIDTH = 800;
 	const int HEIGHT = 600;
+	const uint32_t MAX_SPRITES = 1 << 20;
+	//每帧DrawStream的命令数上限，以及各个pass在DrawKey中的编号
+	const uint32_t MAX_DRAW_COMMANDS = 4096;
+	const uint32_t DRAW_PASS_SPRITES = 0;
+	//设备支持时使用动态渲染，不支持时退回renderpass路径
+	const bool PREFER_DYNAMIC_RENDERING = true;
+	//期望的多重采样数，按设备支持向下取；运行时按M键在1/2/4/8之间切换
+	const VkSampleCountFlagBits MSAA_SAMPLES = VK_SAMPLE_COUNT_4_BIT;
+	//每隔多少帧输出一次GPU计时和帧时间分布
+	const uint32_t GPU_STATS_INTERVAL = 600;
+	//所有Vulkan工作放在渲染线程，主线程只处理输入和更新场景；false时两者都在主线程，便于调试
+	const bool USE_RENDER_THREAD = true;
+
+	//使用流式纹理的sprite，TextureStreamer只在渲染线程访问，由渲染线程请求mip并加入spriteBatch
+	struct StreamedSprite
+	{
+		uint32_t texture{ 0 };		//Application::m_streamedTextures中的序号
+		glm::vec2 position{ 0.0f };
+		glm::vec2 size{ 0.0f };		//屏幕像素
+		float rotation{ 0.0f };
+		float depth{ 0.0f };
+	};
+
+	//主线程生成、渲染线程消费的一帧数据，入队之后主线程不再修改，直到渲染线程录制完后归还
+	struct FramePacket
+	{
+		uint64_t frameIndex{ 0 };
+		VkSampleCountFlagBits sampleCount{ VK_SAMPLE_COUNT_1_BIT };
+		SpriteBatch spriteBatch{};
+		std::vector<StreamedSprite> streamedSprites{};
+	};
 
 	class Application
 	{
@@ -30,27 +76,79 @@ namespace ToyEngine
 
 		void initVulkan();
 
+		//主线程：处理输入、生成FramePacket并交给渲染线程
 		void mainLoop();
 
-		void render();
+		//渲染线程：逐个取出FramePacket并渲染，异常保存下来由主线程重新抛出
+		void renderLoop();
+
+		//应用packet中的设置并渲染一帧，前后是这一帧的统计
+		void drawFrame(FramePacket& packet);
+
+		void render(FramePacket& packet);
 
 		void cleanup();
 
-		void createPipeline();
+		//不透明与半透明的区别只在混合和深度写入
+		void createPipeline(const PipelinePtr& pipeline, bool transparent);
+
+		//修改多重采样数，只重新创建采样数不一致的管线，临时纹理由RenderGraph按新的声明重新分配
+		void setSampleCount(VkSampleCountFlagBits samples);
 
+		//只用于renderpass路径创建管线，与RenderGraph中精灵pass使用的是缓存中的同一个renderpass
 		void createRenderpass();
 
+		//演示用的程序化纹理，全部放进一个图集，sprite引用其中的子区域
+		void createTextures();
+
+		//每帧重新生成sprite数据
+		void updateScene(FramePacket& packet);
+
+		void recordCommandBuffer(uint32_t imageIndex, FramePacket& packet);
+
 	 private:
 		int m_currentFrame{ 0 };
 		WindowPtr m_window{ nullptr };
 		SwapChainPtr m_swapChain{ nullptr };
-		PipelinePtr m_pipeline{ nullptr };
+		PipelinePtr m_opaquePipeline{ nullptr };
+		PipelinePtr m_transparentPipeline{ nullptr };
+		uint16_t m_opaquePipelineId{ 0 };
+		uint16_t m_transparentPipelineId{ 0 };
+		VkFormat m_depthFormat{ VK_FORMAT_UNDEFINED };
+		VkSampleCountFlagBits m_sampleCount{ VK_SAMPLE_COUNT_1_BIT };
+		bool m_msaaKeyDown{ false };
+		VkSampleCountFlagBits m_requestedSampleCount{ VK_SAMPLE_COUNT_1_BIT };	//主线程写入packet的采样数
 		RenderpassPtr m_renderpass{ nullptr };
 		CommandPoolPtr m_commandPool{ nullptr };
 		std::vector<CommandBufferPtr> m_commandBuffers{};
 		std::vector<SemaphorePtr> m_imageAvailableSemaphores{};
 		std::vector<SemaphorePtr> m_renderFinishedSemaphores{};
 		std::vector<FencePtr> m_fences{};
+		BindlessHeapPtr m_bindlessHeap{ nullptr };
+		QuadIndexBufferPtr m_quadIndexBuffer{ nullptr };
+		SpriteRendererPtr m_spriteRenderer{ nullptr };
+		DrawStreamPtr m_drawStream{ nullptr };
+		SamplerCachePtr m_samplerCache{ nullptr };
+		TextureAtlasPtr m_textureAtlas{ nullptr };
+		std::vector<AtlasRegion> m_spriteRegions{};
+		TextureStreamerPtr m_textureStreamer{ nullptr };
+		std::vector<TextureStreamer::Handle> m_streamedTextures{};
+		RenderpassCachePtr m_renderpassCache{ nullptr };
+		FramebufferCachePtr m_framebufferCache{ nullptr };
+		RenderGraphPtr m_renderGraph{ nullptr };
+		GpuProfilerPtr m_gpuProfiler{ nullptr };
+		FrameStatsPtr m_frameStats{ nullptr };
+		uint64_t m_frameCount{ 0 };
+
+		//两个packet轮流使用：渲染线程录制一个的同时主线程填充另一个，CPU上最多领先一帧
+		static constexpr uint32_t FRAME_PACKET_COUNT = 2;
+		std::array<FramePacket, FRAME_PACKET_COUNT> m_framePackets{};
+		SpscQueue<FramePacket*, FRAME_PACKET_COUNT> m_freePackets{};		//渲染线程 -> 主线程
+		SpscQueue<FramePacket*, FRAME_PACKET_COUNT> m_submittedPackets{};	//主线程 -> 渲染线程
+		std::thread m_renderThread{};
+		std::atomic<bool> m_renderThreadStop{ false };
+		std::atomic<bool> m_renderThreadFailed{ false };
+		std::exception_ptr m_renderThreadError{};
 	};
 
 } // ToyEngine
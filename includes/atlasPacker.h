@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace ToyEngine
+{
+	struct AtlasRect
+	{
+		uint32_t x{ 0 };
+		uint32_t y{ 0 };
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+	};
+
+	//图集中的一个子区域，sprite直接引用它，而不是单独的纹理
+	struct AtlasRegion
+	{
+		uint32_t textureIndex{ UINT32_MAX };	//图集纹理的bindless下标
+		uint32_t layer{ 0 };					//图集页，对应纹理数组的层
+		AtlasRect rect{};
+		glm::vec4 uvRect{ 0.0f, 0.0f, 1.0f, 1.0f };
+	};
+
+	/**
+	 * Skyline装箱
+	 * 	只记录已占用区域的上轮廓线(skyline)，插入时选择放置后顶边最低的位置，顶边相同时选轮廓段更窄的位置
+	 * 	支持运行时逐个插入，不需要提前知道所有矩形；不支持单个删除，只能整页reset
+	 * 	padding会加在矩形的右侧和下侧，避免双线性过滤采到相邻图块
+	 */
+	class SkylinePacker
+	{
+	 public:
+		SkylinePacker(uint32_t width, uint32_t height, uint32_t padding = 1);
+
+		std::optional<AtlasRect> insert(uint32_t width, uint32_t height);
+
+		void reset();
+
+		//已占用面积(含padding)占整页的比例
+		[[nodiscard]] float getOccupancy() const;
+
+		[[nodiscard]] uint32_t getWidth() const
+		{
+			return m_width;
+		}
+
+		[[nodiscard]] uint32_t getHeight() const
+		{
+			return m_height;
+		}
+
+	 private:
+		struct SkylineNode
+		{
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+		};
+
+		//矩形左边对齐第index段时的放置高度，放不下返回false
+		bool fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const;
+
+		void addNode(size_t index, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+	 private:
+		uint32_t m_width{ 0 };
+		uint32_t m_height{ 0 };
+		uint32_t m_padding{ 0 };
+		uint64_t m_usedArea{ 0 };
+		std::vector<SkylineNode> m_skyline;
+	};
+
+} // ToyEngine
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "base.h"
+#include "context.h"
+
+namespace ToyEngine
+{
+	/**
+	 * bindless资源表
+	 * 	一个descriptor set中放两个超大的运行时数组，binding 0为纹理(combined image sampler)，binding 1为storage buffer
+	 * 	数组使用UPDATE_AFTER_BIND + PARTIALLY_BOUND，注册新资源不需要重新分配或者绑定set
+	 * 	资源拿到的下标在释放前保持不变，shader通过push constant传入的下标访问数组，见shaders/bindless.glsl
+	 * 	释放的下标会延迟framesInFlight帧后才回收，避免仍在GPU上执行的命令访问到被复用的槽位
+	 */
+	class BindlessIndexAllocator
+	{
+	 public:
+		explicit BindlessIndexAllocator(uint32_t capacity = 0);
+
+		//返回INVALID_INDEX表示已满
+		uint32_t allocate();
+
+		//只接受已分配且未释放的下标，重复释放会输出错误并忽略
+		void release(uint32_t index, uint32_t framesInFlight);
+
+		//推进一帧，把延迟期已过的下标放回空闲链表
+		void nextFrame();
+
+		[[nodiscard]] uint32_t getCapacity() const
+		{
+			return m_capacity;
+		}
+
+		[[nodiscard]] uint32_t getUsedCount() const
+		{
+			return m_next - static_cast<uint32_t>(m_freeList.size());
+		}
+
+		//已分配且还没有被释放
+		[[nodiscard]] bool isLive(uint32_t index) const
+		{
+			return index < m_live.size() && m_live[index];
+		}
+
+	 public:
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	 private:
+		struct PendingRelease
+		{
+			uint32_t index;
+			uint32_t framesLeft;
+		};
+
+		uint32_t m_capacity{ 0 };
+		uint32_t m_next{ 0 };
+		std::vector<uint32_t> m_freeList;
+		std::vector<PendingRelease> m_pending;
+		std::vector<bool> m_live;
+	};
+
+	class BindlessHeap;
+	using BindlessHeapPtr = std::shared_ptr<BindlessHeap>;
+	class BindlessHeap
+	{
+	 public:
+		static BindlessHeapPtr create(const VkDevice& device,
+			uint32_t framesInFlight,
+			uint32_t maxTextures = 4096,
+			uint32_t maxBuffers = 1024);
+
+		BindlessHeap(const VkDevice& device,
+			uint32_t framesInFlight,
+			uint32_t maxTextures = 4096,
+			uint32_t maxBuffers = 1024);
+
+		~BindlessHeap();
+
+		uint32_t registerTexture(VkImageView imageView,
+			VkSampler sampler,
+			VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		//原地替换某个下标对应的纹理，例如纹理流式加载切换mip后下标不变，下标必须是已注册且未释放的
+		void updateTexture(uint32_t index,
+			VkImageView imageView,
+			VkSampler sampler,
+			VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		void releaseTexture(uint32_t index);
+
+		uint32_t registerBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+		void releaseBuffer(uint32_t index);
+
+		//每帧调用一次，回收延迟释放的下标
+		void nextFrame();
+
+		[[nodiscard]] VkDescriptorSetLayout getDescriptorSetLayout() const
+		{
+			return m_setLayout;
+		}
+
+		[[nodiscard]] VkDescriptorSet getDescriptorSet() const
+		{
+			return m_descriptorSet;
+		}
+
+		[[nodiscard]] uint32_t getTextureCapacity() const
+		{
+			return m_textureIndices.getCapacity();
+		}
+
+		[[nodiscard]] uint32_t getBufferCapacity() const
+		{
+			return m_bufferIndices.getCapacity();
+		}
+
+	 public:
+		static constexpr uint32_t TEXTURE_BINDING = 0;
+		static constexpr uint32_t BUFFER_BINDING = 1;
+		static constexpr uint32_t INVALID_INDEX = BindlessIndexAllocator::INVALID_INDEX;
+
+	 private:
+		void writeTexture(uint32_t index, VkImageView imageView, VkSampler sampler, VkImageLayout layout);
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout m_setLayout{ VK_NULL_HANDLE };
+		VkDescriptorPool m_descriptorPool{ VK_NULL_HANDLE };
+		VkDescriptorSet m_descriptorSet{ VK_NULL_HANDLE };
+
+		uint32_t m_framesInFlight{ 1 };
+		BindlessIndexAllocator m_textureIndices;
+		BindlessIndexAllocator m_bufferIndices;
+	};
+
+} // ToyEngine
@@ -25,6 +25,19 @@ namespace ToyEngine
 
 		void updateBufferByStage(void* data, size_t size);
 
+		//持久映射，映射一次直到buffer销毁，要求内存是HOST_VISIBLE的
+		void* map();
+
+		[[nodiscard]] void* getMappedData() const
+		{
+			return m_mappedData;
+		}
+
+		[[nodiscard]] VkDeviceSize getSize() const
+		{
+			return m_size;
+		}
+
 	 private:
 		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
@@ -33,6 +46,8 @@ namespace ToyEngine
 		VkDeviceMemory m_bufferMemory{ VK_NULL_HANDLE };
 		VkDevice m_device{ VK_NULL_HANDLE };
 		VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+		VkDeviceSize m_size{ 0 };
+		void* m_mappedData{ nullptr };
 	};
 
 } // ToyEngine
@@ -6,6 +6,19 @@
 
 namespace ToyEngine
 {
+	//一次录制(begin到end)中实际写入命令缓冲的调用次数，被过滤掉的重复绑定不计入，单独计在elidedCalls中
+	struct CommandBufferStats
+	{
+		uint32_t draws{ 0 };
+		uint32_t pipelineBinds{ 0 };
+		uint32_t descriptorBinds{ 0 };
+		uint32_t vertexBufferBinds{ 0 };
+		uint32_t indexBufferBinds{ 0 };
+		uint32_t pushConstantUpdates{ 0 };
+		uint32_t dynamicStateSets{ 0 };		//viewport/scissor
+		uint32_t elidedCalls{ 0 };
+	};
+
 	class CommandBuffer;
 	using CommandBufferPtr = std::shared_ptr<CommandBuffer>;
 	class CommandBuffer
@@ -31,12 +44,67 @@ namespace ToyEngine
 		void beginRenderPass(const VkRenderPassBeginInfo& renderPassInfo,
 			const VkSubpassContents& contents = VK_SUBPASS_CONTENTS_INLINE);
 
+		//以下bind/push/set接口会记录当前状态，与上一次完全相同的调用直接跳过
+		//状态在begin时清空；绕过这些接口直接调用vkCmd*修改状态后需要调用invalidateState
 		void bindGraphicPipeline(const VkPipeline& pipeline);
 
-		void draw(uint32_t vertexCount);
+		void bindDescriptorSet(VkPipelineLayout layout,
+			uint32_t setIndex,
+			VkDescriptorSet descriptorSet,
+			std::initializer_list<uint32_t> dynamicOffsets = {});
+
+		void bindDescriptorSet(VkPipelineLayout layout,
+			uint32_t setIndex,
+			VkDescriptorSet descriptorSet,
+			uint32_t dynamicOffsetCount,
+			const uint32_t* dynamicOffsets);
+
+		void pushConstants(VkPipelineLayout layout,
+			VkShaderStageFlags stages,
+			uint32_t offset,
+			uint32_t size,
+			const void* data);
+
+		template<typename T>
+		void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, const T& data, uint32_t offset = 0)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Push constant data must be trivially copyable.");
+			static_assert(sizeof(T) <= MAX_PUSH_CONSTANT_SIZE, "Push constant block is larger than 128 bytes.");
+			pushConstants(layout, stages, offset, static_cast<uint32_t>(sizeof(T)), &data);
+		}
+
+		void bindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset = 0);
+
+		void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkIndexType indexType = VK_INDEX_TYPE_UINT16);
+
+		//只跟踪第0个viewport/scissor，需要pipeline把它们声明为动态状态
+		void setViewport(const VkViewport& viewport);
+
+		void setScissor(const VkRect2D& scissor);
+
+		void invalidateState();
+
+		void draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0);
+
+		//vertexOffset(base vertex)加到每个index上，需要先bindIndexBuffer
+		void drawIndexed(uint32_t indexCount,
+			uint32_t instanceCount = 1,
+			uint32_t firstIndex = 0,
+			int32_t vertexOffset = 0,
+			uint32_t firstInstance = 0);
 
 		void endRenderPass();
 
+		//动态渲染，需要设备支持(vkContext.vk_dynamicRenderingSupported)
+		void beginRendering(const VkRenderingInfoKHR& renderingInfo);
+
+		void endRendering();
+
+		void writeTimestamp(VkPipelineStageFlagBits stage, VkQueryPool queryPool, uint32_t query);
+
+		//必须在renderpass之外
+		void resetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount);
+
 		void end();
 
 		[[nodiscard]] VkCommandBuffer getCommandBuffer() const
@@ -44,14 +112,78 @@ namespace ToyEngine
 			return m_commandBuffer;
 		}
 
+		//begin时清零
+		[[nodiscard]] const CommandBufferStats& getStats() const
+		{
+			return m_stats;
+		}
+
 		void copyBuffer(const VkBuffer& srcBuffer, const VkBuffer& dstBuffer, uint32_t copyInfoCount,
 			const std::vector<VkBufferCopy>& copyInfos);
 
+		void copyBufferToImage(const VkBuffer& srcBuffer, const VkImage& dstImage, VkImageLayout dstLayout,
+			const std::vector<VkBufferImageCopy>& copyInfos);
+
+		void copyImageToBuffer(const VkImage& srcImage, VkImageLayout srcLayout, const VkBuffer& dstBuffer,
+			const std::vector<VkBufferImageCopy>& copyInfos);
+
+		void blitImage(const VkImage& srcImage, VkImageLayout srcLayout,
+			const VkImage& dstImage, VkImageLayout dstLayout,
+			const std::vector<VkImageBlit>& blits, VkFilter filter);
+
+		void clearColorImage(const VkImage& image, VkImageLayout layout, const VkClearColorValue& color,
+			const VkImageSubresourceRange& range);
+
+		//多个image的布局转换合并到一次barrier调用
+		void pipelineBarrier(VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+			const std::vector<VkImageMemoryBarrier>& imageBarriers,
+			const std::vector<VkBufferMemoryBarrier>& bufferBarriers = {});
+
 		void submitSync(const VkQueue& queue, const VkFence& fence);
 
+	 public:
+		static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+		static constexpr uint32_t MAX_BOUND_DESCRIPTOR_SETS = 4;
+		static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 4;
+		static constexpr uint32_t MAX_VERTEX_BINDINGS = 4;
+
+	 private:
+		//用layout绑定setIndex后，清掉可能被破坏的其它绑定记录
+		void invalidateIncompatible(VkPipelineLayout layout, uint32_t setIndex);
+
 	 private:
+		struct BoundDescriptorSet
+		{
+			VkPipelineLayout layout{ VK_NULL_HANDLE };
+			VkDescriptorSet set{ VK_NULL_HANDLE };
+			uint32_t dynamicOffsetCount{ 0 };
+			uint32_t dynamicOffsets[MAX_DYNAMIC_OFFSETS]{};
+		};
+
+		struct BoundBuffer
+		{
+			VkBuffer buffer{ VK_NULL_HANDLE };
+			VkDeviceSize offset{ 0 };
+		};
+
 		VkCommandBuffer m_commandBuffer{ VK_NULL_HANDLE };
 		CommandPoolPtr m_commandPool{ nullptr };
+		CommandBufferStats m_stats{};
+
+		//录制期间的绑定状态，begin时清空
+		VkPipeline m_boundPipeline{ VK_NULL_HANDLE };
+		BoundDescriptorSet m_boundSets[MAX_BOUND_DESCRIPTOR_SETS]{};
+		VkPipelineLayout m_pushConstantLayout{ VK_NULL_HANDLE };
+		VkShaderStageFlags m_pushConstantStages{ 0 };
+		uint32_t m_pushConstantValid{ 0 }; //按4字节一位，记录哪些位置已经写过
+		uint8_t m_pushConstantData[MAX_PUSH_CONSTANT_SIZE]{};
+		BoundBuffer m_boundVertexBuffers[MAX_VERTEX_BINDINGS]{};
+		BoundBuffer m_boundIndexBuffer{};
+		VkIndexType m_boundIndexType{ VK_INDEX_TYPE_UINT16 };
+		bool m_viewportValid{ false };
+		VkViewport m_viewport{};
+		bool m_scissorValid{ false };
+		VkRect2D m_scissor{};
 	};
 
 } // ToyEngine
@@ -3,10 +3,34 @@
 #include "vulkan/vulkan_core.h"
 #include <memory>
 #include <optional>
+#include <mutex>
+#include <unordered_map>
 #include "base.h"
 
 namespace ToyEngine
 {
+	//验证层配置，默认Debug构建开启验证层，Release构建关闭
+	struct ValidationConfig
+	{
+		bool validation{ false };		//VK_LAYER_KHRONOS_validation与debug messenger
+		bool debugUtils{ false };		//VK_EXT_debug_utils，开启验证层时总是开启
+		bool breakOnError{ false };		//收到error级别的消息时中断到调试器
+
+		//在默认值上应用环境变量：
+		//TOY2D_VALIDATION=0/off关闭，1/on开启，break开启并在报错时中断
+		//TOY2D_DEBUG_UTILS=1在不开验证层时单独开启debug utils
+		static ValidationConfig fromEnvironment();
+	};
+
+	//按消息ID去重后的验证层消息，count为收到的总次数
+	struct ValidationMessageStats
+	{
+		int32_t id{ 0 };
+		std::string name;
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity{ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT };
+		uint64_t count{ 0 };
+	};
+
 	class Context;
 	using ContextPtr = std::shared_ptr<Context>;
 	class Context final // final means that this class cannot be inherited from
@@ -18,6 +42,8 @@ namespace ToyEngine
 
 		static ContextPtr create(bool enableValidationLayers);
 
+		//window为空时创建无窗口的Context：没有surface和交换链扩展，present队列与图形队列相同
+		static void Init(const ValidationConfig& validation, GLFWwindow* window);
 		static void Init(bool enableValidationLayers, GLFWwindow* window);
 		static void Quit();
 		static Context& getInstance();
@@ -31,10 +57,44 @@ namespace ToyEngine
 
 		void setDebugger();
 
+		[[nodiscard]] const ValidationConfig& getValidationConfig() const
+		{
+			return m_validationConfig;
+		}
+
+		//debug messenger回调，可能在任意调用Vulkan的线程上执行
+		//同一消息ID只输出第一次，之后只计数，次数到10、100、1000...时再提示一次
+		void reportValidationMessage(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+			const VkDebugUtilsMessengerCallbackDataEXT* data);
+
+		//收到过的验证层消息，按次数从多到少
+		[[nodiscard]] std::vector<ValidationMessageStats> getValidationMessages();
+
+		//不可用的设备返回0；设置了环境变量TOY2D_DEVICE时只接受名字包含该字符串的设备
 		int rateDeviceSuitability(VkPhysicalDevice device);
 
 		bool isDeviceSuitable(VkPhysicalDevice device);
 
+		[[nodiscard]] bool isHeadless() const
+		{
+			return m_headless;
+		}
+
+		//格式属性按格式缓存，第一次查询后不再调用驱动，可以在加载线程中调用
+		const VkFormatProperties& getFormatProperties(VkFormat format);
+
+		//设备本地堆的预算与当前用量，没有VK_EXT_memory_budget时预算按堆大小估算、用量为0
+		struct MemoryBudget
+		{
+			VkDeviceSize budget{ 0 };
+			VkDeviceSize usage{ 0 };
+		};
+
+		MemoryBudget queryDeviceLocalBudget();
+
+		//optimal tiling下能否作为采样纹理使用，压缩格式还要求对应的压缩特性已开启
+		bool isFormatSampleable(VkFormat format);
+
 	 public:
 		VkInstance vk_instance{ VK_NULL_HANDLE };
 
@@ -51,13 +111,36 @@ namespace ToyEngine
 
 		VkSurfaceKHR vk_surface{ VK_NULL_HANDLE };
 
+		VkPhysicalDeviceProperties vk_physicalDeviceProperties{};
+
+		//descriptor indexing(bindless)所需特性是否全部开启
+		bool vk_descriptorIndexingSupported{ false };
+
+		VkPhysicalDeviceVulkan12Properties vk_vulkan12Properties{};
+
+		//已开启的纹理压缩特性
+		bool vk_textureCompressionBC{ false };
+		bool vk_textureCompressionETC2{ false };
+		bool vk_textureCompressionASTC{ false };
+
+		bool vk_memoryBudgetSupported{ false };
+
+		//动态渲染：1.3设备为核心功能，1.2设备需要VK_KHR_dynamic_rendering，函数指针按实际来源加载
+		bool vk_dynamicRenderingSupported{ false };
+		PFN_vkCmdBeginRenderingKHR vk_cmdBeginRendering{ nullptr };
+		PFN_vkCmdEndRenderingKHR vk_cmdEndRendering{ nullptr };
+
 	 private:
-		explicit Context(bool enableValidationLayers, GLFWwindow* window);
+		explicit Context(const ValidationConfig& validation, GLFWwindow* window);
 
 		void createInstance();
 
 		void pickPhysicalDevice();
 
+		void queryDeviceFeatures();
+
+		bool isDeviceExtensionSupported(const char* name);
+
 		void createLogicalDevice();
 
 		void queryQueueFamilyIndices();
@@ -66,10 +149,17 @@ namespace ToyEngine
 
 		void createSurface(GLFWwindow* window);
 
+		static bool isInstanceExtensionSupported(const char* name);
+
 	 private:
 		static std::unique_ptr<Context> m_instance;
 
-		bool m_enableValidationLayers{ false };
+		ValidationConfig m_validationConfig{};
+
+		std::mutex m_validationMutex;
+		std::unordered_map<uint64_t, ValidationMessageStats> m_validationMessages;
+
+		bool m_headless{ false };
 
 		VkDebugUtilsMessengerEXT m_debugger{ VK_NULL_HANDLE };
 
@@ -78,6 +168,15 @@ namespace ToyEngine
 		std::vector<const char*> m_instanceExtensions;
 
 		std::vector<const char*> m_deviceRequiredExtensions;
+
+		//物理设备支持的1.2特性，创建逻辑设备时从中挑选需要开启的部分
+		VkPhysicalDeviceVulkan12Features m_supportedVulkan12Features{};
+
+		//动态渲染是否来自核心1.3，否则来自扩展
+		bool m_dynamicRenderingCore{ false };
+
+		std::mutex m_formatMutex;
+		std::unordered_map<VkFormat, VkFormatProperties> m_formatProperties;
 	};
 
 #define vkContext Context::getInstance()
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "base.h"
+#include <atomic>
+#include <chrono>
+
+//由CMake的TOY_ENABLE_PROFILER控制，关闭时所有宏展开为空
+#ifndef TOY_PROFILE
+#define TOY_PROFILE 0
+#endif
+
+namespace ToyEngine
+{
+	//一个完成的区间，name必须是静态字符串，只保存指针
+	struct ProfileEvent
+	{
+		const char* name{ nullptr };
+		uint64_t beginNs{ 0 };
+		uint64_t endNs{ 0 };	//与beginNs相同表示瞬时事件(帧标记)
+	};
+
+	/**
+	 * CpuProfiler
+	 * 	每个线程第一次记录时创建自己的环形buffer，之后只由这个线程写入，写入不加锁
+	 * 	写满后覆盖最旧的事件，只保留每个线程最近CAPACITY个区间
+	 * 	区间在结束时一次写入(Chrome trace的complete事件)，帧标记是一个瞬时事件
+	 * 	导出为Chrome trace event格式，可以在chrome://tracing或Perfetto中打开
+	 * 	导出时读取其他线程正在写的buffer，最新的少量事件可能不完整，通常在退出时导出
+	 */
+	class CpuProfiler
+	{
+	 public:
+		static constexpr uint32_t CAPACITY = 1 << 16;
+
+		static uint64_t now()
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		static void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+		static void frameMark();
+
+		//在导出的trace中显示的线程名
+		static void setThreadName(const std::string& name);
+
+		[[nodiscard]] static uint64_t getFrameCount();
+
+		static bool exportChromeTrace(const std::string& path);
+	};
+
+	class ProfileZone
+	{
+	 public:
+		explicit ProfileZone(const char* name)
+			: m_name(name), m_begin(CpuProfiler::now())
+		{
+		}
+
+		~ProfileZone()
+		{
+			CpuProfiler::record(m_name, m_begin, CpuProfiler::now());
+		}
+
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+
+	 private:
+		const char* m_name;
+		uint64_t m_begin;
+	};
+
+} // ToyEngine
+
+#define TOY_PROFILE_CONCAT_INNER(a, b) a##b
+#define TOY_PROFILE_CONCAT(a, b) TOY_PROFILE_CONCAT_INNER(a, b)
+
+#if TOY_PROFILE
+#define TOY_PROFILE_ZONE(name) ::ToyEngine::ProfileZone TOY_PROFILE_CONCAT(toyProfileZone, __LINE__)(name)
+#define TOY_PROFILE_FUNCTION() TOY_PROFILE_ZONE(__func__)
+#define TOY_PROFILE_FRAME() ::ToyEngine::CpuProfiler::frameMark()
+#define TOY_PROFILE_THREAD(name) ::ToyEngine::CpuProfiler::setThreadName(name)
+#define TOY_PROFILE_EXPORT(path) ::ToyEngine::CpuProfiler::exportChromeTrace(path)
+#else
+#define TOY_PROFILE_ZONE(name) ((void)0)
+#define TOY_PROFILE_FUNCTION() ((void)0)
+#define TOY_PROFILE_FRAME() ((void)0)
+#define TOY_PROFILE_THREAD(name) ((void)0)
+#define TOY_PROFILE_EXPORT(path) ((void)0)
+#endif
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "base.h"
+#include "commandBuffer.h"
+#include <atomic>
+
+namespace ToyEngine
+{
+	/**
+	 * DrawKey
+	 * 	64位排序key，从高到低依次比较，最高4位为pass，次高位区分不透明(0)和半透明(1)
+	 * 	不透明：pipeline(11位) | material(12位) | 深度(16位，从前到后) | texture(20位)，状态切换最少，同状态内early-Z
+	 * 	半透明：深度(16位，从后到前) | pipeline(11位) | material(12位) | texture(20位)，正确混合优先
+	 * 	texture在最低位：bindless下纹理不会切分批次，只是为了采样的局部性
+	 */
+	struct DrawKey
+	{
+		static uint64_t opaque(uint32_t pass, uint32_t pipeline, uint32_t material, float depth, uint32_t texture);
+
+		static uint64_t transparent(uint32_t pass, uint32_t pipeline, uint32_t material, float depth, uint32_t texture);
+
+		static uint32_t getPass(uint64_t key)
+		{
+			return static_cast<uint32_t>(key >> 60);
+		}
+	};
+
+	//一次draw需要的全部状态，POD，提交时整体拷贝进DrawStream
+	struct DrawCommand
+	{
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+		VkPipelineLayout layout{ VK_NULL_HANDLE };
+
+		//set 0，为空时不绑定；最多一个dynamic offset(FrameUniformAllocator)
+		VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+		uint32_t dynamicOffsetCount{ 0 };
+		uint32_t dynamicOffset{ 0 };
+
+		VkBuffer vertexBuffer{ VK_NULL_HANDLE };
+		VkDeviceSize vertexOffset{ 0 };
+
+		//为空时是非indexed draw
+		VkBuffer indexBuffer{ VK_NULL_HANDLE };
+		VkDeviceSize indexOffset{ 0 };
+		VkIndexType indexType{ VK_INDEX_TYPE_UINT16 };
+
+		//push constant的内容在submit时拷贝到DrawStream的数据区，pushConstantOffset由submit填写
+		VkShaderStageFlags pushConstantStages{ 0 };
+		uint32_t pushConstantSize{ 0 };
+		uint32_t pushConstantOffset{ 0 };
+
+		//indexed draw时vertexCount为index数量，firstVertex为firstIndex，baseVertex加到每个index上
+		uint32_t vertexCount{ 0 };
+		uint32_t instanceCount{ 1 };
+		uint32_t firstVertex{ 0 };
+		int32_t baseVertex{ 0 };
+		uint32_t firstInstance{ 0 };
+	};
+	static_assert(std::is_trivially_copyable_v<DrawCommand>, "DrawCommand must be trivially copyable.");
+
+	struct DrawStreamStats
+	{
+		uint32_t submitted{ 0 };
+		uint32_t dropped{ 0 };		//命令或数据区已满时被丢弃的命令
+		uint32_t draws{ 0 };		//execute实际录制的draw
+		uint32_t merged{ 0 };		//实例区间相连、状态相同而被合并进前一个draw的命令
+	};
+
+	/**
+	 * DrawStream
+	 * 	CPU侧的延迟命令流：命令和push constant数据放在reset时清空的定长数组里，每帧不再分配内存
+	 * 	submit只做一次原子加法占位，任意线程、任意顺序提交都可以
+	 * 	sort按DrawKey基数排序，execute按pass依次翻译成CommandBuffer调用
+	 * 	重复的状态绑定由CommandBuffer过滤，状态相同且实例相连的draw在这里合并
+	 * 	submit与reset/sort/execute之间需要外部同步(例如JobSystem::wait)
+	 */
+	class DrawStream;
+	using DrawStreamPtr = std::shared_ptr<DrawStream>;
+	class DrawStream
+	{
+	 public:
+		static DrawStreamPtr create(uint32_t maxCommands, uint32_t maxDataBytes = 64 * 1024);
+
+		DrawStream(uint32_t maxCommands, uint32_t maxDataBytes = 64 * 1024);
+
+		~DrawStream() = default;
+
+		DrawStream(const DrawStream&) = delete;
+		DrawStream& operator=(const DrawStream&) = delete;
+
+		void reset();
+
+		//pushConstants为空时command.pushConstantSize必须为0，容量不足时返回false
+		bool submit(uint64_t key, const DrawCommand& command, const void* pushConstants = nullptr);
+
+		template<typename T>
+		bool submit(uint64_t key, DrawCommand command, const T& pushConstants)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Push constant data must be trivially copyable.");
+			static_assert(sizeof(T) <= CommandBuffer::MAX_PUSH_CONSTANT_SIZE, "Push constant block is larger than 128 bytes.");
+			command.pushConstantSize = static_cast<uint32_t>(sizeof(T));
+			return submit(key, command, static_cast<const void*>(&pushConstants));
+		}
+
+		void sort();
+
+		//录制一个pass的全部命令，需要在sort之后、对应的renderpass内调用
+		void execute(const CommandBufferPtr& commandBuffer, uint32_t pass);
+
+		[[nodiscard]] size_t size() const
+		{
+			return std::min<size_t>(m_commandCount.load(std::memory_order_acquire), m_commands.size());
+		}
+
+		//sort之后按排序结果访问
+		[[nodiscard]] uint64_t getSortedKey(size_t i) const
+		{
+			return m_sortItems[i].key;
+		}
+
+		[[nodiscard]] const DrawCommand& getSortedCommand(size_t i) const
+		{
+			return m_commands[m_sortItems[i].index];
+		}
+
+		//reset时清零
+		[[nodiscard]] DrawStreamStats getStats() const;
+
+	 private:
+		struct SortItem
+		{
+			uint64_t key;
+			uint32_t index;
+		};
+
+		//两个命令除draw参数外的状态是否完全相同
+		[[nodiscard]] bool sameState(const DrawCommand& a, const DrawCommand& b) const;
+
+		void record(const CommandBufferPtr& commandBuffer, const DrawCommand& command);
+
+	 private:
+		std::vector<DrawCommand> m_commands;
+		std::vector<SortItem> m_sortItems;
+		std::vector<SortItem> m_sortScratch;
+		std::vector<uint8_t> m_data;
+
+		std::atomic<uint32_t> m_commandCount{ 0 };
+		std::atomic<uint32_t> m_dataHead{ 0 };
+		std::atomic<uint32_t> m_dropped{ 0 };
+
+		uint32_t m_draws{ 0 };
+		uint32_t m_merged{ 0 };
+	};
+
+} // ToyEngine
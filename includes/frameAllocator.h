@@ -0,0 +1,90 @@
+#pragma once
+
+#include "base.h"
+#include "context.h"
+#include "buffer.h"
+
+namespace ToyEngine
+{
+	/**
+	 * 每帧的uniform线性分配器
+	 * 	一块持久映射的HOST_VISIBLE buffer按帧切成framesInFlight段，每帧从自己的段里顺序分配
+	 * 	descriptor set只有一个UNIFORM_BUFFER_DYNAMIC绑定，整个生命周期只写一次
+	 * 	每次draw通过dynamic offset指向本次分配的位置，不需要新的set，也不需要vkCmdUpdateBuffer
+	 * 	128字节以内的数据优先使用push constant，超过的再走这里
+	 */
+	struct FrameAllocation
+	{
+		void* data{ nullptr };
+		uint32_t offset{ 0 };
+	};
+
+	class FrameUniformAllocator;
+	using FrameUniformAllocatorPtr = std::shared_ptr<FrameUniformAllocator>;
+	class FrameUniformAllocator
+	{
+	 public:
+		static FrameUniformAllocatorPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			VkDeviceSize bytesPerFrame,
+			uint32_t framesInFlight,
+			uint32_t maxAllocationSize = 4096);
+
+		FrameUniformAllocator(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			VkDeviceSize bytesPerFrame,
+			uint32_t framesInFlight,
+			uint32_t maxAllocationSize = 4096);
+
+		~FrameUniformAllocator();
+
+		//切换到frameIndex对应的段并清空，调用前需要保证这一帧的fence已经等待完成
+		void beginFrame(uint32_t frameIndex);
+
+		FrameAllocation allocate(uint32_t size);
+
+		//拷贝一份数据并返回对应的dynamic offset
+		template<typename T>
+		uint32_t push(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Uniform data must be trivially copyable.");
+			FrameAllocation allocation = allocate(static_cast<uint32_t>(sizeof(T)));
+			memcpy(allocation.data, &value, sizeof(T));
+			return allocation.offset;
+		}
+
+		[[nodiscard]] VkDescriptorSetLayout getDescriptorSetLayout() const
+		{
+			return m_setLayout;
+		}
+
+		[[nodiscard]] VkDescriptorSet getDescriptorSet() const
+		{
+			return m_descriptorSet;
+		}
+
+		[[nodiscard]] VkDeviceSize getUsedBytes() const
+		{
+			return m_head - m_frameBegin;
+		}
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		BufferPtr m_buffer{ nullptr };
+		uint8_t* m_mapped{ nullptr };
+
+		VkDescriptorSetLayout m_setLayout{ VK_NULL_HANDLE };
+		VkDescriptorPool m_descriptorPool{ VK_NULL_HANDLE };
+		VkDescriptorSet m_descriptorSet{ VK_NULL_HANDLE };
+
+		VkDeviceSize m_alignment{ 256 };
+		VkDeviceSize m_bytesPerFrame{ 0 };
+		uint32_t m_framesInFlight{ 1 };
+		uint32_t m_maxAllocationSize{ 0 };
+
+		VkDeviceSize m_frameBegin{ 0 };
+		VkDeviceSize m_frameEnd{ 0 };
+		VkDeviceSize m_head{ 0 };
+	};
+
+} // ToyEngine
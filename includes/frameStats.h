@@ -0,0 +1,189 @@
+#pragma once
+
+#include "base.h"
+#include "commandBuffer.h"
+#include <chrono>
+
+namespace ToyEngine
+{
+	//一帧中单独计时的CPU阶段，用于定位卡顿发生在哪一步
+	enum class FrameStage : uint32_t
+	{
+		FenceWait = 0,	//等待飞行帧的fence，GPU跟不上时变长
+		Acquire,		//vkAcquireNextImageKHR，交换链没有空闲图像时变长
+		Record,			//录制命令缓冲
+		Submit,			//vkQueueSubmit
+		Present,		//vkQueuePresentKHR，FIFO下可能阻塞到垂直同步
+		PacketWait,		//渲染线程等待主线程的FramePacket，主线程跟不上时变长
+		Count
+	};
+
+	const char* toString(FrameStage stage);
+
+	//一帧的记录，时间单位毫秒
+	struct FrameRecord
+	{
+		uint64_t frameIndex{ 0 };
+		double frameMs{ 0.0 };			//与上一帧结束之间的间隔，第一帧为自身的耗时
+		double stageMs[static_cast<uint32_t>(FrameStage::Count)]{};
+		uint32_t draws{ 0 };
+		uint32_t pipelineBinds{ 0 };
+		uint32_t descriptorBinds{ 0 };
+		uint32_t elidedCalls{ 0 };		//CommandBuffer过滤掉的重复状态设置
+		uint64_t uploadBytes{ 0 };
+	};
+
+	//窗口内某一项耗时的分布，百分位精确到直方图的一个桶
+	struct TimingSummary
+	{
+		double avgMs{ 0.0 };
+		double maxMs{ 0.0 };
+		double p50Ms{ 0.0 };
+		double p95Ms{ 0.0 };
+		double p99Ms{ 0.0 };
+	};
+
+	struct FrameStatsSummary
+	{
+		uint32_t sampleCount{ 0 };
+		TimingSummary frame{};
+		TimingSummary stages[static_cast<uint32_t>(FrameStage::Count)]{};
+		double avgDraws{ 0.0 };
+		double avgPipelineBinds{ 0.0 };
+		double avgDescriptorBinds{ 0.0 };
+		double avgElidedCalls{ 0.0 };
+		double avgUploadBytes{ 0.0 };
+	};
+
+	/**
+	 * FrameStats
+	 * 	每帧beginFrame/endFrame之间用beginStage/endStage(或FrameStageTimer)记录各阶段的CPU耗时，
+	 * 	用addCommandStats/addUploadBytes累加这一帧的计数
+	 * 	最近WINDOW_SIZE帧保存在环形数组中，帧时间和每个阶段各有一个滚动直方图：
+	 * 	新样本进入时对应的桶加一，被挤出窗口的样本对应的桶减一，查询百分位只需要扫描一遍桶
+	 * 	桶宽BUCKET_MS，超过上限的样本落在最后一个桶，百分位最多报告到上限，最大值仍然精确
+	 * 	退出时用writeCsv导出窗口内的每帧记录，writeJson导出汇总和帧时间直方图
+	 */
+	class FrameStats;
+	using FrameStatsPtr = std::shared_ptr<FrameStats>;
+	class FrameStats
+	{
+	 public:
+		static constexpr uint32_t WINDOW_SIZE = 1024;
+		static constexpr double BUCKET_MS = 0.1;
+		static constexpr uint32_t BUCKET_COUNT = 1000;	//覆盖0 - 100ms
+		static constexpr uint32_t STAGE_COUNT = static_cast<uint32_t>(FrameStage::Count);
+
+		static FrameStatsPtr create();
+
+		FrameStats();
+
+		~FrameStats() = default;
+
+		void beginFrame();
+
+		void endFrame();
+
+		void beginStage(FrameStage stage);
+
+		void endStage(FrameStage stage);
+
+		void addCommandStats(const CommandBufferStats& stats);
+
+		void addUploadBytes(uint64_t bytes);
+
+		[[nodiscard]] uint64_t getFrameCount() const
+		{
+			return m_frameCount;
+		}
+
+		//最近完成的一帧，还没有完成的帧时返回空记录
+		[[nodiscard]] FrameRecord getLastFrame() const;
+
+		//窗口内的记录，从旧到新
+		[[nodiscard]] std::vector<FrameRecord> getHistory() const;
+
+		[[nodiscard]] FrameStatsSummary getSummary() const;
+
+		//percentile取值0 - 100
+		[[nodiscard]] double getFramePercentile(double percentile) const;
+
+		[[nodiscard]] double getStagePercentile(FrameStage stage, double percentile) const;
+
+		bool writeCsv(const std::string& path) const;
+
+		bool writeJson(const std::string& path) const;
+
+	 private:
+		using Clock = std::chrono::steady_clock;
+
+		//滚动直方图，与环形数组中的样本一一对应
+		struct Histogram
+		{
+			std::vector<uint32_t> buckets = std::vector<uint32_t>(BUCKET_COUNT, 0);
+			uint32_t count{ 0 };
+
+			void add(double ms);
+
+			void remove(double ms);
+
+			[[nodiscard]] double percentile(double p) const;
+		};
+
+		//指标0为帧时间，1 + i为第i个阶段
+		static constexpr uint32_t METRIC_COUNT = STAGE_COUNT + 1;
+
+		static double getMetric(const FrameRecord& record, uint32_t metric);
+
+		static uint32_t toBucket(double ms);
+
+		static double elapsedMs(Clock::time_point begin, Clock::time_point end);
+
+		[[nodiscard]] TimingSummary summarize(uint32_t metric) const;
+
+	 private:
+		std::vector<FrameRecord> m_records;
+		uint32_t m_next{ 0 };
+		uint32_t m_count{ 0 };
+		uint64_t m_frameCount{ 0 };
+
+		Histogram m_histograms[METRIC_COUNT]{};
+
+		//正在记录的帧
+		FrameRecord m_current{};
+		bool m_inFrame{ false };
+		Clock::time_point m_frameBegin{};
+		Clock::time_point m_lastFrameEnd{};
+		Clock::time_point m_stageBegin[STAGE_COUNT]{};
+	};
+
+	//RAII阶段计时，stats为空时不做任何事
+	class FrameStageTimer
+	{
+	 public:
+		FrameStageTimer(const FrameStatsPtr& stats, FrameStage stage)
+			: m_stats(stats.get()), m_stage(stage)
+		{
+			if (m_stats != nullptr)
+			{
+				m_stats->beginStage(m_stage);
+			}
+		}
+
+		~FrameStageTimer()
+		{
+			if (m_stats != nullptr)
+			{
+				m_stats->endStage(m_stage);
+			}
+		}
+
+		FrameStageTimer(const FrameStageTimer&) = delete;
+		FrameStageTimer& operator=(const FrameStageTimer&) = delete;
+
+	 private:
+		FrameStats* m_stats{ nullptr };
+		FrameStage m_stage;
+	};
+
+} // ToyEngine
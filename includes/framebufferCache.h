@@ -0,0 +1,70 @@
+#pragma once
+
+#include "base.h"
+#include <unordered_map>
+
+namespace ToyEngine
+{
+	/**
+	 * FramebufferCache
+	 * 	按(renderpass, 图像视图, 尺寸)去重，每种组合只创建一次framebuffer
+	 * 	视图销毁之前(交换链重建、临时纹理重新分配)必须调用evictViews，
+	 * 	引用这些视图的framebuffer从缓存中移除，保留到使用它们的帧全部执行完再销毁
+	 */
+	class FramebufferCache;
+	using FramebufferCachePtr = std::shared_ptr<FramebufferCache>;
+	class FramebufferCache
+	{
+	 public:
+		static FramebufferCachePtr create(const VkDevice& device, uint32_t framesInFlight);
+
+		FramebufferCache(const VkDevice& device, uint32_t framesInFlight);
+
+		~FramebufferCache();
+
+		VkFramebuffer get(VkRenderPass renderPass, const std::vector<VkImageView>& views, VkExtent2D extent);
+
+		void evictViews(const std::vector<VkImageView>& views);
+
+		//每帧在fence等待之后调用，销毁已经没有帧使用的framebuffer
+		void nextFrame();
+
+		[[nodiscard]] size_t getFramebufferCount() const
+		{
+			return m_framebuffers.size();
+		}
+
+	 private:
+		struct FramebufferKey
+		{
+			VkRenderPass renderPass{ VK_NULL_HANDLE };
+			std::vector<VkImageView> views;
+			uint32_t width{ 0 };
+			uint32_t height{ 0 };
+
+			bool operator==(const FramebufferKey& other) const
+			{
+				return renderPass == other.renderPass && views == other.views
+					   && width == other.width && height == other.height;
+			}
+		};
+
+		struct FramebufferKeyHash
+		{
+			size_t operator()(const FramebufferKey& key) const;
+		};
+
+		struct RetiredFramebuffer
+		{
+			VkFramebuffer framebuffer;
+			uint32_t framesLeft;
+		};
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		uint32_t m_framesInFlight{ 1 };
+		std::unordered_map<FramebufferKey, VkFramebuffer, FramebufferKeyHash> m_framebuffers;
+		std::vector<RetiredFramebuffer> m_retired;
+	};
+
+} // ToyEngine
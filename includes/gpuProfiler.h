@@ -0,0 +1,142 @@
+#pragma once
+
+#include "base.h"
+#include "context.h"
+#include "commandBuffer.h"
+#include <unordered_map>
+
+namespace ToyEngine
+{
+	//一个作用域在最近若干帧内的GPU耗时，单位毫秒
+	struct GpuScopeStats
+	{
+		std::string name;
+		double lastMs{ 0.0 };
+		double minMs{ 0.0 };
+		double avgMs{ 0.0 };
+		double maxMs{ 0.0 };
+		uint32_t sampleCount{ 0 };
+	};
+
+	/**
+	 * GpuProfiler
+	 * 	每个飞行帧一个timestamp query pool，作用域开始和结束各写一个timestamp
+	 * 	beginFrame在这一帧的fence等待之后调用：先读回同一个pool上一次(framesInFlight帧之前)的结果，再重置pool
+	 * 	读回时GPU早已执行完，不会等待；结果按timestampPeriod换算，并只保留timestampValidBits有效的位
+	 * 	每个作用域按名字保留最近WINDOW_SIZE帧的样本，统计最小/平均/最大值
+	 * 	队列不支持timestamp时所有接口为空操作
+	 */
+	class GpuProfiler;
+	using GpuProfilerPtr = std::shared_ptr<GpuProfiler>;
+	class GpuProfiler
+	{
+	 public:
+		static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+		static constexpr uint32_t WINDOW_SIZE = 120;
+
+		static GpuProfilerPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			uint32_t queueFamilyIndex,
+			uint32_t framesInFlight,
+			uint32_t maxScopesPerFrame = 64);
+
+		GpuProfiler(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			uint32_t queueFamilyIndex,
+			uint32_t framesInFlight,
+			uint32_t maxScopesPerFrame);
+
+		~GpuProfiler();
+
+		//必须在renderpass之外录制，通常紧跟在commandBuffer->begin()之后
+		void beginFrame(const CommandBufferPtr& commandBuffer, uint32_t frameIndex);
+
+		//返回的下标传给endScope，超过每帧上限时返回INVALID_SCOPE
+		uint32_t beginScope(const CommandBufferPtr& commandBuffer, const std::string& name);
+
+		void endScope(const CommandBufferPtr& commandBuffer, uint32_t scope);
+
+		[[nodiscard]] bool isSupported() const
+		{
+			return m_supported;
+		}
+
+		//按第一次出现的顺序
+		[[nodiscard]] std::vector<GpuScopeStats> getStats() const;
+
+		[[nodiscard]] bool getStats(const std::string& name, GpuScopeStats& stats) const;
+
+	 private:
+		struct FrameScope
+		{
+			uint32_t nameId;
+			uint32_t query;		//开始的query，结束为query + 1
+			bool closed;
+		};
+
+		struct Frame
+		{
+			VkQueryPool queryPool{ VK_NULL_HANDLE };
+			std::vector<FrameScope> scopes;
+			uint32_t queryCount{ 0 };
+		};
+
+		//固定大小的环形样本
+		struct ScopeHistory
+		{
+			std::string name;
+			double samples[WINDOW_SIZE]{};
+			uint32_t next{ 0 };
+			uint32_t count{ 0 };
+		};
+
+		void collect(Frame& frame);
+
+		[[nodiscard]] GpuScopeStats summarize(const ScopeHistory& history) const;
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		bool m_supported{ false };
+		double m_timestampPeriod{ 1.0 };	//每个tick的纳秒数
+		uint64_t m_timestampMask{ ~0ull };
+		uint32_t m_maxScopes{ 0 };
+
+		std::vector<Frame> m_frames;
+		Frame* m_currentFrame{ nullptr };
+		std::vector<uint64_t> m_results;
+
+		std::unordered_map<std::string, uint32_t> m_nameIds;
+		std::vector<ScopeHistory> m_histories;
+	};
+
+	//RAII作用域，profiler为空时不做任何事
+	class GpuScope
+	{
+	 public:
+		GpuScope(const GpuProfilerPtr& profiler, const CommandBufferPtr& commandBuffer, const std::string& name)
+			: m_profiler(profiler.get()), m_commandBuffer(commandBuffer)
+		{
+			if (m_profiler != nullptr)
+			{
+				m_scope = m_profiler->beginScope(m_commandBuffer, name);
+			}
+		}
+
+		~GpuScope()
+		{
+			if (m_profiler != nullptr)
+			{
+				m_profiler->endScope(m_commandBuffer, m_scope);
+			}
+		}
+
+		GpuScope(const GpuScope&) = delete;
+		GpuScope& operator=(const GpuScope&) = delete;
+
+	 private:
+		GpuProfiler* m_profiler{ nullptr };
+		const CommandBufferPtr& m_commandBuffer;
+		uint32_t m_scope{ GpuProfiler::INVALID_SCOPE };
+	};
+
+} // ToyEngine
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "base.h"
+#include "commandBuffer.h"
+
+namespace ToyEngine
+{
+	//纹素块信息，非压缩格式的块为1x1
+	struct FormatBlockInfo
+	{
+		uint32_t blockWidth{ 1 };
+		uint32_t blockHeight{ 1 };
+		uint32_t bytesPerBlock{ 0 };	//0表示未知格式
+	};
+
+	FormatBlockInfo getFormatBlockInfo(VkFormat format);
+
+	//深度/模板格式返回对应的DEPTH/STENCIL位，其余为COLOR
+	VkImageAspectFlags getFormatAspect(VkFormat format);
+
+	//UINT/SINT颜色格式，不能线性过滤，多重采样resolve只能取SAMPLE_ZERO
+	bool isIntegerFormat(VkFormat format);
+
+	//不超过requested的、颜色和深度附件都支持的最大采样数
+	VkSampleCountFlagBits clampSampleCount(VkPhysicalDevice physicalDevice, VkSampleCountFlagBits requested);
+
+	//按精度从高到低选择支持作为optimal tiling深度附件的格式，找不到时抛出异常
+	VkFormat findDepthFormat(VkPhysicalDevice physicalDevice, bool requireStencil = false);
+
+	//找不到时返回false
+	bool tryFindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties,
+		uint32_t& index);
+
+	uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+	struct ImageDesc
+	{
+		uint32_t width{ 1 };
+		uint32_t height{ 1 };
+		uint32_t mipLevels{ 1 };	//0表示完整的mip链
+		uint32_t arrayLayers{ 1 };
+		VkFormat format{ VK_FORMAT_R8G8B8A8_UNORM };
+		VkImageUsageFlags usage{ VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+		//bindless表中的纹理统一按sampler2DArray访问，默认创建数组视图
+		VkImageViewType viewType{ VK_IMAGE_VIEW_TYPE_2D_ARRAY };
+		VkSampleCountFlagBits samples{ VK_SAMPLE_COUNT_1_BIT };
+		VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+		VkMemoryPropertyFlags memoryProperties{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+	};
+
+	/**
+	 * Image
+	 * 	一个VkImage + 独占的一块内存 + 覆盖全部mip和层的视图
+	 * 	记录整张图当前的布局，transition生成barrier并更新记录，调用者把多个barrier合并到一次pipelineBarrier
+	 * 	数据上传见ImageUploader，采样器见SamplerCache，Image本身不持有sampler
+	 */
+	class Image;
+	using ImagePtr = std::shared_ptr<Image>;
+	class Image
+	{
+	 public:
+		static ImagePtr create(const VkDevice& device, VkPhysicalDevice const& physicalDevice, const ImageDesc& desc);
+
+		Image(const VkDevice& device, VkPhysicalDevice const& physicalDevice, const ImageDesc& desc,
+			bool allocateMemory = true);
+
+		//只创建VkImage，不分配内存也不创建视图，由调用者通过bindMemory绑定到共享的内存上(内存别名)
+		static ImagePtr createUnbound(const VkDevice& device, VkPhysicalDevice const& physicalDevice, const ImageDesc& desc);
+
+		[[nodiscard]] VkMemoryRequirements getMemoryRequirements() const;
+
+		//绑定外部内存并创建视图，内存由调用者持有
+		void bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+
+		~Image();
+
+		static uint32_t calculateMipLevels(uint32_t width, uint32_t height);
+
+		//某一级mip所有层紧密排列时的字节数，未知格式返回0
+		[[nodiscard]] VkDeviceSize getLevelSize(uint32_t mipLevel) const;
+
+		[[nodiscard]] uint32_t getLevelWidth(uint32_t mipLevel) const
+		{
+			return std::max(m_desc.width >> mipLevel, 1u);
+		}
+
+		[[nodiscard]] uint32_t getLevelHeight(uint32_t mipLevel) const
+		{
+			return std::max(m_desc.height >> mipLevel, 1u);
+		}
+
+		//整张图从当前布局转换到newLayout
+		VkImageMemoryBarrier transition(VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess);
+
+		//只描述部分mip的转换，不修改记录的布局
+		[[nodiscard]] VkImageMemoryBarrier makeBarrier(VkImageLayout oldLayout,
+			VkImageLayout newLayout,
+			VkAccessFlags srcAccess,
+			VkAccessFlags dstAccess,
+			uint32_t baseMipLevel,
+			uint32_t levelCount) const;
+
+		/**
+		 * 用vkCmdBlitImage逐级生成mip，多张图按级别交错录制，每一级只需要一次barrier
+		 * 要求：所有mip处于TRANSFER_DST，第0级已经写入；结束后整张图处于SHADER_READ_ONLY
+		 * 格式不支持blit的图只做布局转换(例如压缩格式，应当由文件提供完整mip链)
+		 */
+		static void generateMips(const CommandBufferPtr& commandBuffer, const std::vector<ImagePtr>& images);
+
+		[[nodiscard]] VkImage getImage() const
+		{
+			return m_image;
+		}
+
+		[[nodiscard]] VkImageView getImageView() const
+		{
+			return m_imageView;
+		}
+
+		[[nodiscard]] VkFormat getFormat() const
+		{
+			return m_desc.format;
+		}
+
+		[[nodiscard]] uint32_t getWidth() const
+		{
+			return m_desc.width;
+		}
+
+		[[nodiscard]] uint32_t getHeight() const
+		{
+			return m_desc.height;
+		}
+
+		[[nodiscard]] uint32_t getMipLevels() const
+		{
+			return m_desc.mipLevels;
+		}
+
+		[[nodiscard]] uint32_t getArrayLayers() const
+		{
+			return m_desc.arrayLayers;
+		}
+
+		[[nodiscard]] VkImageAspectFlags getAspect() const
+		{
+			return m_desc.aspect;
+		}
+
+		[[nodiscard]] VkImageLayout getLayout() const
+		{
+			return m_layout;
+		}
+
+		void setLayout(VkImageLayout layout)
+		{
+			m_layout = layout;
+		}
+
+		[[nodiscard]] VkDeviceSize getMemorySize() const
+		{
+			return m_memorySize;
+		}
+
+	 private:
+		void createImageView();
+
+		//返回blit可用的过滤方式，完全不支持blit时返回false
+		bool getBlitFilter(VkFilter& filter) const;
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+		ImageDesc m_desc{};
+
+		VkImage m_image{ VK_NULL_HANDLE };
+		VkDeviceMemory m_imageMemory{ VK_NULL_HANDLE };
+		bool m_ownsMemory{ true };
+		VkImageView m_imageView{ VK_NULL_HANDLE };
+		VkDeviceSize m_memorySize{ 0 };
+		VkImageLayout m_layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+	};
+
+} // ToyEngine
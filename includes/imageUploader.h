@@ -0,0 +1,78 @@
+#pragma once
+
+#include "base.h"
+#include "buffer.h"
+#include "image.h"
+#include "commandBuffer.h"
+
+namespace ToyEngine
+{
+	/**
+	 * ImageUploader
+	 * 	收集多张图像的上传请求，一次录制、一次提交：
+	 * 	所有数据打包进一个staging buffer -> 一次barrier把所有图转为TRANSFER_DST -> 每张图一次vkCmdCopyBufferToImage
+	 * 	-> Image::generateMips按级别批量blit -> 一次barrier全部转为SHADER_READ_ONLY
+	 * 	加载关卡时把所有纹理enqueue后调用一次flush，而不是每张纹理各自提交、各自等待
+	 */
+	class ImageUploader;
+	using ImageUploaderPtr = std::shared_ptr<ImageUploader>;
+	class ImageUploader
+	{
+	 public:
+		static ImageUploaderPtr create(const VkDevice& device, VkPhysicalDevice const& physicalDevice);
+
+		ImageUploader(const VkDevice& device, VkPhysicalDevice const& physicalDevice);
+
+		~ImageUploader() = default;
+
+		//上传第0级(所有层紧密排列)，generateMips为true时其余级别由GPU生成
+		void enqueue(const ImagePtr& image, const void* data, size_t size, bool generateMips = true);
+
+		//直接上传某一级mip，用于自带mip链的文件，不会再生成mip
+		void enqueueLevel(const ImagePtr& image, uint32_t mipLevel, const void* data, size_t size);
+
+		//录制所有上传命令，返回的staging buffer需要保留到命令执行完成
+		BufferPtr record(const CommandBufferPtr& commandBuffer);
+
+		//单独提交并等待完成
+		void flush();
+
+		[[nodiscard]] bool empty() const
+		{
+			return m_copies.empty();
+		}
+
+		[[nodiscard]] size_t getPendingBytes() const
+		{
+			return m_data.size();
+		}
+
+	 private:
+		struct PendingCopy
+		{
+			uint32_t imageSlot;
+			uint32_t mipLevel;
+			size_t offset;
+		};
+
+		struct PendingImage
+		{
+			ImagePtr image;
+			bool generateMips;
+		};
+
+		uint32_t findOrAddImage(const ImagePtr& image, bool generateMips);
+
+		void append(const ImagePtr& image, uint32_t mipLevel, const void* data, size_t size, bool generateMips);
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+		VkDeviceSize m_offsetAlignment{ 16 };
+
+		std::vector<uint8_t> m_data;
+		std::vector<PendingCopy> m_copies;
+		std::vector<PendingImage> m_images;
+	};
+
+} // ToyEngine
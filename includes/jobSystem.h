@@ -0,0 +1,190 @@
+#pragma once
+
+#include "base.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <thread>
+#include <type_traits>
+
+namespace ToyEngine
+{
+	//一组任务的完成计数，submit时加一，任务执行完后减一，归零表示全部完成
+	//任务之间的依赖用计数器表达：后续任务在提交前(或在任务中)wait前置任务的计数器
+	class JobCounter
+	{
+	 public:
+		JobCounter() = default;
+
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		[[nodiscard]] bool isDone() const
+		{
+			return m_value.load(std::memory_order_acquire) == 0;
+		}
+
+	 private:
+		friend class JobSystem;
+
+		std::atomic<uint32_t> m_value{ 0 };
+	};
+
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter{ nullptr };
+	};
+
+	/**
+	 * WorkStealingDeque
+	 * 	Chase-Lev双端队列(按Lê等人的C11内存序版本实现)，容量固定的环形数组
+	 * 	所属的工作线程在bottom端push/pop，其它线程在top端steal，只有队列剩最后一个元素时才需要CAS
+	 * 	队列满时push返回false，由调用方直接执行该任务
+	 */
+	class WorkStealingDeque
+	{
+	 public:
+		static constexpr int64_t CAPACITY = 4096;
+
+		WorkStealingDeque();
+
+		~WorkStealingDeque() = default;
+
+		//只能由所属线程调用
+		bool push(Job* job);
+
+		//只能由所属线程调用，为空时返回nullptr
+		Job* pop();
+
+		//任意线程调用，为空或与其它线程竞争失败时返回nullptr
+		Job* steal();
+
+	 private:
+		alignas(64) std::atomic<int64_t> m_top{ 0 };
+		alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+		std::vector<std::atomic<Job*>> m_buffer;
+	};
+
+	/**
+	 * JobSystem
+	 * 	每个工作线程一个WorkStealingDeque：工作线程提交的任务放进自己的队列，
+	 * 	其它线程(主线程、加载线程)提交的任务放进一个加锁的公共队列
+	 * 	工作线程依次从自己的队列、公共队列、随机的其它队列取任务，都取不到时短暂让出后休眠
+	 * 	wait不会阻塞调用线程：计数器归零之前调用线程也执行任务，因此在任务中wait也不会死锁
+	 * 	getInstance返回全局实例，工作线程数默认为CPU线程数减一，可以用环境变量TOY2D_WORKERS指定
+	 */
+	class JobSystem;
+	using JobSystemPtr = std::shared_ptr<JobSystem>;
+	class JobSystem
+	{
+	 public:
+		using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+		static JobSystemPtr create(uint32_t workerCount);
+
+		static JobSystem& getInstance();
+
+		//workerCount为0时只有wait的线程会执行任务
+		explicit JobSystem(uint32_t workerCount);
+
+		//执行完所有已经提交的任务后退出工作线程
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		//任务中抛出的异常会被记录并吞掉，需要结果或异常时使用async
+		void submit(std::function<void()> function, JobCounter* counter = nullptr);
+
+		//计数器归零前在调用线程执行其它任务
+		void wait(const JobCounter& counter);
+
+		//future就绪前在调用线程执行其它任务，async返回的future需要用这个等待，否则没有工作线程时会一直阻塞
+		template<typename T>
+		void wait(const std::future<T>& future)
+		{
+			while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				if (!tryRunOne())
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		//[begin, end)递归二分，长度不超过grainSize的区间在一个任务中执行
+		//左半部分留在当前线程，右半部分提交出去，空闲线程通过窃取分担；第一个异常在返回前重新抛出
+		void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const RangeFunction& function);
+
+		//返回的future与std::async相同，但析构时不会等待任务完成
+		//没有工作线程时直接在调用线程执行，只轮询future的调用方也能拿到结果
+		template<typename Function>
+		std::future<std::invoke_result_t<std::decay_t<Function>>> async(Function&& function)
+		{
+			using Result = std::invoke_result_t<std::decay_t<Function>>;
+			auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+			auto future = task->get_future();
+			if (m_workers.empty())
+			{
+				(*task)();
+				return future;
+			}
+			submit([task]()
+			{
+			  (*task)();
+			});
+			return future;
+		}
+
+		[[nodiscard]] uint32_t getWorkerCount() const
+		{
+			return static_cast<uint32_t>(m_workers.size());
+		}
+
+	 private:
+		struct ParallelForState
+		{
+			ParallelForState(const RangeFunction& function, uint32_t grainSize)
+				: function(function), grainSize(grainSize)
+			{
+			}
+
+			const RangeFunction& function;
+			uint32_t grainSize;
+			JobCounter counter;
+			std::mutex errorMutex;
+			std::exception_ptr error;
+		};
+
+		void workerLoop(uint32_t index);
+
+		//当前线程是本系统的工作线程时返回它的序号，否则返回-1
+		[[nodiscard]] int32_t getWorkerIndex() const;
+
+		Job* findJob();
+
+		bool tryRunOne();
+
+		void execute(Job* job);
+
+		void runRange(ParallelForState& state, uint32_t begin, uint32_t end);
+
+	 private:
+		std::vector<std::unique_ptr<WorkStealingDeque>> m_deques;
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_injectMutex;
+		std::deque<Job*> m_injected;
+		std::atomic<int64_t> m_injectedCount{ 0 };
+
+		//已提交还没有被取走的任务数，工作线程据此决定是否休眠
+		std::atomic<int64_t> m_queued{ 0 };
+		std::atomic<uint32_t> m_sleeping{ 0 };
+		std::atomic<bool> m_stop{ false };
+		std::mutex m_sleepMutex;
+		std::condition_variable m_sleepCondition;
+	};
+
+} // ToyEngine
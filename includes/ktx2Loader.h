@@ -0,0 +1,147 @@
+#pragma once
+
+#include "base.h"
+#include "mappedFile.h"
+#include "image.h"
+#include "imageUploader.h"
+#include "samplerCache.h"
+#include "bindlessHeap.h"
+#include "textureDecoder.h"
+
+namespace ToyEngine
+{
+	/**
+	 * KTX2容器
+	 * 	文件通过mmap映射，头部和level索引直接从映射内存解析，每一级mip的数据指针指向映射内存，不做拷贝
+	 * 	只支持2D(可以是数组)、无超压缩(supercompressionScheme = 0)的文件
+	 */
+	class Ktx2File;
+	using Ktx2FilePtr = std::shared_ptr<Ktx2File>;
+	class Ktx2File
+	{
+	 public:
+		struct Level
+		{
+			const uint8_t* data{ nullptr };
+			size_t size{ 0 };
+		};
+
+		//解析失败时抛出异常
+		static Ktx2FilePtr open(const std::string& path);
+
+		explicit Ktx2File(const MappedFilePtr& file);
+
+		~Ktx2File() = default;
+
+		[[nodiscard]] VkFormat getFormat() const
+		{
+			return m_format;
+		}
+
+		[[nodiscard]] uint32_t getWidth() const
+		{
+			return m_width;
+		}
+
+		[[nodiscard]] uint32_t getHeight() const
+		{
+			return m_height;
+		}
+
+		[[nodiscard]] uint32_t getLayerCount() const
+		{
+			return m_layerCount;
+		}
+
+		//文件中实际存放的级别数，0表示需要运行时生成mip(文件中只有第0级)
+		[[nodiscard]] uint32_t getLevelCount() const
+		{
+			return m_levelCount;
+		}
+
+		[[nodiscard]] const Level& getLevel(uint32_t level) const
+		{
+			return m_levels[level];
+		}
+
+		[[nodiscard]] const std::string& getPath() const
+		{
+			return m_file->getPath();
+		}
+
+	 private:
+		MappedFilePtr m_file{ nullptr };
+		VkFormat m_format{ VK_FORMAT_UNDEFINED };
+		uint32_t m_width{ 0 };
+		uint32_t m_height{ 0 };
+		uint32_t m_layerCount{ 1 };
+		uint32_t m_levelCount{ 0 };
+		std::vector<Level> m_levels;
+	};
+
+	//按TextureLoader::getVariants的顺序选择变体：优先设备可直接采样的，其次可以CPU解码的，都没有时返回空
+	Ktx2FilePtr selectKtx2Variant(const std::string& basePath);
+
+	//读出某一级mip(所有层)到out，设备不支持文件格式时在调用线程上解码，format返回out中数据的格式
+	bool readKtx2Level(const Ktx2FilePtr& file, uint32_t level, VkFormat& format, std::vector<uint8_t>& out);
+
+	//加载完成的纹理，textureIndex为bindless下标
+	struct LoadedTexture
+	{
+		ImagePtr image{ nullptr };
+		uint32_t textureIndex{ BindlessHeap::INVALID_INDEX };
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		bool decodedOnCpu{ false };
+	};
+
+	/**
+	 * TextureLoader
+	 * 	资源管线为每张纹理输出多个压缩格式的KTX2变体：name.bc7.ktx2 / name.astc.ktx2 / name.etc2.ktx2 / name.bc3.ktx2 / name.bc1.ktx2 / name.ktx2
+	 * 	按getVariants的顺序选择第一个设备能直接采样的变体，各级mip原样上传，不做CPU解码
+	 * 	所有变体设备都不支持时，选择一个能在CPU上解码的变体(BC1/BC3/ETC2)，在工作线程中解码为RGBA8后上传
+	 * 	loadBatch中所有纹理的解析/解码并行进行，上传合并为一次提交
+	 */
+	class TextureLoader;
+	using TextureLoaderPtr = std::shared_ptr<TextureLoader>;
+	class TextureLoader
+	{
+	 public:
+		static TextureLoaderPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			const SamplerCachePtr& samplerCache);
+
+		TextureLoader(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			const SamplerCachePtr& samplerCache);
+
+		~TextureLoader() = default;
+
+		//basePath不带扩展名；找不到可用变体的纹理返回的image为空
+		std::vector<LoadedTexture> loadBatch(const std::vector<std::string>& basePaths);
+
+		LoadedTexture load(const std::string& basePath);
+
+		//按优先级排列的文件后缀
+		static const std::vector<std::string>& getVariants();
+
+	 private:
+		//工作线程的输出：选中的文件，以及需要CPU解码时解码后的各级数据
+		struct PreparedTexture
+		{
+			Ktx2FilePtr file{ nullptr };
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			std::vector<std::vector<uint8_t>> decodedLevels;
+		};
+
+		static PreparedTexture prepare(const std::string& basePath);
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+		BindlessHeapPtr m_bindlessHeap{ nullptr };
+		SamplerCachePtr m_samplerCache{ nullptr };
+	};
+
+} // ToyEngine
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ToyEngine
+{
+	/**
+	 * 只读内存映射文件
+	 * 	纹理文件按页由操作系统按需读入，解析头部和上传时直接引用映射内存，不做整文件读取和拷贝
+	 */
+	class MappedFile;
+	using MappedFilePtr = std::shared_ptr<MappedFile>;
+	class MappedFile
+	{
+	 public:
+		static MappedFilePtr create(const std::string& path);
+
+		explicit MappedFile(const std::string& path);
+
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		[[nodiscard]] const uint8_t* getData() const
+		{
+			return m_data;
+		}
+
+		[[nodiscard]] size_t getSize() const
+		{
+			return m_size;
+		}
+
+		[[nodiscard]] const std::string& getPath() const
+		{
+			return m_path;
+		}
+
+	 private:
+		std::string m_path;
+		const uint8_t* m_data{ nullptr };
+		size_t m_size{ 0 };
+
+#ifdef _WIN32
+		void* m_file{ nullptr };
+		void* m_mapping{ nullptr };
+#else
+		int m_file{ -1 };
+#endif
+	};
+
+} // ToyEngine
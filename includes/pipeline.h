@@ -19,7 +19,23 @@ namespace ToyEngine
 
 		void setShaderGroup(const std::vector<ShaderPtr>& shaders);
 
-		void buildPipeline();
+		//描述保存在Pipeline内，重新build时m_vertexInputInfo不会指向已经释放的数组
+		void setVertexInput(const std::vector<VkVertexInputBindingDescription>& bindings,
+			const std::vector<VkVertexInputAttributeDescription>& attributes);
+
+		//采样数必须与renderpass/动态渲染的附件一致，修改后需要重新build
+		void setSampleCount(VkSampleCountFlagBits samples);
+
+		[[nodiscard]] VkSampleCountFlagBits getSampleCount() const
+		{
+			return m_multisampling.rasterizationSamples;
+		}
+
+		//renderpass路径下附件变化(例如采样数)时替换，修改后需要重新build
+		void setRenderpass(const RenderpassPtr& renderpass);
+
+		//cache不为空时从中查找并写回编译结果，同一个cache可以在多个线程中同时使用
+		void buildPipeline(VkPipelineCache cache = VK_NULL_HANDLE);
 
 		void setViewport(const std::vector<VkViewport>& viewports);
 
@@ -27,6 +43,26 @@ namespace ToyEngine
 
 		void pushBlendAttachment(const VkPipelineColorBlendAttachmentState& attachment);
 
+		void setDescriptorSetLayouts(const std::vector<VkDescriptorSetLayout>& layouts);
+
+		void addPushConstantRange(const VkPushConstantRange& range);
+
+		//深度测试，compareOp为LESS时相同深度先画的留下；不写深度的半透明物体一般用LESS_OR_EQUAL
+		void setDepthTest(bool testEnable, bool writeEnable, VkCompareOp compareOp = VK_COMPARE_OP_LESS);
+
+		//动态渲染路径：renderpass传nullptr，管线只需要知道附件格式
+		void setRenderingFormats(const std::vector<VkFormat>& colorFormats,
+			VkFormat depthFormat = VK_FORMAT_UNDEFINED);
+
+		//按类型声明push constant，大小受限于规范保证的最小值128字节
+		template<typename T>
+		void addPushConstant(VkShaderStageFlags stages, uint32_t offset = 0)
+		{
+			static_assert(sizeof(T) % 4 == 0, "Push constant size must be a multiple of 4.");
+			static_assert(sizeof(T) <= MAX_PUSH_CONSTANT_SIZE, "Push constant block is larger than 128 bytes.");
+			addPushConstantRange({ stages, offset, static_cast<uint32_t>(sizeof(T)) });
+		}
+
 		[[nodiscard]] VkPipeline getPipeline() const
 		{
 			return m_pipeline;
@@ -48,6 +84,9 @@ namespace ToyEngine
 		VkPipelineDepthStencilStateCreateInfo m_depthStencil{};
 		VkPipelineLayoutCreateInfo m_layout{};
 
+		//规范保证所有设备至少支持128字节
+		static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+
 		//Todo::renderpass
 
 	 private:
@@ -58,8 +97,17 @@ namespace ToyEngine
 		VkPipelineLayout m_pipelineLayout{ VK_NULL_HANDLE };
 		std::vector<ShaderPtr> m_shaders;
 
+		std::vector<VkVertexInputBindingDescription> m_vertexBindings;
+		std::vector<VkVertexInputAttributeDescription> m_vertexAttributes;
+
 		std::vector<VkViewport> m_viewports;
 		std::vector<VkRect2D> m_scissors;
+
+		std::vector<VkDescriptorSetLayout> m_setLayouts;
+		std::vector<VkPushConstantRange> m_pushConstantRanges;
+
+		std::vector<VkFormat> m_colorFormats;
+		VkFormat m_depthFormat{ VK_FORMAT_UNDEFINED };
 	};
 
 } // ToyEngine
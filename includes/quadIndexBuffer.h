@@ -0,0 +1,77 @@
+#pragma once
+
+#include "base.h"
+#include "buffer.h"
+#include "commandBuffer.h"
+
+namespace ToyEngine
+{
+	/**
+	 * QuadIndexBuffer
+	 * 	所有四边形共用的静态index buffer，第q个四边形的index为4q + {0, 1, 2, 2, 3, 0}，创建时上传一次到DEVICE_LOCAL
+	 * 	每个四边形只需要4个顶点，相同index的顶点着色器结果会被复用，比6个顶点少三分之一的顶点数据和着色器调用
+	 * 	最大顶点号不超过65535时(16384个四边形)使用16位index，否则使用32位
+	 * 	四边形数量超过maxQuads时分段draw，每段用vertexOffset(base vertex)指向自己的顶点
+	 */
+	class QuadIndexBuffer;
+	using QuadIndexBufferPtr = std::shared_ptr<QuadIndexBuffer>;
+	class QuadIndexBuffer
+	{
+	 public:
+		static constexpr uint32_t VERTICES_PER_QUAD = 4;
+		static constexpr uint32_t INDICES_PER_QUAD = 6;
+		static constexpr uint32_t MAX_QUADS_UINT16 = 65536 / VERTICES_PER_QUAD;
+		static constexpr uint32_t MAX_QUADS = 65536;
+
+		static QuadIndexBufferPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			uint32_t maxQuads = MAX_QUADS_UINT16);
+
+		QuadIndexBuffer(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			uint32_t maxQuads = MAX_QUADS_UINT16);
+
+		~QuadIndexBuffer();
+
+		//写入quadCount个四边形的index，T为uint16_t或uint32_t
+		template<typename T>
+		static void fillIndices(T* dst, uint32_t quadCount)
+		{
+			static_assert(std::is_same_v<T, uint16_t> || std::is_same_v<T, uint32_t>, "Index type must be uint16_t or uint32_t.");
+			for (uint32_t q = 0; q < quadCount; q++)
+			{
+				auto base = static_cast<T>(q * VERTICES_PER_QUAD);
+				T* quad = dst + q * INDICES_PER_QUAD;
+				quad[0] = base;
+				quad[1] = static_cast<T>(base + 1);
+				quad[2] = static_cast<T>(base + 2);
+				quad[3] = static_cast<T>(base + 2);
+				quad[4] = static_cast<T>(base + 3);
+				quad[5] = base;
+			}
+		}
+
+		void bind(const CommandBufferPtr& commandBuffer) const;
+
+		[[nodiscard]] VkBuffer getBuffer() const
+		{
+			return m_buffer->getBuffer();
+		}
+
+		[[nodiscard]] VkIndexType getIndexType() const
+		{
+			return m_indexType;
+		}
+
+		[[nodiscard]] uint32_t getMaxQuads() const
+		{
+			return m_maxQuads;
+		}
+
+	 private:
+		BufferPtr m_buffer{ nullptr };
+		VkIndexType m_indexType{ VK_INDEX_TYPE_UINT16 };
+		uint32_t m_maxQuads{ 0 };
+	};
+
+} // ToyEngine
@@ -0,0 +1,359 @@
+#pragma once
+
+#include "base.h"
+#include "context.h"
+#include "image.h"
+#include "renderpassCache.h"
+#include "framebufferCache.h"
+#include "commandBuffer.h"
+#include "gpuProfiler.h"
+#include <functional>
+
+namespace ToyEngine
+{
+	using RGResource = uint32_t;
+	static constexpr RGResource RG_INVALID_RESOURCE = UINT32_MAX;
+
+	enum class RGLoadOp
+	{
+		Load,
+		Clear,
+		DontCare
+	};
+
+	//图内创建的临时纹理，只在一帧内有效
+	struct RGTextureDesc
+	{
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		VkFormat format{ VK_FORMAT_R8G8B8A8_UNORM };
+		VkSampleCountFlagBits samples{ VK_SAMPLE_COUNT_1_BIT };
+
+		//只作为附件使用(不采样、不拷贝)的纹理，内容不会离开renderpass
+		//使用TRANSIENT_ATTACHMENT和LAZILY_ALLOCATED内存，tile-based GPU上不占用显存；被采样或拷贝时退回普通显存
+		bool transient{ false };
+	};
+
+	//compile之后的统计，用于调试输出
+	struct RenderGraphStats
+	{
+		uint32_t passCount{ 0 };
+		uint32_t culledPassCount{ 0 };
+		uint32_t barrierCount{ 0 };			//vkCmdPipelineBarrier的调用次数
+		uint32_t imageBarrierCount{ 0 };
+		uint32_t transientCount{ 0 };
+		uint32_t lazyCount{ 0 };			//使用LAZILY_ALLOCATED内存的临时纹理
+		VkDeviceSize transientBytes{ 0 };	//不做别名时需要的显存
+		VkDeviceSize allocatedBytes{ 0 };	//别名之后实际分配的显存
+	};
+
+	/**
+	 * RenderGraphPass
+	 * 	pass只声明自己读写了哪些资源，barrier和布局转换由RenderGraph推导
+	 * 	有颜色或深度输出的pass是光栅pass，执行回调时renderpass已经开始；否则回调在renderpass之外执行
+	 */
+	class RenderGraphPass
+	{
+	 public:
+		using ExecuteCallback = std::function<void(const CommandBufferPtr&)>;
+
+		RenderGraphPass(const std::string& name, uint32_t index);
+
+		~RenderGraphPass() = default;
+
+		//resolveTarget有效时resource是多重采样纹理，在renderpass结束时resolve到resolveTarget，不需要额外的拷贝pass
+		void addColorOutput(RGResource resource, RGLoadOp loadOp = RGLoadOp::Load,
+			const VkClearColorValue& clearColor = {}, RGResource resolveTarget = RG_INVALID_RESOURCE);
+
+		//每个pass最多一个深度附件，深度测试和写入都在这个附件上进行
+		void setDepthOutput(RGResource resource, RGLoadOp loadOp = RGLoadOp::Load, float clearDepth = 1.0f);
+
+		//在片元着色器中采样
+		void addTextureInput(RGResource resource);
+
+		void addTransferInput(RGResource resource);
+
+		void addTransferOutput(RGResource resource);
+
+		//有副作用的pass即使输出没有被使用也不会被剔除
+		void setSideEffect(bool sideEffect = true)
+		{
+			m_sideEffect = sideEffect;
+		}
+
+		void setExecute(ExecuteCallback execute)
+		{
+			m_execute = std::move(execute);
+		}
+
+		[[nodiscard]] const std::string& getName() const
+		{
+			return m_name;
+		}
+
+		[[nodiscard]] bool isCulled() const
+		{
+			return m_culled;
+		}
+
+		[[nodiscard]] bool isRaster() const
+		{
+			return !m_colorOutputs.empty() || m_depthOutput.resource != RG_INVALID_RESOURCE;
+		}
+
+	 private:
+		friend class RenderGraph;
+
+		enum class Usage
+		{
+			ColorAttachment,
+			ResolveAttachment,
+			DepthAttachment,
+			Sampled,
+			TransferSrc,
+			TransferDst
+		};
+
+		struct Access
+		{
+			RGResource resource{ RG_INVALID_RESOURCE };
+			Usage usage{ Usage::Sampled };
+		};
+
+		struct ColorOutput
+		{
+			RGResource resource{ RG_INVALID_RESOURCE };
+			RGLoadOp loadOp{ RGLoadOp::Load };
+			VkClearColorValue clearColor{};
+			RGResource resolve{ RG_INVALID_RESOURCE };
+
+			//compile推导出的实际操作：没有内容可读时不LOAD，之后没有人使用时不STORE
+			VkAttachmentLoadOp vkLoadOp{ VK_ATTACHMENT_LOAD_OP_LOAD };
+			VkAttachmentStoreOp vkStoreOp{ VK_ATTACHMENT_STORE_OP_STORE };
+			VkAttachmentStoreOp vkResolveStoreOp{ VK_ATTACHMENT_STORE_OP_STORE };
+		};
+
+		struct DepthOutput
+		{
+			RGResource resource{ RG_INVALID_RESOURCE };
+			RGLoadOp loadOp{ RGLoadOp::Load };
+			float clearDepth{ 1.0f };
+
+			VkAttachmentLoadOp vkLoadOp{ VK_ATTACHMENT_LOAD_OP_LOAD };
+			VkAttachmentStoreOp vkStoreOp{ VK_ATTACHMENT_STORE_OP_STORE };
+		};
+
+		static bool isWrite(Usage usage)
+		{
+			return usage == Usage::ColorAttachment || usage == Usage::ResolveAttachment
+				   || usage == Usage::DepthAttachment || usage == Usage::TransferDst;
+		}
+
+	 private:
+		std::string m_name;
+		uint32_t m_index{ 0 };
+		std::vector<Access> m_accesses;
+		std::vector<ColorOutput> m_colorOutputs;
+		DepthOutput m_depthOutput{};
+		ExecuteCallback m_execute;
+		bool m_sideEffect{ false };
+
+		//compile的结果
+		bool m_culled{ false };
+		uint32_t m_refCount{ 0 };
+		std::vector<VkImageMemoryBarrier> m_barriers;
+		VkPipelineStageFlags m_srcStages{ 0 };
+		VkPipelineStageFlags m_dstStages{ 0 };
+		VkRenderPass m_renderPass{ VK_NULL_HANDLE };
+		VkFramebuffer m_framebuffer{ VK_NULL_HANDLE };
+		VkExtent2D m_extent{};
+	};
+
+	/**
+	 * RenderGraph
+	 * 	每帧重新声明：reset -> importImage/createTexture -> addPass -> compile -> execute
+	 * 	compile做三件事：
+	 * 	1 从导入资源(交换链等)和有副作用的pass反向引用计数，剔除输出没有被使用的pass
+	 * 	2 按pass顺序跟踪每个资源的布局/最后写入/已可见的阶段，只在真正有冒险或需要布局转换时生成barrier，
+	 * 	  同一个pass的所有barrier合并为一次调用
+	 * 	3 临时纹理按首末使用的pass计算生命周期，生命周期不重叠的纹理共享同一块VkDeviceMemory
+	 * 	  标记为transient且只作为附件的纹理使用lazily allocated内存
+	 * 	4 推导附件的load/store：之前没有写入的不LOAD，之后没有读取的不STORE
+	 * 	临时纹理的物理资源在声明不变时跨帧复用，变化时旧资源保留到使用它的帧全部执行完再销毁
+	 * 	renderpass在pass之外用barrier同步，自身不带依赖，附件的initialLayout和finalLayout相同
+	 * 	renderpass和framebuffer从缓存中查找，每种配置只创建一次
+	 * 	开启动态渲染后不再创建renderpass和framebuffer，光栅化pass用vkCmdBeginRendering直接引用图像视图
+	 */
+	class RenderGraph;
+	using RenderGraphPtr = std::shared_ptr<RenderGraph>;
+	class RenderGraph
+	{
+	 public:
+		static RenderGraphPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const RenderpassCachePtr& renderpassCache,
+			const FramebufferCachePtr& framebufferCache,
+			uint32_t framesInFlight);
+
+		RenderGraph(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const RenderpassCachePtr& renderpassCache,
+			const FramebufferCachePtr& framebufferCache,
+			uint32_t framesInFlight);
+
+		~RenderGraph();
+
+		//每帧开始声明之前调用，在这一帧的fence等待之后
+		void reset();
+
+		/**
+		 * 导入图外的图像，例如交换链
+		 * 	initialLayout/initialStage 描述进入图时的状态，交换链为UNDEFINED和等待acquire信号量的阶段
+		 * 	finalLayout 执行结束后要转换到的布局，导入资源视为图的输出，写入它的pass不会被剔除
+		 */
+		RGResource importImage(const std::string& name, VkImage image, VkImageView imageView,
+			VkFormat format, VkExtent2D extent,
+			VkImageLayout initialLayout, VkPipelineStageFlags initialStage,
+			VkImageLayout finalLayout);
+
+		RGResource createTexture(const std::string& name, const RGTextureDesc& desc);
+
+		//返回的引用在下一次reset之前有效
+		RenderGraphPass& addPass(const std::string& name);
+
+		//设置后每个pass(包括barrier和load/store)包在一个以pass名字命名的GPU计时作用域中
+		void setProfiler(const GpuProfilerPtr& profiler)
+		{
+			m_profiler = profiler;
+		}
+
+		//设备不支持时保持renderpass路径，下一次compile生效
+		void setDynamicRendering(bool enable);
+
+		[[nodiscard]] bool isDynamicRendering() const
+		{
+			return m_dynamicRendering;
+		}
+
+		void compile();
+
+		void execute(const CommandBufferPtr& commandBuffer);
+
+		[[nodiscard]] const RenderGraphStats& getStats() const
+		{
+			return m_stats;
+		}
+
+		//临时纹理的图像视图，只在compile之后有效，用于在pass回调中绑定采样
+		[[nodiscard]] VkImageView getImageView(RGResource resource) const;
+
+	 private:
+		struct ResourceState
+		{
+			VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			VkPipelineStageFlags writeStages{ 0 };	//最后一次写入(包括布局转换)所在的阶段
+			VkAccessFlags writeAccess{ 0 };
+			VkPipelineStageFlags visibleStages{ 0 };	//最后一次写入已经对这些阶段可见
+			VkPipelineStageFlags readStages{ 0 };		//最后一次写入之后读取过的阶段
+			bool hasContent{ false };					//当前内容是否有意义，决定附件能否不LOAD
+		};
+
+		struct Resource
+		{
+			std::string name;
+			RGTextureDesc desc{};
+			bool imported{ false };
+			VkImage image{ VK_NULL_HANDLE };
+			VkImageView imageView{ VK_NULL_HANDLE };
+			VkImageLayout initialLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			VkPipelineStageFlags initialStage{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+			VkImageLayout finalLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+			VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+			VkImageUsageFlags usage{ 0 };
+
+			uint32_t refCount{ 0 };
+			std::vector<uint32_t> writers;
+			uint32_t firstPass{ UINT32_MAX };
+			uint32_t lastPass{ 0 };
+			uint32_t block{ UINT32_MAX };		//别名使用的内存块
+			bool lazy{ false };
+			ResourceState state{};
+		};
+
+		//一块可以被多个生命周期不重叠的临时纹理共享的内存
+		struct MemoryBlock
+		{
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			VkDeviceSize size{ 0 };
+			VkDeviceSize alignment{ 1 };
+			uint32_t memoryTypeBits{ 0 };
+			VkMemoryPropertyFlags memoryProperties{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+			uint32_t lastPass{ 0 };
+			VkPipelineStageFlags lastStages{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };	//上一个使用者最后的阶段，跨帧保留
+			VkAccessFlags lastAccess{ 0 };		//上一个使用者最后的写访问，下一个使用者的第一个barrier要让它可用
+		};
+
+		struct Retired
+		{
+			std::vector<ImagePtr> images;
+			std::vector<VkDeviceMemory> memories;
+			uint32_t framesLeft{ 0 };
+		};
+
+		struct UsageInfo
+		{
+			VkImageLayout layout;
+			VkPipelineStageFlags stage;
+			VkAccessFlags access;
+		};
+
+		static UsageInfo getUsageInfo(RenderGraphPass::Usage usage);
+
+		static VkImageUsageFlags getImageUsage(RenderGraphPass::Usage usage);
+
+		void cullPasses();
+
+		void computeLifetimes();
+
+		//声明和上一帧相同时复用物理资源，否则重新分配
+		void allocateTransients();
+
+		void buildBarriers();
+
+		void buildRenderPasses();
+
+		VkRenderPass getRenderPass(const RenderGraphPass& pass);
+
+		void executeDynamic(const RenderGraphPass& pass, const CommandBufferPtr& commandBuffer);
+
+		void releasePhysical(bool immediately);
+
+		void destroyRetired(Retired& retired);
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+		uint32_t m_framesInFlight{ 1 };
+		RenderpassCachePtr m_renderpassCache{ nullptr };
+		FramebufferCachePtr m_framebufferCache{ nullptr };
+
+		std::vector<std::unique_ptr<RenderGraphPass>> m_passes;
+		std::vector<Resource> m_resources;
+		std::vector<VkImageMemoryBarrier> m_finalBarriers;
+		VkPipelineStageFlags m_finalSrcStages{ 0 };
+		bool m_compiled{ false };
+		bool m_dynamicRendering{ false };
+		GpuProfilerPtr m_profiler{ nullptr };
+
+		//临时纹理的物理资源，下标与声明顺序中的临时纹理一一对应
+		uint64_t m_physicalKey{ 0 };
+		std::vector<ImagePtr> m_physicalImages;
+		std::vector<uint32_t> m_physicalBlocks;
+		std::vector<MemoryBlock> m_blocks;
+
+		std::vector<Retired> m_retired;
+
+		RenderGraphStats m_stats{};
+	};
+
+} // ToyEngine
@@ -23,6 +23,9 @@ namespace ToyEngine
 
 		void addInputAttachmentReference(VkAttachmentReference& ref);
 
+		//与颜色附件一一对应，不需要resolve的颜色附件使用VK_ATTACHMENT_UNUSED
+		void addResolveAttachmentReference(VkAttachmentReference& ref);
+
 		void setDepthStencilAttachmentReference(VkAttachmentReference& ref);
 
 		void buildSubpassDescription();
@@ -33,7 +36,9 @@ namespace ToyEngine
 		VkSubpassDescription m_subpassDescription{};
 		std::vector<VkAttachmentReference> m_colorAttachmentReferences;
 		std::vector<VkAttachmentReference> m_inputAttachmentReferences;
+		std::vector<VkAttachmentReference> m_resolveAttachmentReferences;
 		VkAttachmentReference m_depthStencilAttachmentReference{};
+		bool m_hasDepthStencil{ false };
 	};
 
 	class Renderpass;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "base.h"
+#include "renderpass.h"
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace ToyEngine
+{
+	//单个子流程的renderpass：颜色附件按顺序引用，布局使用COLOR_ATTACHMENT_OPTIMAL
+	//resolveAttachments为空或与颜色附件一一对应，format为VK_FORMAT_UNDEFINED的颜色附件不resolve
+	//附件顺序：颜色、实际使用的resolve、深度；深度布局使用DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	struct RenderpassDesc
+	{
+		std::vector<VkAttachmentDescription> colorAttachments;
+		std::vector<VkAttachmentDescription> resolveAttachments;
+		std::optional<VkAttachmentDescription> depthAttachment;
+	};
+
+	/**
+	 * RenderpassCache
+	 * 	按附件描述的内容去重，相同配置的renderpass只创建一次
+	 * 	管线只要求renderpass兼容(格式和采样数相同)，所以用于创建管线的renderpass也可以从缓存中取
+	 * 	返回的Renderpass由缓存持有，随缓存一起销毁
+	 */
+	class RenderpassCache;
+	using RenderpassCachePtr = std::shared_ptr<RenderpassCache>;
+	class RenderpassCache
+	{
+	 public:
+		static RenderpassCachePtr create(const VkDevice& device);
+
+		explicit RenderpassCache(const VkDevice& device);
+
+		~RenderpassCache() = default;
+
+		RenderpassPtr get(const RenderpassDesc& desc);
+
+		[[nodiscard]] size_t getRenderpassCount() const
+		{
+			return m_renderpasses.size();
+		}
+
+	 private:
+		//VkAttachmentDescription的每个字段依次展开
+		struct RenderpassKey
+		{
+			std::vector<uint32_t> values;
+
+			bool operator==(const RenderpassKey& other) const
+			{
+				return values == other.values;
+			}
+		};
+
+		struct RenderpassKeyHash
+		{
+			size_t operator()(const RenderpassKey& key) const;
+		};
+
+		static RenderpassKey makeKey(const RenderpassDesc& desc);
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		std::mutex m_mutex;
+		std::unordered_map<RenderpassKey, RenderpassPtr, RenderpassKeyHash> m_renderpasses;
+	};
+
+} // ToyEngine
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "base.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace ToyEngine
+{
+	/**
+	 * SamplerCache
+	 * 	按VkSamplerCreateInfo的内容去重，相同参数的纹理共用一个VkSampler
+	 * 	设备上sampler数量有上限(maxSamplerAllocationCount)，每张纹理各建一个既浪费又可能超限
+	 * 	返回的sampler由缓存持有，随缓存一起销毁；不支持pNext扩展链
+	 */
+	class SamplerCache;
+	using SamplerCachePtr = std::shared_ptr<SamplerCache>;
+	class SamplerCache
+	{
+	 public:
+		static SamplerCachePtr create(const VkDevice& device);
+
+		explicit SamplerCache(const VkDevice& device);
+
+		~SamplerCache();
+
+		VkSampler get(const VkSamplerCreateInfo& createInfo);
+
+		//常用参数的快捷方式，maxLod默认不限制，覆盖全部mip
+		VkSampler get(VkFilter filter, VkSamplerAddressMode addressMode, float maxLod = VK_LOD_CLAMP_NONE);
+
+		static VkSamplerCreateInfo makeCreateInfo(VkFilter filter,
+			VkSamplerAddressMode addressMode,
+			float maxLod = VK_LOD_CLAMP_NONE);
+
+		[[nodiscard]] size_t getSamplerCount() const
+		{
+			return m_samplers.size();
+		}
+
+	 private:
+		//VkSamplerCreateInfo中参与比较的字段，float按位保存
+		struct SamplerKey
+		{
+			uint32_t values[16]{};
+
+			bool operator==(const SamplerKey& other) const
+			{
+				return std::memcmp(values, other.values, sizeof(values)) == 0;
+			}
+		};
+
+		struct SamplerKeyHash
+		{
+			size_t operator()(const SamplerKey& key) const;
+		};
+
+		static SamplerKey makeKey(const VkSamplerCreateInfo& createInfo);
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		std::mutex m_mutex;
+		std::unordered_map<SamplerKey, VkSampler, SamplerKeyHash> m_samplers;
+	};
+
+} // ToyEngine
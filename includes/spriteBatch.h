@@ -0,0 +1,189 @@
+#pragma once
+
+#include "base.h"
+#include "buffer.h"
+#include "pipeline.h"
+#include "commandBuffer.h"
+#include "bindlessHeap.h"
+#include "atlasPacker.h"
+#include "drawStream.h"
+#include "quadIndexBuffer.h"
+
+namespace ToyEngine
+{
+	//每个sprite写入实例buffer的数据，按instance速率输入顶点着色器
+	struct SpriteInstance
+	{
+		glm::vec2 position;		//中心点
+		glm::vec2 size;
+		glm::vec4 uvRect;		//u0 v0 u1 v1
+		float rotation;			//弧度
+		uint32_t color;			//RGBA8，着色器中以R8G8B8A8_UNORM读取
+		uint32_t textureIndex;	//bindless下标，BindlessHeap::INVALID_INDEX表示纯色
+		uint32_t layer;			//纹理数组的层，图集页
+		float depth;			//[0, 1]，0最近，直接作为裁剪空间的z
+	};
+
+	//一次draw对应的连续实例区间
+	struct SpriteDrawBatch
+	{
+		uint32_t pipelineId;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	inline uint32_t packColor(const glm::vec4& color)
+	{
+		auto c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		return static_cast<uint32_t>(c.r) | (static_cast<uint32_t>(c.g) << 8)
+			| (static_cast<uint32_t>(c.b) << 16) | (static_cast<uint32_t>(c.a) << 24);
+	}
+
+	/**
+	 * SpriteBatch
+	 * 	CPU侧的sprite存储，按属性分开存放(SoA)，每帧清空后重新填充
+	 * 	build时排序，把实例数据顺序写入目标内存(通常是持久映射的buffer)，并生成draw批次
+	 * 	不透明sprite在前：按pipeline分组，组内从前到后，写深度后被遮挡的片元在early-Z阶段就被丢弃
+	 * 	半透明sprite在后：整体从后到前才能正确混合，pipeline只作为相同深度时的次要key
+	 * 	纹理通过bindless下标访问，因此批次只会在pipeline变化时切分，按纹理排序是为了采样的局部性
+	 * 	不依赖任何Vulkan对象，可以在没有GPU的情况下测试/benchmark
+	 */
+	class SpriteBatch
+	{
+	 public:
+		explicit SpriteBatch(size_t reserveCount = 0);
+
+		~SpriteBatch() = default;
+
+		void reserve(size_t count);
+
+		void clear();
+
+		//返回sprite在本帧中的编号
+		uint32_t add(const glm::vec2& position,
+			const glm::vec2& size,
+			float rotation = 0.0f,
+			uint32_t color = 0xFFFFFFFF,
+			uint32_t textureIndex = BindlessHeap::INVALID_INDEX,
+			const glm::vec4& uvRect = { 0.0f, 0.0f, 1.0f, 1.0f },
+			uint32_t layer = 0,
+			uint16_t pipelineId = 0,
+			float depth = 0.0f);
+
+		//引用图集中的子区域
+		uint32_t add(const glm::vec2& position,
+			const glm::vec2& size,
+			float rotation,
+			uint32_t color,
+			const AtlasRegion& region,
+			uint16_t pipelineId = 0,
+			float depth = 0.0f);
+
+		//排序并把实例写入dst，超出capacity的部分会被丢弃，返回实际写入的数量
+		//transparentPipelines[pipelineId]非0的pipeline按半透明处理，不在表中的按不透明处理
+		size_t build(SpriteInstance* dst, size_t capacity, const std::vector<uint8_t>& transparentPipelines = {});
+
+		[[nodiscard]] size_t size() const
+		{
+			return m_positions.size();
+		}
+
+		[[nodiscard]] const std::vector<SpriteDrawBatch>& getBatches() const
+		{
+			return m_batches;
+		}
+
+	 private:
+		struct SortItem
+		{
+			uint64_t key;
+			uint32_t index;
+		};
+
+		std::vector<glm::vec2> m_positions;
+		std::vector<glm::vec2> m_sizes;
+		std::vector<float> m_rotations;
+		std::vector<glm::vec4> m_uvRects;
+		std::vector<uint32_t> m_colors;
+		std::vector<uint32_t> m_textures;
+		std::vector<uint32_t> m_layers;
+		std::vector<uint16_t> m_pipelines;
+		std::vector<float> m_depths;
+
+		std::vector<SortItem> m_sortItems;
+		std::vector<SortItem> m_sortScratch;
+		std::vector<SpriteDrawBatch> m_batches;
+	};
+
+	//sprite着色器的push constant
+	struct SpritePushConstants
+	{
+		glm::mat4 viewProjection;
+	};
+
+	/**
+	 * SpriteRenderer
+	 * 	每个飞行帧一块持久映射的实例buffer，build直接写入映射内存
+	 * 	每个批次一次instanced indexed draw，四边形的4个角由顶点着色器根据gl_VertexIndex生成，
+	 * 	6个index取自共用的QuadIndexBuffer的第一个四边形，每个sprite只执行4次顶点着色器
+	 * 	pipeline由外部按getBindingDescription/getAttributeDescription创建，layout为：set 0 bindless，push constant为SpritePushConstants
+	 * 	不透明pipeline应开启深度测试和写入、关闭混合；半透明pipeline开启混合和深度测试、不写深度
+	 */
+	class SpriteRenderer;
+	using SpriteRendererPtr = std::shared_ptr<SpriteRenderer>;
+	class SpriteRenderer
+	{
+	 public:
+		static SpriteRendererPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			uint32_t framesInFlight,
+			uint32_t maxSprites,
+			const QuadIndexBufferPtr& quadIndexBuffer = nullptr);
+
+		SpriteRenderer(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			uint32_t framesInFlight,
+			uint32_t maxSprites,
+			const QuadIndexBufferPtr& quadIndexBuffer = nullptr);
+
+		~SpriteRenderer();
+
+		//返回pipelineId，SpriteBatch::add时使用；transparent决定这个pipeline的sprite的排序方式
+		uint16_t addPipeline(const PipelinePtr& pipeline, bool transparent = false);
+
+		void setViewProjection(const glm::mat4& viewProjection);
+
+		//填充frameIndex对应的实例buffer并录制draw，需要在renderpass内调用
+		void record(const CommandBufferPtr& commandBuffer, uint32_t frameIndex, SpriteBatch& batch);
+
+		//与record相同地填充实例buffer，每个批次作为一条命令提交到drawStream的pass中，由drawStream排序后录制
+		void submit(DrawStream& drawStream, uint32_t frameIndex, SpriteBatch& batch, uint32_t pass);
+
+		//最近一次record写入实例buffer的字节数
+		[[nodiscard]] VkDeviceSize getLastUploadBytes() const
+		{
+			return m_lastUploadBytes;
+		}
+
+		[[nodiscard]] static std::vector<VkVertexInputBindingDescription> getBindingDescription();
+
+		[[nodiscard]] static std::vector<VkVertexInputAttributeDescription> getAttributeDescription();
+
+	 private:
+		//排序并写入frameIndex对应的实例buffer，返回写入的数量
+		size_t buildInstances(uint32_t frameIndex, SpriteBatch& batch);
+
+	 private:
+		BindlessHeapPtr m_bindlessHeap{ nullptr };
+		QuadIndexBufferPtr m_quadIndexBuffer{ nullptr };
+		std::vector<BufferPtr> m_instanceBuffers;
+		std::vector<PipelinePtr> m_pipelines;
+		std::vector<uint8_t> m_transparentPipelines;
+		uint32_t m_maxSprites{ 0 };
+		VkDeviceSize m_lastUploadBytes{ 0 };
+		SpritePushConstants m_pushConstants{};
+	};
+
+} // ToyEngine
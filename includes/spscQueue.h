@@ -0,0 +1,162 @@
+#pragma once
+
+#include "base.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+namespace ToyEngine
+{
+	/**
+	 * SpscQueue
+	 * 	容量固定的单生产者单消费者队列，tryPush/tryPop无锁，head只由生产者写，tail只由消费者写
+	 * 	双方各自缓存对方的位置，只有缓存的位置显示满/空时才去读对方的原子变量
+	 * 	push/pop在满/空时先短暂让出，再在条件变量上休眠，只有存在等待方时另一方才需要加锁通知
+	 * 	cancel被置位后阻塞的push/pop返回false，置位后需要调用wakeAll
+	 */
+	template<typename T, uint32_t Capacity>
+	class SpscQueue
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two.");
+
+	 public:
+		SpscQueue() = default;
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		//只能由生产者调用，队列满时返回false
+		bool tryPush(T value)
+		{
+			return tryPushFrom(value);
+		}
+
+		//只能由消费者调用，队列空时返回false
+		bool tryPop(T& value)
+		{
+			uint32_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail == m_headCache)
+			{
+				m_headCache = m_head.load(std::memory_order_acquire);
+				if (tail == m_headCache)
+				{
+					return false;
+				}
+			}
+
+			value = std::move(m_slots[tail & (Capacity - 1)]);
+			m_tail.store(tail + 1, std::memory_order_release);
+			notify();
+			return true;
+		}
+
+		bool push(T value, const std::atomic<bool>& cancel)
+		{
+			return waitFor(cancel,
+				[&]()
+				{
+				  return tryPushFrom(value);
+				},
+				[this]()
+				{
+				  return m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_seq_cst) != Capacity;
+				});
+		}
+
+		bool pop(T& value, const std::atomic<bool>& cancel)
+		{
+			return waitFor(cancel,
+				[&]()
+				{
+				  return tryPop(value);
+				},
+				[this]()
+				{
+				  return m_head.load(std::memory_order_seq_cst) != m_tail.load(std::memory_order_relaxed);
+				});
+		}
+
+		void wakeAll()
+		{
+			std::lock_guard<std::mutex> lock(m_waitMutex);
+			m_waitCondition.notify_all();
+		}
+
+	 private:
+		static constexpr uint32_t SPIN_COUNT = 64;
+
+		//成功时才移走value，失败后可以重试
+		bool tryPushFrom(T& value)
+		{
+			uint32_t head = m_head.load(std::memory_order_relaxed);
+			if (head - m_tailCache == Capacity)
+			{
+				m_tailCache = m_tail.load(std::memory_order_acquire);
+				if (head - m_tailCache == Capacity)
+				{
+					return false;
+				}
+			}
+
+			m_slots[head & (Capacity - 1)] = std::move(value);
+			m_head.store(head + 1, std::memory_order_release);
+			notify();
+			return true;
+		}
+
+		template<typename Try, typename Ready>
+		bool waitFor(const std::atomic<bool>& cancel, Try&& attempt, Ready&& ready)
+		{
+			for (uint32_t spin = 0;; spin++)
+			{
+				if (attempt())
+				{
+					return true;
+				}
+				if (cancel.load(std::memory_order_acquire))
+				{
+					return false;
+				}
+				if (spin < SPIN_COUNT)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				//超时只是保险，正常情况下由另一方的notify唤醒
+				std::unique_lock<std::mutex> lock(m_waitMutex);
+				m_waiters.fetch_add(1, std::memory_order_seq_cst);
+				m_waitCondition.wait_for(lock, std::chrono::milliseconds(1), [&]()
+				{
+				  return ready() || cancel.load(std::memory_order_acquire);
+				});
+				m_waiters.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+		void notify()
+		{
+			//与等待方先增加m_waiters再检查位置的顺序配合，两边至少有一边能看到对方
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_waiters.load(std::memory_order_relaxed) > 0)
+			{
+				std::lock_guard<std::mutex> lock(m_waitMutex);
+				m_waitCondition.notify_all();
+			}
+		}
+
+	 private:
+		alignas(64) std::atomic<uint32_t> m_head{ 0 };
+		uint32_t m_tailCache{ 0 };	//生产者缓存的tail
+		alignas(64) std::atomic<uint32_t> m_tail{ 0 };
+		uint32_t m_headCache{ 0 };	//消费者缓存的head
+
+		std::array<T, Capacity> m_slots{};
+
+		std::mutex m_waitMutex;
+		std::condition_variable m_waitCondition;
+		std::atomic<uint32_t> m_waiters{ 0 };
+	};
+
+} // ToyEngine
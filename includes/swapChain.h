@@ -2,7 +2,6 @@
 #include "base.h"
 #include "context.h"
 #include "vkWindow.h"
-#include "renderpass.h"
 
 namespace ToyEngine
 {
@@ -47,14 +46,14 @@ namespace ToyEngine
 			return m_extent;
 		}
 
-		[[nodiscard]] std::vector<VkImageView> getImageViews() const
+		[[nodiscard]] const std::vector<VkImage>& getImages() const
 		{
-			return m_imageViews;
+			return m_images;
 		}
 
-		[[nodiscard]] std::vector<VkFramebuffer> getFramebuffers() const
+		[[nodiscard]] std::vector<VkImageView> getImageViews() const
 		{
-			return m_framebuffers;
+			return m_imageViews;
 		}
 
 		[[nodiscard]] uint32_t getImageCount() const
@@ -62,8 +61,6 @@ namespace ToyEngine
 			return m_imageCount;
 		}
 
-		void createFramebuffers(const RenderpassPtr& renderPass);
-
 	 private:
 		VkImageView createImageView(VkImage image,
 			VkFormat format,
@@ -82,8 +79,6 @@ namespace ToyEngine
 		std::vector<VkImage> m_images;
 		//对图像的管理
 		std::vector<VkImageView> m_imageViews;
-
-		std::vector<VkFramebuffer> m_framebuffers;
 	};
 
 } // ToyEngine
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "base.h"
+#include "buffer.h"
+#include "commandBuffer.h"
+#include "bindlessHeap.h"
+#include "atlasPacker.h"
+#include "image.h"
+#include "samplerCache.h"
+
+namespace ToyEngine
+{
+	//待插入图集的RGBA8图像，像素紧密排列
+	struct AtlasImage
+	{
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		const void* pixels{ nullptr };
+	};
+
+	/**
+	 * TextureAtlas
+	 * 	一张RGBA8的2D数组纹理，每层是一页，每页一个SkylinePacker
+	 * 	插入只在CPU侧记录脏矩形和像素，recordUploads时把所有脏矩形打包进一个staging buffer，
+	 * 	一次barrier进入TRANSFER_DST，一次vkCmdCopyBufferToImage拷贝所有区域，再一次barrier回到SHADER_READ_ONLY
+	 * 	整个图集只占bindless表中的一个下标，sprite通过AtlasRegion的layer和uvRect定位
+	 */
+	class TextureAtlas;
+	using TextureAtlasPtr = std::shared_ptr<TextureAtlas>;
+	class TextureAtlas
+	{
+	 public:
+		static TextureAtlasPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			const SamplerCachePtr& samplerCache,
+			uint32_t framesInFlight,
+			uint32_t pageSize = 2048,
+			uint32_t maxPages = 4);
+
+		TextureAtlas(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			const SamplerCachePtr& samplerCache,
+			uint32_t framesInFlight,
+			uint32_t pageSize = 2048,
+			uint32_t maxPages = 4);
+
+		~TextureAtlas();
+
+		//运行时插入单张图像，所有页都放不下时返回空
+		std::optional<AtlasRegion> insert(const AtlasImage& image);
+
+		//加载时批量插入，按高度从大到小装箱，占用率更高；结果与输入顺序一致
+		std::vector<std::optional<AtlasRegion>> insertBatch(const std::vector<AtlasImage>& images);
+
+		//覆盖已有区域的像素，例如动态生成的字形
+		void updateRegion(const AtlasRegion& region, const void* pixels);
+
+		[[nodiscard]] bool hasPendingUploads() const
+		{
+			return !m_pendingUploads.empty();
+		}
+
+		//切换到frameIndex对应的槽位并释放其中的staging buffer，调用前需要保证这一帧的fence已经等待完成
+		void beginFrame(uint32_t frameIndex);
+
+		//把脏矩形的上传录制到commandBuffer，需要在renderpass之外调用，一帧内可以调用多次
+		//staging buffer追加到当前槽位，保留到这个槽位下一次beginFrame
+		void recordUploads(const CommandBufferPtr& commandBuffer);
+
+		//加载阶段使用，单独提交并等待完成
+		void flushSync();
+
+		[[nodiscard]] uint32_t getTextureIndex() const
+		{
+			return m_textureIndex;
+		}
+
+		[[nodiscard]] uint32_t getPageCount() const
+		{
+			return static_cast<uint32_t>(m_pages.size());
+		}
+
+		[[nodiscard]] float getOccupancy() const;
+
+	 private:
+		struct PendingUpload
+		{
+			uint32_t layer;
+			AtlasRect rect;
+			size_t offset;
+		};
+
+		//创建时清空整张图并转换到SHADER_READ_ONLY，单独提交并等待完成
+		void clearImage();
+
+		void queueUpload(uint32_t layer, const AtlasRect& rect, const void* pixels);
+
+		BufferPtr recordUploadCommands(const CommandBufferPtr& commandBuffer);
+
+		AtlasRegion makeRegion(uint32_t layer, const AtlasRect& rect) const;
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+		BindlessHeapPtr m_bindlessHeap{ nullptr };
+
+		uint32_t m_pageSize{ 0 };
+		uint32_t m_maxPages{ 0 };
+		std::vector<SkylinePacker> m_pages;
+
+		ImagePtr m_image{ nullptr };
+		VkSampler m_sampler{ VK_NULL_HANDLE };
+		uint32_t m_textureIndex{ BindlessHeap::INVALID_INDEX };
+
+		std::vector<uint8_t> m_pendingPixels;
+		std::vector<PendingUpload> m_pendingUploads;
+		std::vector<std::vector<BufferPtr>> m_stagingBuffers;
+		uint32_t m_currentSlot{ 0 };
+	};
+
+} // ToyEngine
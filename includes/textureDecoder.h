@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ToyEngine
+{
+	//可以在CPU上解码的块压缩格式，设备不支持文件中的格式时解码为RGBA8再上传
+	enum class BlockFormat
+	{
+		BC1,
+		BC3,
+		ETC2_RGB8,
+		ETC2_RGBA8,
+	};
+
+	//每个4x4块的字节数
+	size_t getBlockSize(BlockFormat format);
+
+	/**
+	 * 把一张width x height的块压缩图像解码为紧密排列的RGBA8
+	 * 	src为按行排列的4x4块，宽高不是4的倍数时最后一列/行的块只取有效部分
+	 * 	dst至少width * height * 4字节
+	 * 	不依赖Vulkan，可以在加载线程中并行调用
+	 */
+	void decodeBlocks(BlockFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst);
+
+} // ToyEngine
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "base.h"
+#include "ktx2Loader.h"
+#include "imageUploader.h"
+#include <future>
+#include <list>
+
+namespace ToyEngine
+{
+	struct TextureStreamerConfig
+	{
+		VkDeviceSize budgetBytes{ 256ull * 1024 * 1024 };	//流式纹理可用的显存上限，实际还会受memory budget限制
+		uint32_t tailSize{ 64 };							//边长不超过该值的mip常驻
+		uint32_t maxConcurrentLoads{ 4 };
+		uint32_t budgetQueryInterval{ 30 };					//每隔多少帧查询一次驱动的预算
+	};
+
+	/**
+	 * TextureStreamer
+	 * 	每张纹理分为两部分：
+	 * 	tail - 低分辨率的mip尾部，注册时同步加载并一直常驻，渲染永远至少有它可用
+	 * 	detail - 从请求的mip开始到最后一级的完整链，按需在工作线程中从磁盘读取，上传录制在帧命令缓冲中
+	 * 	detail和tail各占一个bindless下标，getTextureIndex每帧返回当前可用的最高精度，不会等待磁盘
+	 * 	显存超出预算时按LRU淘汰detail，退回tail
+	 */
+	class TextureStreamer;
+	using TextureStreamerPtr = std::shared_ptr<TextureStreamer>;
+	class TextureStreamer
+	{
+	 public:
+		using Handle = uint32_t;
+		static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+		static TextureStreamerPtr create(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			const SamplerCachePtr& samplerCache,
+			uint32_t framesInFlight,
+			const TextureStreamerConfig& config = {});
+
+		TextureStreamer(const VkDevice& device,
+			VkPhysicalDevice const& physicalDevice,
+			const BindlessHeapPtr& bindlessHeap,
+			const SamplerCachePtr& samplerCache,
+			uint32_t framesInFlight,
+			const TextureStreamerConfig& config = {});
+
+		//等待还在进行的磁盘读取，只在退出时发生
+		~TextureStreamer();
+
+		//同步加载所有纹理的tail，一次提交，在关卡加载时调用
+		std::vector<Handle> registerTextures(const std::vector<std::string>& basePaths);
+
+		//按纹理在屏幕上的像素尺寸请求mip，每帧对可见纹理调用
+		void requestScreenSize(Handle handle, const glm::vec2& screenSize);
+
+		//直接请求某一级mip
+		void requestMip(Handle handle, uint32_t mipLevel);
+
+		//当前可用的bindless下标，调用时机与请求无关，永远立即返回
+		[[nodiscard]] uint32_t getTextureIndex(Handle handle) const;
+
+		/**
+		 * 每帧在renderpass之外调用一次：
+		 * 	回收已完成的读取并把上传录制到commandBuffer，切换到新的detail
+		 * 	为请求精度高于常驻精度的纹理发起新的读取，必要时按LRU淘汰
+		 * 	frameIndex对应的fence必须已经等待过
+		 */
+		void update(const CommandBufferPtr& commandBuffer, uint32_t frameIndex);
+
+		[[nodiscard]] VkDeviceSize getResidentBytes() const
+		{
+			return m_residentBytes;
+		}
+
+		[[nodiscard]] VkDeviceSize getBudget() const
+		{
+			return m_budget;
+		}
+
+		[[nodiscard]] uint32_t getResidentMip(Handle handle) const;
+
+		//最近一次update录制的上传字节数
+		[[nodiscard]] VkDeviceSize getLastUploadBytes() const
+		{
+			return m_lastUploadBytes;
+		}
+
+	 private:
+		struct LoadResult
+		{
+			uint32_t mipLevel{ 0 };
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			std::vector<std::vector<uint8_t>> levels;
+		};
+
+		struct StreamedTexture
+		{
+			Ktx2FilePtr file{ nullptr };
+			uint32_t width{ 0 };
+			uint32_t height{ 0 };
+			uint32_t levelCount{ 1 };
+			uint32_t tailLevel{ 0 };			//tail的第一级
+
+			ImagePtr tail{ nullptr };
+			uint32_t tailIndex{ BindlessHeap::INVALID_INDEX };
+
+			ImagePtr detail{ nullptr };
+			uint32_t detailIndex{ BindlessHeap::INVALID_INDEX };
+			uint32_t detailLevel{ 0 };			//detail的第一级，没有detail时等于tailLevel
+
+			uint32_t requestedLevel{ UINT32_MAX };	//本帧请求的最高精度，UINT32_MAX表示未被使用
+			uint64_t lastUsedFrame{ 0 };
+			std::list<Handle>::iterator lruPosition;
+
+			bool loading{ false };
+			std::future<LoadResult> pending;
+		};
+
+		static LoadResult loadLevels(const Ktx2FilePtr& file, uint32_t firstLevel, uint32_t levelCount);
+
+		void touch(Handle handle);
+
+		void finishLoads(const ImageUploaderPtr& uploader);
+
+		void startLoads();
+
+		//按LRU淘汰，直到能放下bytes，返回是否成功
+		bool makeRoom(VkDeviceSize bytes);
+
+		void evict(StreamedTexture& texture);
+
+		void retire(const ImagePtr& image);
+
+		void updateBudget();
+
+		VkDeviceSize estimateSize(const StreamedTexture& texture, uint32_t firstLevel) const;
+
+	 private:
+		VkDevice m_device{ VK_NULL_HANDLE };
+		VkPhysicalDevice m_physicalDevice{ VK_NULL_HANDLE };
+		BindlessHeapPtr m_bindlessHeap{ nullptr };
+		VkSampler m_sampler{ VK_NULL_HANDLE };
+		TextureStreamerConfig m_config{};
+		uint32_t m_framesInFlight{ 1 };
+
+		std::vector<StreamedTexture> m_textures;
+		std::list<Handle> m_lru;	//头部最近使用
+		uint32_t m_loadingCount{ 0 };
+
+		uint64_t m_frame{ 0 };
+		VkDeviceSize m_budget{ 0 };
+		VkDeviceSize m_residentBytes{ 0 };	//只统计detail，tail不参与淘汰
+		VkDeviceSize m_lastUploadBytes{ 0 };
+
+		//被替换的detail保留到使用它的帧全部执行完
+		struct RetiredImage
+		{
+			ImagePtr image;
+			uint32_t framesLeft;
+		};
+		std::vector<RetiredImage> m_retired;
+		std::vector<BufferPtr> m_stagingBuffers;
+	};
+
+} // ToyEngine
@@ -1,11 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <functional>
 
 namespace ToyEngine
 {
+	//把一个整型字段混入hash，各个cache的key和RenderGraph的物理资源key共用
+	//按整个64位值混合，不是逐字节的FNV；hash初值取0即可
+	inline void hashCombine(uint64_t& hash, uint64_t value)
+	{
+		hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+	}
+
 	template<typename T, typename U>
 	void removeNotSupportedElems(std::vector<T>& elems,
 		const std::vector<U>& supportedElems,
@@ -31,4 +39,59 @@ namespace ToyEngine
 
 		}
 	}
-}
+
+	//按64位key做LSD基数排序，稳定，每轮8位
+	//先一次性统计8个字节的直方图，所有元素在某个字节上都相同时跳过这一轮，key实际只用到低位时很快
+	//scratch至少要有count个元素
+	template<typename T, typename KeyFn>
+	void radixSort(T* items, T* scratch, size_t count, KeyFn keyOf)
+	{
+		if (count < 2)
+		{
+			return;
+		}
+
+		size_t histograms[8][256] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t key = keyOf(items[i]);
+			for (int b = 0; b < 8; b++)
+			{
+				histograms[b][(key >> (b * 8)) & 0xFF]++;
+			}
+		}
+
+		T* src = items;
+		T* dst = scratch;
+		for (int b = 0; b < 8; b++)
+		{
+			size_t* histogram = histograms[b];
+			uint64_t firstDigit = (keyOf(src[0]) >> (b * 8)) & 0xFF;
+			if (histogram[firstDigit] == count)
+			{
+				continue;
+			}
+
+			size_t offset = 0;
+			for (int d = 0; d < 256; d++)
+			{
+				size_t c = histogram[d];
+				histogram[d] = offset;
+				offset += c;
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				size_t digit = (keyOf(src[i]) >> (b * 8)) & 0xFF;
+				dst[histogram[digit]++] = src[i];
+			}
+
+			std::swap(src, dst);
+		}
+
+		if (src != items)
+		{
+			std::copy(src, src + count, items);
+		}
+	}
+}
\ No newline at end of file
@@ -17,6 +17,9 @@ namespace ToyEngine
 
 		void pollEvents() const;
 
+		//key为GLFW_KEY_*，当前是否按下
+		[[nodiscard]] bool isKeyPressed(int key) const;
+
 		[[nodiscard]] GLFWwindow* getWindow() const;
 
 		static WindowPtr creat(unsigned int width, unsigned int height);
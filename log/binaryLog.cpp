@@ -0,0 +1,578 @@
+#include "binaryLog.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef SPDLOG_FMT_EXTERNAL
+#include <fmt/args.h>
+#else
+#include "spdlog/fmt/bundled/args.h"
+#endif
+
+std::atomic<bool> BinaryLog::sRunning{ false };
+std::atomic<uint64_t> BinaryLog::sFrame{ 0 };
+
+//注册过的调用点，ID为下标加一，0表示还没有注册
+struct BinaryLogSiteInfo
+{
+	spdlog::level::level_enum level;
+	std::string file;
+	int line;
+	std::string format;
+};
+
+struct BinaryLogRecordHeader
+{
+	uint32_t formatId;
+	uint32_t size;		//参数部分的字节数
+	int64_t timeNs;		//system_clock，与spdlog的时间戳一致
+	uint64_t frame;
+	uint32_t thread;
+	uint32_t reserved;
+};
+
+//单生产者单消费者的字节环形缓冲，head/tail是累计字节数，取模得到位置
+struct BinaryLogRing
+{
+	std::vector<uint8_t> data = std::vector<uint8_t>(BinaryLog::RING_SIZE);
+	std::atomic<uint64_t> head{ 0 };
+	std::atomic<uint64_t> tail{ 0 };
+	std::atomic<uint64_t> dropped{ 0 };
+	uint32_t thread{ 0 };
+
+	void copyIn(uint64_t position, const void* src, size_t size)
+	{
+		auto offset = static_cast<size_t>(position % data.size());
+		size_t first = std::min(size, data.size() - offset);
+		std::memcpy(data.data() + offset, src, first);
+		std::memcpy(data.data(), static_cast<const uint8_t*>(src) + first, size - first);
+	}
+
+	void copyOut(uint64_t position, void* dst, size_t size) const
+	{
+		auto offset = static_cast<size_t>(position % data.size());
+		size_t first = std::min(size, data.size() - offset);
+		std::memcpy(dst, data.data() + offset, first);
+		std::memcpy(static_cast<uint8_t*>(dst) + first, data.data(), size - first);
+	}
+};
+
+//二进制文件中的块类型
+enum class BinaryLogChunk : uint8_t
+{
+	Format = 1,
+	Record = 2
+};
+
+static const char BINARY_LOG_MAGIC[8] = { 'T', 'O', 'Y', 'B', 'L', 'O', 'G', '1' };
+
+//解码时接受的最大格式ID，每个LOG_BIN调用点一个，远小于这个数
+static constexpr uint32_t MAX_DECODE_SITES = 1u << 16;
+
+static std::mutex s_sitesMutex;
+static std::deque<BinaryLogSiteInfo> s_sites;
+
+static std::mutex s_ringsMutex;
+static std::vector<std::shared_ptr<BinaryLogRing>> s_rings;
+
+//后台线程与Flush互斥取出记录
+static std::mutex s_drainMutex;
+static std::ofstream s_file;
+static std::vector<bool> s_writtenFormats;
+
+static std::mutex s_wakeMutex;
+static std::condition_variable s_wake;
+static std::thread s_thread;
+
+//正在Push且已经看到sRunning为true的线程数，End等它归零后再做最后一次drain
+static std::atomic<uint32_t> s_pushing{ 0 };
+
+static BinaryLogRing& getThreadRing()
+{
+	thread_local std::shared_ptr<BinaryLogRing> ring;
+	if (ring == nullptr)
+	{
+		ring = std::make_shared<BinaryLogRing>();
+		std::lock_guard<std::mutex> lock(s_ringsMutex);
+		ring->thread = static_cast<uint32_t>(s_rings.size());
+		s_rings.push_back(ring);
+	}
+	return *ring;
+}
+
+static int64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+//按参数标记解码，交给fmt格式化，参数与格式串不匹配时输出原始格式串
+static std::string formatRecord(const std::string& format, const uint8_t* args, uint32_t size)
+{
+	fmt::dynamic_format_arg_store<fmt::format_context> store;
+	const uint8_t* cursor = args;
+	const uint8_t* end = args + size;
+	//参数可能来自损坏的文件，每次读取前检查剩余长度
+	auto read = [&cursor, end](auto& value) {
+		if (static_cast<size_t>(end - cursor) < sizeof(value))
+		{
+			return false;
+		}
+		std::memcpy(&value, cursor, sizeof(value));
+		cursor += sizeof(value);
+		return true;
+	};
+	const auto corrupted = format + " <corrupted arguments>";
+
+	while (cursor < end)
+	{
+		auto type = static_cast<BinaryLogArg>(*cursor++);
+		switch (type)
+		{
+		case BinaryLogArg::Int:
+		{
+			int64_t value;
+			if (!read(value))
+			{
+				return corrupted;
+			}
+			store.push_back(value);
+			break;
+		}
+		case BinaryLogArg::UInt:
+		{
+			uint64_t value;
+			if (!read(value))
+			{
+				return corrupted;
+			}
+			store.push_back(value);
+			break;
+		}
+		case BinaryLogArg::Double:
+		{
+			double value;
+			if (!read(value))
+			{
+				return corrupted;
+			}
+			store.push_back(value);
+			break;
+		}
+		case BinaryLogArg::Bool:
+		{
+			uint8_t value;
+			if (!read(value))
+			{
+				return corrupted;
+			}
+			store.push_back(value != 0);
+			break;
+		}
+		case BinaryLogArg::Char:
+		{
+			char value;
+			if (!read(value))
+			{
+				return corrupted;
+			}
+			store.push_back(value);
+			break;
+		}
+		case BinaryLogArg::String:
+		{
+			uint32_t length;
+			if (!read(length) || static_cast<size_t>(end - cursor) < length)
+			{
+				return corrupted;
+			}
+			store.push_back(std::string(reinterpret_cast<const char*>(cursor), length));
+			cursor += length;
+			break;
+		}
+		case BinaryLogArg::Pointer:
+		{
+			uint64_t value;
+			if (!read(value))
+			{
+				return corrupted;
+			}
+			store.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(value)));
+			break;
+		}
+		default:
+			return corrupted;
+		}
+	}
+
+	try
+	{
+		return fmt::vformat(format, store);
+	}
+	catch (const std::exception& e)
+	{
+		return format + " <" + e.what() + ">";
+	}
+}
+
+static void logRecord(const BinaryLogSiteInfo& site, const BinaryLogRecordHeader& header, const uint8_t* args)
+{
+	if (Log::sLogger == nullptr)
+	{
+		return;
+	}
+
+	auto message = formatRecord(site.format, args, header.size);
+	if (header.frame != 0)
+	{
+		message = fmt::format("[frame {}] {}", header.frame, message);
+	}
+	auto time = spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(
+		std::chrono::nanoseconds(header.timeNs)));
+	Log::sLogger->log(time, spdlog::source_loc{ site.file.c_str(), site.line, "" }, site.level, message);
+}
+
+template<typename T>
+static void writeValue(std::ostream& out, const T& value)
+{
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void writeString(std::ostream& out, const std::string& value)
+{
+	writeValue(out, static_cast<uint32_t>(value.size()));
+	out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+template<typename T>
+static bool readValue(std::istream& in, T& value)
+{
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+//length超过maxLength时视为损坏，不分配内存
+static bool readString(std::istream& in, std::string& value, uint64_t maxLength)
+{
+	uint32_t length;
+	if (!readValue(in, length) || length > maxLength)
+	{
+		return false;
+	}
+	value.resize(length);
+	return static_cast<bool>(in.read(value.data(), length));
+}
+
+//deque追加元素不会让已有元素的引用失效
+static const BinaryLogSiteInfo& getSite(uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(s_sitesMutex);
+	return s_sites[id - 1];
+}
+
+//调用前持有s_drainMutex
+static void emitRecord(const BinaryLogRecordHeader& header, const uint8_t* args)
+{
+	if (!s_file.is_open())
+	{
+		logRecord(getSite(header.formatId), header, args);
+		return;
+	}
+
+	//每个格式串在第一次用到时写一次，文件本身就能解码
+	if (s_writtenFormats.size() < header.formatId + 1)
+	{
+		s_writtenFormats.resize(header.formatId + 1, false);
+	}
+	if (!s_writtenFormats[header.formatId])
+	{
+		const auto& site = getSite(header.formatId);
+		writeValue(s_file, BinaryLogChunk::Format);
+		writeValue(s_file, header.formatId);
+		writeValue(s_file, static_cast<int32_t>(site.level));
+		writeValue(s_file, static_cast<int32_t>(site.line));
+		writeString(s_file, site.file);
+		writeString(s_file, site.format);
+		s_writtenFormats[header.formatId] = true;
+	}
+
+	writeValue(s_file, BinaryLogChunk::Record);
+	writeValue(s_file, header);
+	s_file.write(reinterpret_cast<const char*>(args), header.size);
+}
+
+static void drainRings()
+{
+	std::vector<std::shared_ptr<BinaryLogRing>> rings;
+	{
+		std::lock_guard<std::mutex> lock(s_ringsMutex);
+		rings = s_rings;
+	}
+
+	std::lock_guard<std::mutex> lock(s_drainMutex);
+	std::vector<uint8_t> args;
+	for (const auto& ring : rings)
+	{
+		uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		while (tail < head)
+		{
+			BinaryLogRecordHeader header{};
+			ring->copyOut(tail, &header, sizeof(header));
+			args.resize(header.size);
+			ring->copyOut(tail + sizeof(header), args.data(), header.size);
+			tail += sizeof(header) + header.size;
+			emitRecord(header, args.data());
+		}
+		ring->tail.store(tail, std::memory_order_release);
+	}
+
+	if (s_file.is_open())
+	{
+		s_file.flush();
+	}
+}
+
+static void drainLoop()
+{
+	while (BinaryLog::IsRunning())
+	{
+		{
+			std::unique_lock<std::mutex> lock(s_wakeMutex);
+			s_wake.wait_for(lock, std::chrono::milliseconds(5));
+		}
+		drainRings();
+	}
+}
+
+void BinaryLog::Init(const char* path)
+{
+	if (IsRunning())
+	{
+		return;
+	}
+
+	if (path != nullptr && path[0] != '\0')
+	{
+		s_file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!s_file.is_open())
+		{
+			LOG_E("Failed to open binary log file {}, formatting in background instead.", path);
+		}
+		else
+		{
+			s_file.write(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+			s_writtenFormats.clear();
+			LOG_I("Binary log is written to {}.", path);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_ringsMutex);
+		for (const auto& ring : s_rings)
+		{
+			ring->dropped.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	sRunning.store(true, std::memory_order_release);
+	s_thread = std::thread(drainLoop);
+}
+
+void BinaryLog::End()
+{
+	if (!IsRunning())
+	{
+		return;
+	}
+
+	//与Push中的s_pushing/sRunning是seq_cst配对：Push要么看到停止后在本线程格式化，要么在这里被等到
+	sRunning.store(false);
+	while (s_pushing.load() != 0)
+	{
+		std::this_thread::yield();
+	}
+	s_wake.notify_all();
+	s_thread.join();
+	drainRings();
+
+	auto dropped = GetDroppedCount();
+	if (dropped > 0)
+	{
+		LOG_W("Binary log dropped {} records because a thread ring was full.", dropped);
+	}
+
+	std::lock_guard<std::mutex> lock(s_drainMutex);
+	if (s_file.is_open())
+	{
+		s_file.close();
+	}
+}
+
+void BinaryLog::Flush()
+{
+	drainRings();
+}
+
+uint64_t BinaryLog::GetDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+	uint64_t dropped = 0;
+	for (const auto& ring : s_rings)
+	{
+		dropped += ring->dropped.load(std::memory_order_relaxed);
+	}
+	return dropped;
+}
+
+bool BinaryLog::Decode(const std::string& path, std::ostream& out)
+{
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	char magic[sizeof(BINARY_LOG_MAGIC)]{};
+	if (!in.is_open() || !in.read(magic, sizeof(magic))
+		|| std::memcmp(magic, BINARY_LOG_MAGIC, sizeof(magic)) != 0)
+	{
+		LOG_E("{} is not a binary log file.", path);
+		return false;
+	}
+
+	//文件里的ID和长度在分配内存前都要与剩余字节数比较，损坏的文件不能让解码器越界或申请几GB内存
+	in.seekg(0, std::ios::end);
+	const auto fileSize = static_cast<uint64_t>(in.tellg());
+	in.seekg(sizeof(BINARY_LOG_MAGIC), std::ios::beg);
+	auto remaining = [&in, fileSize]() {
+		auto position = in.tellg();
+		return position < 0 ? 0 : fileSize - static_cast<uint64_t>(position);
+	};
+
+	std::vector<BinaryLogSiteInfo> sites;
+	std::vector<uint8_t> args;
+	int64_t firstNs = 0;
+	BinaryLogChunk chunk;
+	while (readValue(in, chunk))
+	{
+		if (chunk == BinaryLogChunk::Format)
+		{
+			uint32_t id;
+			int32_t level;
+			int32_t line;
+			BinaryLogSiteInfo site{};
+			if (!readValue(in, id) || !readValue(in, level) || !readValue(in, line))
+			{
+				break;
+			}
+			if (id == 0 || id > MAX_DECODE_SITES
+				|| !readString(in, site.file, remaining()) || !readString(in, site.format, remaining()))
+			{
+				LOG_E("Binary log {} is corrupted: invalid format chunk {}.", path, id);
+				return false;
+			}
+			site.level = static_cast<spdlog::level::level_enum>(level);
+			site.line = line;
+			if (sites.size() < id)
+			{
+				sites.resize(id);
+			}
+			sites[id - 1] = std::move(site);
+		}
+		else if (chunk == BinaryLogChunk::Record)
+		{
+			BinaryLogRecordHeader header{};
+			if (!readValue(in, header))
+			{
+				break;
+			}
+			//一条记录必须能放进一个线程的环形缓冲
+			if (header.formatId == 0 || header.formatId > sites.size()
+				|| header.size > RING_SIZE - sizeof(header) || header.size > remaining())
+			{
+				LOG_E("Binary log {} is corrupted: invalid record of format {}.", path, header.formatId);
+				return false;
+			}
+			args.resize(header.size);
+			if (!in.read(reinterpret_cast<char*>(args.data()), header.size))
+			{
+				break;
+			}
+
+			//时间相对第一条记录，单位秒
+			if (firstNs == 0)
+			{
+				firstNs = header.timeNs;
+			}
+			const auto& site = sites[header.formatId - 1];
+			auto levelName = spdlog::level::to_short_c_str(site.level);
+			out << fmt::format("[{:.6f}] [frame {}] [thread {}] [{}] {}\n",
+				static_cast<double>(header.timeNs - firstNs) / 1e9, header.frame, header.thread, levelName,
+				formatRecord(site.format, args.data(), header.size));
+		}
+		else
+		{
+			LOG_E("Binary log {} is corrupted.", path);
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t BinaryLog::RegisterSite(BinaryLogSite& site,
+	spdlog::level::level_enum level,
+	const char* file,
+	int line,
+	const char* format)
+{
+	std::lock_guard<std::mutex> lock(s_sitesMutex);
+	uint32_t id = site.id.load(std::memory_order_relaxed);
+	if (id == 0)
+	{
+		s_sites.push_back({ level, file, line, format });
+		id = static_cast<uint32_t>(s_sites.size());
+		site.id.store(id, std::memory_order_release);
+	}
+	return id;
+}
+
+std::vector<uint8_t>& BinaryLog::GetScratch()
+{
+	thread_local std::vector<uint8_t> scratch;
+	return scratch;
+}
+
+void BinaryLog::Push(uint32_t id, const std::vector<uint8_t>& args)
+{
+	BinaryLogRecordHeader header{};
+	header.formatId = id;
+	header.size = static_cast<uint32_t>(args.size());
+	header.timeNs = nowNs();
+	header.frame = sFrame.load(std::memory_order_relaxed);
+
+	//没有后台线程时在调用线程直接格式化
+	s_pushing.fetch_add(1);
+	if (!sRunning.load())
+	{
+		s_pushing.fetch_sub(1);
+		logRecord(getSite(id), header, args.data());
+		return;
+	}
+
+	auto& ring = getThreadRing();
+	header.thread = ring.thread;
+	uint64_t size = sizeof(header) + args.size();
+	uint64_t head = ring.head.load(std::memory_order_relaxed);
+	uint64_t tail = ring.tail.load(std::memory_order_acquire);
+	if (ring.data.size() - (head - tail) < size)
+	{
+		ring.dropped.fetch_add(1, std::memory_order_relaxed);
+		s_pushing.fetch_sub(1, std::memory_order_release);
+		return;
+	}
+
+	ring.copyIn(head, &header, sizeof(header));
+	ring.copyIn(head + sizeof(header), args.data(), args.size());
+	ring.head.store(head + size, std::memory_order_release);
+	s_pushing.fetch_sub(1, std::memory_order_release);
+}
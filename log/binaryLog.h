@@ -0,0 +1,195 @@
+#pragma once
+
+#include "logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+//LOG_BIN调用点，第一次调用时注册格式串得到ID，之后只比较一次原子变量
+struct BinaryLogSite
+{
+	std::atomic<uint32_t> id{ 0 };
+};
+
+//参数类型标记，每个参数写成一个字节的标记加定长或带长度的数据
+enum class BinaryLogArg : uint8_t
+{
+	Int = 0,
+	UInt,
+	Double,
+	Bool,
+	Char,
+	String,
+	Pointer
+};
+
+/**
+ * BinaryLog
+ * 	延迟格式化的日志：调用线程只把格式ID、时间戳、帧号和原始参数写进本线程的环形缓冲，
+ * 	后台线程取出后再格式化交给spdlog，或者原样写进二进制文件，之后用Decode离线还原成文本
+ * 	每个线程一个单生产者单消费者的环形缓冲，写满时丢弃新记录并计数，调用线程永远不会阻塞
+ * 	Init之前或End之后的调用直接在调用线程格式化，行为与LOG_*相同
+ * 	参数只支持整数、浮点、bool、char、字符串和指针，字符串会被拷贝(最长MAX_STRING字节)
+ */
+class BinaryLog
+{
+ public:
+	static constexpr uint32_t RING_SIZE = 1u << 20;	//每个线程1MB
+	static constexpr uint32_t MAX_STRING = 4096;
+
+	BinaryLog() = delete;
+	BinaryLog(const BinaryLog &) = delete;
+	BinaryLog &operator=(const BinaryLog &) = delete;
+
+	//path为空时后台线程格式化后输出到Log的logger，否则写入二进制文件
+	static void Init(const char *path = nullptr);
+
+	//停止后台线程并输出剩余的记录，会等待正在写环形缓冲的线程写完，之后的调用在调用线程格式化
+	static void End();
+
+	[[nodiscard]] static bool IsRunning()
+	{
+		return sRunning.load(std::memory_order_acquire);
+	}
+
+	//之后写入的记录都带上这个帧号，主循环每帧开始时设置
+	static void SetFrame(uint64_t frame)
+	{
+		sFrame.store(frame, std::memory_order_relaxed);
+	}
+
+	//在调用线程立即取出所有线程已经写入的记录
+	static void Flush();
+
+	//环形缓冲写满丢弃的记录数
+	[[nodiscard]] static uint64_t GetDroppedCount();
+
+	//把Init(path)写出的二进制文件还原成文本
+	static bool Decode(const std::string &path, std::ostream &out);
+
+	template<typename... Args>
+	static void Write(BinaryLogSite &site,
+		spdlog::level::level_enum level,
+		const char *file,
+		int line,
+		const char *format,
+		const Args &... args)
+	{
+		uint32_t id = site.id.load(std::memory_order_acquire);
+		if (id == 0)
+		{
+			id = RegisterSite(site, level, file, line, format);
+		}
+
+		auto &buffer = GetScratch();
+		buffer.clear();
+		(EncodeArg(buffer, args), ...);
+		Push(id, buffer);
+	}
+
+ private:
+	static uint32_t RegisterSite(BinaryLogSite &site,
+		spdlog::level::level_enum level,
+		const char *file,
+		int line,
+		const char *format);
+
+	static std::vector<uint8_t> &GetScratch();
+
+	static void Push(uint32_t id, const std::vector<uint8_t> &args);
+
+	template<typename T>
+	static void Append(std::vector<uint8_t> &buffer, const T &value)
+	{
+		auto offset = buffer.size();
+		buffer.resize(offset + sizeof(T));
+		std::memcpy(buffer.data() + offset, &value, sizeof(T));
+	}
+
+	static void AppendString(std::vector<uint8_t> &buffer, std::string_view value)
+	{
+		auto length = static_cast<uint32_t>(std::min<size_t>(value.size(), MAX_STRING));
+		buffer.push_back(static_cast<uint8_t>(BinaryLogArg::String));
+		Append(buffer, length);
+		buffer.insert(buffer.end(), value.data(), value.data() + length);
+	}
+
+	template<typename T>
+	static void EncodeArg(std::vector<uint8_t> &buffer, const T &value)
+	{
+		using Type = std::decay_t<T>;
+		if constexpr (std::is_same_v<Type, bool>)
+		{
+			buffer.push_back(static_cast<uint8_t>(BinaryLogArg::Bool));
+			buffer.push_back(value ? 1 : 0);
+		}
+		else if constexpr (std::is_same_v<Type, char>)
+		{
+			buffer.push_back(static_cast<uint8_t>(BinaryLogArg::Char));
+			buffer.push_back(static_cast<uint8_t>(value));
+		}
+		else if constexpr (std::is_enum_v<Type>)
+		{
+			EncodeArg(buffer, static_cast<std::underlying_type_t<Type>>(value));
+		}
+		else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>)
+		{
+			buffer.push_back(static_cast<uint8_t>(BinaryLogArg::Int));
+			Append(buffer, static_cast<int64_t>(value));
+		}
+		else if constexpr (std::is_integral_v<Type>)
+		{
+			buffer.push_back(static_cast<uint8_t>(BinaryLogArg::UInt));
+			Append(buffer, static_cast<uint64_t>(value));
+		}
+		else if constexpr (std::is_floating_point_v<Type>)
+		{
+			buffer.push_back(static_cast<uint8_t>(BinaryLogArg::Double));
+			Append(buffer, static_cast<double>(value));
+		}
+		else if constexpr (std::is_same_v<Type, const char *> || std::is_same_v<Type, char *>)
+		{
+			AppendString(buffer, value != nullptr ? std::string_view(value) : std::string_view("(null)"));
+		}
+		else if constexpr (std::is_convertible_v<const Type &, std::string_view>)
+		{
+			AppendString(buffer, std::string_view(value));
+		}
+		else if constexpr (std::is_pointer_v<Type>)
+		{
+			buffer.push_back(static_cast<uint8_t>(BinaryLogArg::Pointer));
+			Append(buffer, reinterpret_cast<uint64_t>(value));
+		}
+		else
+		{
+			static_assert(sizeof(Type) == 0, "BinaryLog argument type is not supported.");
+		}
+	}
+
+ private:
+	static std::atomic<bool> sRunning;
+	static std::atomic<uint64_t> sFrame;
+};
+
+#define LOG_BIN_LEVEL_T spdlog::level::trace
+#define LOG_BIN_LEVEL_D spdlog::level::debug
+#define LOG_BIN_LEVEL_I spdlog::level::info
+#define LOG_BIN_LEVEL_W spdlog::level::warn
+#define LOG_BIN_LEVEL_E spdlog::level::err
+
+//用法与LOG_*相同，level为T/D/I/W/E，第一个参数必须是字符串字面量
+#define LOG_BIN(level, ...)                                                                    \
+	do                                                                                         \
+	{                                                                                          \
+		if constexpr (LOG_ENABLED_##level)                                                     \
+		{                                                                                      \
+			static BinaryLogSite toyLogSite{};                                                 \
+			BinaryLog::Write(toyLogSite, LOG_BIN_LEVEL_##level, __FILE__, __LINE__, __VA_ARGS__); \
+		}                                                                                      \
+	} while (0)
@@ -1,19 +1,22 @@
 #include "logger.h"
-#include "logger.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/async.h"
 
 std::shared_ptr<spdlog::logger> Log::sLoggerInstance{};
+spdlog::logger *Log::sLogger{ nullptr };
 
 void Log::Init()
 {
 	sLoggerInstance = spdlog::stderr_color_mt<spdlog::async_factory>("Logger:");
-	sLoggerInstance->set_level(spdlog::level::trace);
+	sLogger = sLoggerInstance.get();
+	//运行期等级与编译期一致，被裁掉的等级本来就不会调用到logger
+	sLoggerInstance->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
 	sLoggerInstance->set_pattern("[%H:%M:%S %z] [%n] [%^---%L---%$] [thread %t] %v");
 	//sLoggerInstance->set_pattern("%n [%^----%L----%$] %v. [%s:%#]");
 }
 
 void Log::End()
 {
+	sLogger = nullptr;
 	sLoggerInstance.reset();
 }
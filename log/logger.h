@@ -1,8 +1,19 @@
 #pragma once
 
+//编译期日志等级，低于该等级的LOG_*在预处理阶段就被替换为空，参数也不会求值
+//CMake按构建类型设置(见log/CMakeLists.txt)，没有设置时Release为info，其它为trace
+#ifndef SPDLOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#else
 #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+#endif
 #include "spdlog/spdlog.h"
 
+#include <atomic>
+#include <chrono>
+
 class Log
 {
  public:
@@ -16,18 +27,85 @@ class Log
 
 	static spdlog::logger *GetLoggerInstance()
 	{
-		assert(sLoggerInstance && "Logger instance is null,maybe you have not execute Log::Init().");
-		return sLoggerInstance.get();
+		assert(sLogger && "Logger instance is null,maybe you have not execute Log::Init().");
+		return sLogger;
+	}
+
+	//LOG_EVERY_N使用，第1、n + 1、2n + 1...次调用返回true
+	static bool ShouldLogEveryN(std::atomic<uint32_t> &counter, uint32_t n)
+	{
+		return counter.fetch_add(1, std::memory_order_relaxed) % (n == 0 ? 1 : n) == 0;
 	}
 
+	//LOG_EVERY_MS使用，距离上一次输出超过intervalMs时返回true，多个线程同时到达时只有一个返回true
+	static bool ShouldLogEveryMs(std::atomic<int64_t> &lastMs, int64_t intervalMs)
+	{
+		auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		auto last = lastMs.load(std::memory_order_relaxed);
+		return now - last >= intervalMs && lastMs.compare_exchange_strong(last, now, std::memory_order_relaxed);
+	}
+
+ public:
+	//LOG_*直接读取缓存的裸指针，不再经过shared_ptr和assert
+	static spdlog::logger *sLogger;
+
  private:
 	static std::shared_ptr<spdlog::logger> sLoggerInstance;
 };
 
-#define LOG_T(...) SPDLOG_LOGGER_TRACE(Log::GetLoggerInstance(), __VA_ARGS__, __FILE__, __LINE__)
-#define LOG_D(...) SPDLOG_LOGGER_DEBUG(Log::GetLoggerInstance(), __VA_ARGS__, __FILE__, __LINE__)
-#define LOG_I(...) SPDLOG_LOGGER_INFO(Log::GetLoggerInstance(), __VA_ARGS__)
-#define LOG_W(...) SPDLOG_LOGGER_WARN(Log::GetLoggerInstance(), __VA_ARGS__, __FILE__, __LINE__)
-#define LOG_E(...) SPDLOG_LOGGER_ERROR(Log::GetLoggerInstance(), __VA_ARGS__, __FILE__, __LINE__)
+#define LOG_T(...) SPDLOG_LOGGER_TRACE(Log::sLogger, __VA_ARGS__)
+#define LOG_D(...) SPDLOG_LOGGER_DEBUG(Log::sLogger, __VA_ARGS__)
+#define LOG_I(...) SPDLOG_LOGGER_INFO(Log::sLogger, __VA_ARGS__)
+#define LOG_W(...) SPDLOG_LOGGER_WARN(Log::sLogger, __VA_ARGS__)
+#define LOG_E(...) SPDLOG_LOGGER_ERROR(Log::sLogger, __VA_ARGS__)
+
+//level为T/D/I/W/E，对应等级在编译期被裁掉时整条语句(包括计数器)都不会生成代码
+#define LOG_ENABLED_T (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE)
+#define LOG_ENABLED_D (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG)
+#define LOG_ENABLED_I (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO)
+#define LOG_ENABLED_W (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN)
+#define LOG_ENABLED_E (SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR)
+
+//每帧都可能执行的路径使用下面的宏，避免刷屏
+//每个调用点只输出一次
+#define LOG_ONCE(level, ...)                                                   \
+	do                                                                         \
+	{                                                                          \
+		if constexpr (LOG_ENABLED_##level)                                     \
+		{                                                                      \
+			static std::atomic<bool> toyLogDone{ false };                      \
+			if (!toyLogDone.exchange(true, std::memory_order_relaxed))         \
+			{                                                                  \
+				LOG_##level(__VA_ARGS__);                                      \
+			}                                                                  \
+		}                                                                      \
+	} while (0)
 
+//每个调用点每n次输出一次，从第一次开始
+#define LOG_EVERY_N(level, n, ...)                                             \
+	do                                                                         \
+	{                                                                          \
+		if constexpr (LOG_ENABLED_##level)                                     \
+		{                                                                      \
+			static std::atomic<uint32_t> toyLogCounter{ 0 };                   \
+			if (Log::ShouldLogEveryN(toyLogCounter, (n)))                      \
+			{                                                                  \
+				LOG_##level(__VA_ARGS__);                                      \
+			}                                                                  \
+		}                                                                      \
+	} while (0)
 
+//每个调用点每intervalMs毫秒最多输出一次
+#define LOG_EVERY_MS(level, intervalMs, ...)                                   \
+	do                                                                         \
+	{                                                                          \
+		if constexpr (LOG_ENABLED_##level)                                     \
+		{                                                                      \
+			static std::atomic<int64_t> toyLogLastMs{ INT64_MIN / 2 };         \
+			if (Log::ShouldLogEveryMs(toyLogLastMs, (intervalMs)))             \
+			{                                                                  \
+				LOG_##level(__VA_ARGS__);                                      \
+			}                                                                  \
+		}                                                                      \
+	} while (0)
@@ -0,0 +1,23 @@
+//bindless资源表，与BindlessHeap的set layout一一对应
+//使用方式：#include "bindless.glsl"，再通过push constant传入的下标访问
+//纹理统一以2D数组视图注册，普通纹理layer取0，图集按页取layer
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+#ifndef BINDLESS_SET
+#define BINDLESS_SET 0
+#endif
+
+#define BINDLESS_INVALID_INDEX 0xFFFFFFFFu
+
+layout(set = BINDLESS_SET, binding = 0) uniform sampler2DArray bindlessTextures[];
+
+layout(std430, set = BINDLESS_SET, binding = 1) readonly buffer BindlessBuffer
+{
+    uint words[];
+} bindlessBuffers[];
+
+vec4 sampleBindless(uint textureIndex, vec3 uvLayer)
+{
+    return texture(bindlessTextures[nonuniformEXT(textureIndex)], uvLayer);
+}
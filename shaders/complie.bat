@@ -1,4 +1,6 @@
 C:\VulkanSDK\1.3.296.0\Bin\glslangValidator.exe -V shader.vert -o vs.spv
 C:\VulkanSDK\1.3.296.0\Bin\glslangValidator.exe -V shader.frag -o fs.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslangValidator.exe -V sprite.vert -o sprite_vs.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslangValidator.exe -V sprite.frag -o sprite_fs.spv
 
 pause
\ No newline at end of file
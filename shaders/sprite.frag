@@ -0,0 +1,23 @@
+#version 460
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec4 inColor;
+layout(location = 1) in vec3 inUVLayer;
+layout(location = 2) flat in uint inTextureIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    if (inTextureIndex == BINDLESS_INVALID_INDEX)
+    {
+        outColor = inColor;
+    }
+    else
+    {
+        outColor = inColor * sampleBindless(inTextureIndex, inUVLayer);
+    }
+}
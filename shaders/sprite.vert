@@ -0,0 +1,45 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+
+//实例数据，对应SpriteInstance
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inSize;
+layout(location = 2) in vec4 inUVRect;
+layout(location = 3) in float inRotation;
+layout(location = 4) in vec4 inColor;
+layout(location = 5) in uint inTextureIndex;
+layout(location = 6) in uint inLayer;
+layout(location = 7) in float inDepth;
+
+layout(push_constant) uniform SpritePushConstants
+{
+    mat4 viewProjection;
+} pc;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec3 outUVLayer;
+layout(location = 2) flat out uint outTextureIndex;
+
+//四边形的4个角，顶点由gl_VertexIndex生成，不需要顶点buffer
+//index为4q + {0, 1, 2, 2, 3, 0}(QuadIndexBuffer)，两个三角形共用对角线上的两个顶点
+//取低两位得到角的编号，使用任意四边形的index或base vertex分段时都有效
+const vec2 corners[4] = vec2[](
+    vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5)
+);
+
+void main() {
+    vec2 corner = corners[gl_VertexIndex & 3];
+    vec2 local = corner * inSize;
+
+    float s = sin(inRotation);
+    float c = cos(inRotation);
+    vec2 world = vec2(local.x * c - local.y * s, local.x * s + local.y * c) + inPosition;
+
+    //正交投影w为1，深度直接写入z，0最近
+    gl_Position = pc.viewProjection * vec4(world, 0.0, 1.0);
+    gl_Position.z = inDepth;
+    outColor = inColor;
+    outUVLayer = vec3(mix(inUVRect.xy, inUVRect.zw, corner + 0.5), float(inLayer));
+    outTextureIndex = inTextureIndex;
+}
@@ -1,6 +1,9 @@
 #include "application.h"
 #include "logger.h"
+#include "binaryLog.h"
 #include "context.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <sstream>
 
 namespace ToyEngine
 {
@@ -8,6 +11,8 @@ namespace ToyEngine
 	void Application::run()
 	{
 		Log::Init();
+		//设置TOY2D_BINARY_LOG时写入二进制文件离线解码，否则在后台线程格式化
+		BinaryLog::Init(std::getenv("TOY2D_BINARY_LOG"));
 		initWindow();
 		initVulkan();
 		mainLoop();
@@ -21,42 +26,81 @@ namespace ToyEngine
 
 	void Application::initVulkan()
 	{
-		Context::Init(true, m_window->getWindow());
+		TOY_PROFILE_FUNCTION();
+		TOY_PROFILE_THREAD("main");
+
+		//验证层每次API调用都有不小的CPU开销，Release默认关闭，用TOY2D_VALIDATION覆盖
+		Context::Init(ValidationConfig::fromEnvironment(), m_window->getWindow());
 		m_swapChain = SwapChain::create(vkContext.vk_device,
 			vkContext.vk_surface, m_window);
 
-		m_renderpass = Renderpass::create(vkContext.vk_device);
-		createRenderpass();
+		m_renderpassCache = RenderpassCache::create(vkContext.vk_device);
+		m_framebufferCache = FramebufferCache::create(vkContext.vk_device, m_swapChain->getImageCount());
+		m_depthFormat = findDepthFormat(vkContext.vk_physicalDevice);
+		m_sampleCount = clampSampleCount(vkContext.vk_physicalDevice, MSAA_SAMPLES);
+		m_requestedSampleCount = m_sampleCount;
+
+		//framebuffer由RenderGraph按pass的附件从缓存中获取，动态渲染时两者都不需要
+		m_renderGraph = RenderGraph::create(vkContext.vk_device, vkContext.vk_physicalDevice,
+			m_renderpassCache, m_framebufferCache, m_swapChain->getImageCount());
+		m_renderGraph->setDynamicRendering(PREFER_DYNAMIC_RENDERING);
+
+		m_gpuProfiler = GpuProfiler::create(vkContext.vk_device, vkContext.vk_physicalDevice,
+			vkContext.vk_graphicsQueueFamilyIndex.value(), m_swapChain->getImageCount());
+		m_renderGraph->setProfiler(m_gpuProfiler);
+		m_frameStats = FrameStats::create();
+		if (!m_renderGraph->isDynamicRendering())
+		{
+			createRenderpass();
+		}
 
-		m_swapChain->createFramebuffers(m_renderpass);
+		m_bindlessHeap = BindlessHeap::create(vkContext.vk_device, m_swapChain->getImageCount());
+		m_samplerCache = SamplerCache::create(vkContext.vk_device);
+		createTextures();
+		m_textureStreamer = TextureStreamer::create(vkContext.vk_device, vkContext.vk_physicalDevice,
+			m_bindlessHeap, m_samplerCache, m_swapChain->getImageCount());
+		//TOY2D_STREAMED_TEXTURES为';'分隔、不带扩展名的KTX2路径，每张纹理一个缩放中的sprite
+		if (const char* value = std::getenv("TOY2D_STREAMED_TEXTURES"))
+		{
+			std::vector<std::string> basePaths;
+			std::stringstream paths(value);
+			for (std::string path; std::getline(paths, path, ';');)
+			{
+				if (!path.empty())
+				{
+					basePaths.push_back(path);
+				}
+			}
+			m_streamedTextures = m_textureStreamer->registerTextures(basePaths);
+		}
+		//sprite是instanced draw，每次只用第一个四边形的6个index
+		m_quadIndexBuffer = QuadIndexBuffer::create(vkContext.vk_device, vkContext.vk_physicalDevice, 1);
+		m_spriteRenderer = SpriteRenderer::create(vkContext.vk_device, vkContext.vk_physicalDevice,
+			m_bindlessHeap, m_swapChain->getImageCount(), MAX_SPRITES, m_quadIndexBuffer);
+		m_drawStream = DrawStream::create(MAX_DRAW_COMMANDS);
+
+		m_opaquePipeline = Pipeline::create(vkContext.vk_device, m_renderpass);
+		m_transparentPipeline = Pipeline::create(vkContext.vk_device, m_renderpass);
+		if (m_renderpass == nullptr)
+		{
+			m_opaquePipeline->setRenderingFormats({ m_swapChain->getImageFormat() }, m_depthFormat);
+			m_transparentPipeline->setRenderingFormats({ m_swapChain->getImageFormat() }, m_depthFormat);
+		}
+		createPipeline(m_opaquePipeline, false);
+		createPipeline(m_transparentPipeline, true);
+		m_opaquePipelineId = m_spriteRenderer->addPipeline(m_opaquePipeline, false);
+		m_transparentPipelineId = m_spriteRenderer->addPipeline(m_transparentPipeline, true);
 
-		m_pipeline = Pipeline::create(vkContext.vk_device, m_renderpass);
-		createPipeline();
+		//像素坐标，原点在左上角，vulkan的NDC y轴向下所以不需要翻转
+		m_spriteRenderer->setViewProjection(glm::ortho(0.0f, (float)WIDTH, 0.0f, (float)HEIGHT));
 
 		m_commandPool = CommandPool::create(vkContext.vk_device, vkContext.vk_graphicsQueueFamilyIndex.value());
 
+		//命令缓冲按飞行帧分配，每帧重新录制
 		m_commandBuffers.resize(m_swapChain->getImageCount());
 		for (size_t i = 0; i < m_swapChain->getImageCount(); i++)
 		{
 			m_commandBuffers[i] = CommandBuffer::create(vkContext.vk_device, m_commandPool);
-
-			m_commandBuffers[i]->begin();
-			VkRenderPassBeginInfo renderPassInfo{};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = m_renderpass->getRenderPass();
-			renderPassInfo.framebuffer = m_swapChain->getFramebuffers()[i];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = m_swapChain->getExtent();
-
-			VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-			renderPassInfo.clearValueCount = 1;
-			renderPassInfo.pClearValues = &clearColor;
-
-			m_commandBuffers[i]->beginRenderPass(renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-			m_commandBuffers[i]->bindGraphicPipeline(m_pipeline->getPipeline());
-			m_commandBuffers[i]->draw(3);
-			m_commandBuffers[i]->endRenderPass();
-			m_commandBuffers[i]->end();
 		}
 
 		for (int i = 0; i < m_swapChain->getImageCount(); i++)
@@ -74,25 +118,163 @@ namespace ToyEngine
 
 	void Application::mainLoop()
 	{
+		for (auto& packet : m_framePackets)
+		{
+			m_freePackets.tryPush(&packet);
+		}
+		if (USE_RENDER_THREAD)
+		{
+			m_renderThread = std::thread(&Application::renderLoop, this);
+		}
+
+		uint64_t frameIndex = 0;
 		while (!m_window->shouldClose())
 		{
+			TOY_PROFILE_FRAME();
 			m_window->pollEvents();
 
-			render();
+			//按下的那一帧切换一次，真正的切换在渲染线程处理packet时进行
+			bool msaaKeyDown = m_window->isKeyPressed(GLFW_KEY_M);
+			if (msaaKeyDown && !m_msaaKeyDown)
+			{
+				//超过设备支持的最大采样数后回到1x
+				auto next = static_cast<VkSampleCountFlagBits>(m_requestedSampleCount << 1);
+				if (next > VK_SAMPLE_COUNT_8_BIT
+					|| clampSampleCount(vkContext.vk_physicalDevice, next) == m_requestedSampleCount)
+				{
+					next = VK_SAMPLE_COUNT_1_BIT;
+				}
+				m_requestedSampleCount = next;
+			}
+			m_msaaKeyDown = msaaKeyDown;
+
+			//渲染线程还在录制上一个packet时在这里等待，而不是在fence或present上
+			FramePacket* packet = nullptr;
+			{
+				TOY_PROFILE_ZONE("wait packet");
+				if (!m_freePackets.pop(packet, m_renderThreadFailed))
+				{
+					break;
+				}
+			}
+
+			{
+				TOY_PROFILE_ZONE("updateScene");
+				packet->frameIndex = frameIndex++;
+				packet->sampleCount = m_requestedSampleCount;
+				updateScene(*packet);
+			}
+
+			if (USE_RENDER_THREAD)
+			{
+				m_submittedPackets.push(packet, m_renderThreadFailed);
+			}
+			else
+			{
+				m_frameStats->beginFrame();
+				drawFrame(*packet);
+			}
+		}
+
+		if (m_renderThread.joinable())
+		{
+			//渲染线程先处理完已经入队的packet再退出
+			m_renderThreadStop.store(true, std::memory_order_release);
+			m_submittedPackets.wakeAll();
+			m_renderThread.join();
 		}
 
 		vkDeviceWaitIdle(vkContext.vk_device);
+
+		if (m_renderThreadError)
+		{
+			std::rethrow_exception(m_renderThreadError);
+		}
 	}
 
-	void Application::render()
+	void Application::renderLoop()
 	{
+		TOY_PROFILE_THREAD("render");
+
+		try
+		{
+			while (true)
+			{
+				m_frameStats->beginFrame();
+				FramePacket* packet = nullptr;
+				{
+					TOY_PROFILE_ZONE("wait packet");
+					FrameStageTimer stageTimer(m_frameStats, FrameStage::PacketWait);
+					if (!m_submittedPackets.pop(packet, m_renderThreadStop))
+					{
+						break;
+					}
+				}
+				drawFrame(*packet);
+			}
+		}
+		catch (...)
+		{
+			m_renderThreadError = std::current_exception();
+			m_renderThreadFailed.store(true, std::memory_order_release);
+			m_freePackets.wakeAll();
+		}
+	}
+
+	void Application::drawFrame(FramePacket& packet)
+	{
+		BinaryLog::SetFrame(packet.frameIndex);
+		if (packet.sampleCount != m_sampleCount)
+		{
+			setSampleCount(packet.sampleCount);
+		}
+
+		render(packet);
+
+		m_frameStats->endFrame();
+		//日志等级裁掉info时连汇总也不计算
+		if (LOG_ENABLED_I && m_frameStats->getFrameCount() % GPU_STATS_INTERVAL == 0)
+		{
+			auto summary = m_frameStats->getSummary();
+			LOG_I("Frame: avg {:.3f} ms, p50 {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms, max {:.3f} ms",
+				summary.frame.avgMs, summary.frame.p50Ms, summary.frame.p95Ms, summary.frame.p99Ms,
+				summary.frame.maxMs);
+			LOG_I("Commands: draws {:.0f}, pipeline binds {:.0f}, descriptor binds {:.0f}, elided {:.0f}",
+				summary.avgDraws, summary.avgPipelineBinds, summary.avgDescriptorBinds, summary.avgElidedCalls);
+		}
+	}
+
+	void Application::render(FramePacket& packet)
+	{
+		TOY_PROFILE_FUNCTION();
+
 		//等待上一帧的渲染完成
-		m_fences[m_currentFrame]->block();
+		{
+			TOY_PROFILE_ZONE("fence wait");
+			FrameStageTimer stageTimer(m_frameStats, FrameStage::FenceWait);
+			m_fences[m_currentFrame]->block();
+		}
 
 		//获取交换链中的下一帧
 		uint32_t imageIndex = 0;
-		vkAcquireNextImageKHR(vkContext.vk_device, m_swapChain->getSwapChain(), UINT64_MAX,
-			m_imageAvailableSemaphores[m_currentFrame]->getSemaphore(), VK_NULL_HANDLE, &imageIndex);
+		{
+			TOY_PROFILE_ZONE("acquire");
+			FrameStageTimer stageTimer(m_frameStats, FrameStage::Acquire);
+			vkAcquireNextImageKHR(vkContext.vk_device, m_swapChain->getSwapChain(), UINT64_MAX,
+				m_imageAvailableSemaphores[m_currentFrame]->getSemaphore(), VK_NULL_HANDLE, &imageIndex);
+		}
+
+		//fence等待完成后，这一帧的命令缓冲和实例buffer都可以安全复用
+		m_bindlessHeap->nextFrame();
+		m_framebufferCache->nextFrame();
+		{
+			FrameStageTimer stageTimer(m_frameStats, FrameStage::Record);
+			recordCommandBuffer(imageIndex, packet);
+		}
+		//sprite数据已经写进实例buffer，packet可以还给主线程
+		m_freePackets.tryPush(&packet);
+		m_frameStats->addCommandStats(m_commandBuffers[m_currentFrame]->getStats());
+		m_frameStats->addUploadBytes(m_spriteRenderer->getLastUploadBytes() + m_textureStreamer->getLastUploadBytes());
 
 		//构建提交信息
 		VkSubmitInfo submitInfo{};
@@ -106,7 +288,7 @@ namespace ToyEngine
 		submitInfo.pWaitDstStageMask = waitStages;
 
 		//提交的命令缓冲
-		auto commandBuffer = m_commandBuffers[imageIndex]->getCommandBuffer();
+		auto commandBuffer = m_commandBuffers[m_currentFrame]->getCommandBuffer();
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
@@ -119,9 +301,14 @@ namespace ToyEngine
 		m_fences[m_currentFrame]->resetFence();
 
 		//提交命令
-		if (vkQueueSubmit(vkContext.vk_graphicsQueue, 1, &submitInfo, m_fences[m_currentFrame]->getFence()) != VK_SUCCESS)
 		{
-			throw std::runtime_error("Failed to submit draw command buffer.");
+			TOY_PROFILE_ZONE("submit");
+			FrameStageTimer stageTimer(m_frameStats, FrameStage::Submit);
+			if (vkQueueSubmit(vkContext.vk_graphicsQueue, 1, &submitInfo, m_fences[m_currentFrame]->getFence())
+				!= VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to submit draw command buffer.");
+			}
 		}
 
 		//提交显示
@@ -135,13 +322,22 @@ namespace ToyEngine
 		presentInfo.pSwapchains = swapChains;
 		presentInfo.pImageIndices = &imageIndex;
 
-		vkQueuePresentKHR(vkContext.vk_presentQueue, &presentInfo);
+		{
+			TOY_PROFILE_ZONE("present");
+			FrameStageTimer stageTimer(m_frameStats, FrameStage::Present);
+			vkQueuePresentKHR(vkContext.vk_presentQueue, &presentInfo);
+		}
 
 		m_currentFrame = (m_currentFrame + 1) % m_swapChain->getImageCount();
 	}
 
 	void Application::cleanup()
 	{
+		TOY_PROFILE_EXPORT("toy2d_trace.json");
+		m_frameStats->writeCsv("toy2d_frames.csv");
+		m_frameStats->writeJson("toy2d_frames.json");
+		m_frameStats.reset();
+
 	    for(auto &fence : m_fences)
 		{
 			fence.reset();
@@ -159,14 +355,29 @@ namespace ToyEngine
 			commandBuffer.reset();
 		}
 		m_commandPool.reset();
-		m_pipeline.reset();
+		m_drawStream.reset();
+		m_spriteRenderer.reset();
+		m_quadIndexBuffer.reset();
+		m_textureStreamer.reset();
+		m_renderGraph.reset();
+		m_gpuProfiler.reset();
+		m_spriteRegions.clear();
+		m_textureAtlas.reset();
+		m_bindlessHeap.reset();
+		m_samplerCache.reset();
+		m_opaquePipeline.reset();
+		m_transparentPipeline.reset();
 		m_renderpass.reset();
+		m_framebufferCache->evictViews(m_swapChain->getImageViews());
+		m_framebufferCache.reset();
+		m_renderpassCache.reset();
 		m_swapChain.reset();
 		Context::Quit();
 		m_window.reset();
+		BinaryLog::End();
 	}
 
-	void Application::createPipeline()
+	void Application::createPipeline(const PipelinePtr& pipeline, bool transparent)
 	{
 		//设置视口
 		VkViewport viewport{};
@@ -176,129 +387,339 @@ namespace ToyEngine
 		viewport.height = (float)HEIGHT;
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
-		m_pipeline->setViewport({ viewport });
+		pipeline->setViewport({ viewport });
 
 		VkRect2D scissors{};//裁剪矩形
 		scissors.offset = { 0, 0 };
 		scissors.extent = { WIDTH, HEIGHT };
-		m_pipeline->setScissors({ scissors });
+		pipeline->setScissors({ scissors });
 
 		std::vector<ShaderPtr> shaderGroup;
-		auto vshader = Shader::create(vkContext.vk_device, "../vs.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
-		auto fshader = Shader::create(vkContext.vk_device, "../fs.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
+		auto vshader = Shader::create(vkContext.vk_device, "../sprite_vs.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
+		auto fshader = Shader::create(vkContext.vk_device, "../sprite_fs.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
 		shaderGroup.push_back(vshader);
 		shaderGroup.push_back(fshader);
 
-		m_pipeline->setShaderGroup(shaderGroup);
+		pipeline->setShaderGroup(shaderGroup);
 
-		//顶点的排布模式
-		m_pipeline->m_vertexInputInfo.vertexBindingDescriptionCount = 0;
-		m_pipeline->m_vertexInputInfo.pVertexBindingDescriptions = nullptr;
-		m_pipeline->m_vertexInputInfo.vertexAttributeDescriptionCount = 0;
-		m_pipeline->m_vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+		//顶点的排布模式，sprite只有实例数据，四边形顶点在着色器中生成
+		pipeline->setVertexInput(SpriteRenderer::getBindingDescription(), SpriteRenderer::getAttributeDescription());
 
 		//图元装配
-		m_pipeline->m_inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		m_pipeline->m_inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		m_pipeline->m_inputAssembly.primitiveRestartEnable = VK_FALSE;
+		pipeline->m_inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		pipeline->m_inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		pipeline->m_inputAssembly.primitiveRestartEnable = VK_FALSE;
 
 		//光栅化设置
-		m_pipeline->m_rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		m_pipeline->m_rasterizer.polygonMode = VK_POLYGON_MODE_FILL;//其他模式需要启用gpu特性
-		m_pipeline->m_rasterizer.lineWidth = 1.0f;//大于1.0f需要启用gpu特性
-		m_pipeline->m_rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-		m_pipeline->m_rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-
-		m_pipeline->m_rasterizer.depthBiasEnable = VK_FALSE;
-		m_pipeline->m_rasterizer.depthBiasConstantFactor = 0.0f;
-		m_pipeline->m_rasterizer.depthBiasClamp = 0.0f;
-		m_pipeline->m_rasterizer.depthBiasSlopeFactor = 0.0f;
-
-		//TODO:多重采样
-		m_pipeline->m_multisampling.sampleShadingEnable = VK_FALSE;
-		m_pipeline->m_multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-		m_pipeline->m_multisampling.minSampleShading = 1.0f;
-		m_pipeline->m_multisampling.pSampleMask = nullptr;
-		m_pipeline->m_multisampling.alphaToCoverageEnable = VK_FALSE;
-		m_pipeline->m_multisampling.alphaToOneEnable = VK_FALSE;
-
-		//TODO:深度与模板测试
+		pipeline->m_rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		pipeline->m_rasterizer.polygonMode = VK_POLYGON_MODE_FILL;//其他模式需要启用gpu特性
+		pipeline->m_rasterizer.lineWidth = 1.0f;//大于1.0f需要启用gpu特性
+		pipeline->m_rasterizer.cullMode = VK_CULL_MODE_NONE;//sprite可能被翻转，不做背面剔除
+		pipeline->m_rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+		pipeline->m_rasterizer.depthBiasEnable = VK_FALSE;
+		pipeline->m_rasterizer.depthBiasConstantFactor = 0.0f;
+		pipeline->m_rasterizer.depthBiasClamp = 0.0f;
+		pipeline->m_rasterizer.depthBiasSlopeFactor = 0.0f;
+
+		//多重采样，只对边缘做多次覆盖测试，着色仍然每像素一次
+		pipeline->m_multisampling.sampleShadingEnable = VK_FALSE;
+		pipeline->setSampleCount(m_sampleCount);
+		pipeline->m_multisampling.minSampleShading = 1.0f;
+		pipeline->m_multisampling.pSampleMask = nullptr;
+		pipeline->m_multisampling.alphaToCoverageEnable = VK_FALSE;
+		pipeline->m_multisampling.alphaToOneEnable = VK_FALSE;
+
+		//不透明sprite从前到后绘制并写深度，被遮挡的片元在early-Z阶段丢弃
+		//半透明sprite从后到前绘制，只测试不写深度，相同深度时画在不透明sprite之上
+		if (transparent)
+		{
+			pipeline->setDepthTest(true, false, VK_COMPARE_OP_LESS_OR_EQUAL);
+		}
+		else
+		{
+			pipeline->setDepthTest(true, true, VK_COMPARE_OP_LESS);
+		}
 
 		//颜色混合
 		//这个是颜色混合掩码，得到的混合结果，按照通道与掩码进行AND操作，输出
 		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 		colorBlendAttachment.colorWriteMask =
 			VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colorBlendAttachment.blendEnable = VK_FALSE;
-		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colorBlendAttachment.blendEnable = transparent ? VK_TRUE : VK_FALSE;
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
 		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
 		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
 		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-		m_pipeline->pushBlendAttachment(colorBlendAttachment);
+		pipeline->pushBlendAttachment(colorBlendAttachment);
 
 		std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
 		//blend有两种计算方式，第一种如上所属，进行alpha为基础的计算，第二种是进行位运算
 		//如果开启了logicOp,那么上方设置的alpha为基础的运算失效
 		//colorWrite掩码仍然有效，即使开启了logicOp
 		//因为我们可能会有多个FrameBuffer输出，所以可能需要多个blendAttachment
-		m_pipeline->m_colorBlending.logicOpEnable = VK_FALSE;
-		m_pipeline->m_colorBlending.logicOp = VK_LOGIC_OP_COPY;
-		m_pipeline->m_colorBlending.blendConstants[0] = 0.0f;
-		m_pipeline->m_colorBlending.blendConstants[1] = 0.0f;
-		m_pipeline->m_colorBlending.blendConstants[2] = 0.0f;
-		m_pipeline->m_colorBlending.blendConstants[3] = 0.0f;
+		pipeline->m_colorBlending.logicOpEnable = VK_FALSE;
+		pipeline->m_colorBlending.logicOp = VK_LOGIC_OP_COPY;
+		pipeline->m_colorBlending.blendConstants[0] = 0.0f;
+		pipeline->m_colorBlending.blendConstants[1] = 0.0f;
+		pipeline->m_colorBlending.blendConstants[2] = 0.0f;
+		pipeline->m_colorBlending.blendConstants[3] = 0.0f;
 
 		//uniform的传递
-		m_pipeline->m_layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		m_pipeline->m_layout.setLayoutCount = 0;
-		m_pipeline->m_layout.pSetLayouts = nullptr;
-		m_pipeline->m_layout.pushConstantRangeCount = 0;
-		m_pipeline->m_layout.pPushConstantRanges = nullptr;
-
-		m_pipeline->buildPipeline();
+		pipeline->m_layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline->m_layout.setLayoutCount = 0;
+		pipeline->m_layout.pSetLayouts = nullptr;
+		pipeline->m_layout.pushConstantRangeCount = 0;
+		pipeline->m_layout.pPushConstantRanges = nullptr;
+		pipeline->setDescriptorSetLayouts({ m_bindlessHeap->getDescriptorSetLayout() });
+		pipeline->addPushConstant<SpritePushConstants>(VK_SHADER_STAGE_VERTEX_BIT);
+
+		pipeline->buildPipeline();
 	}
 
 	void Application::createRenderpass()
 	{
-		//输入画布的描述
+		//与RenderGraph为精灵pass推导出的附件描述一致：清屏、交换链要写回，布局转换由图的barrier完成
+		//多重采样时颜色附件是临时纹理，不写回，renderpass结束时resolve到交换链
+		const bool msaa = m_sampleCount != VK_SAMPLE_COUNT_1_BIT;
 		VkAttachmentDescription attachmentDes{};
 		attachmentDes.format = m_swapChain->getImageFormat();
-		attachmentDes.samples = VK_SAMPLE_COUNT_1_BIT;
+		attachmentDes.samples = m_sampleCount;
 		attachmentDes.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachmentDes.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachmentDes.storeOp = msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 		attachmentDes.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		attachmentDes.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachmentDes.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachmentDes.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		attachmentDes.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		attachmentDes.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		//深度是只在这个pass内使用的临时纹理：清除、不写回
+		VkAttachmentDescription depthDes{};
+		depthDes.format = m_depthFormat;
+		depthDes.samples = m_sampleCount;
+		depthDes.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthDes.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthDes.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depthDes.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthDes.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthDes.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		RenderpassDesc desc{};
+		desc.colorAttachments.push_back(attachmentDes);
+		desc.depthAttachment = depthDes;
+		if (msaa)
+		{
+			VkAttachmentDescription resolveDes{};
+			resolveDes.format = m_swapChain->getImageFormat();
+			resolveDes.samples = VK_SAMPLE_COUNT_1_BIT;
+			resolveDes.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			resolveDes.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			resolveDes.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			resolveDes.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			resolveDes.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			resolveDes.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			desc.resolveAttachments.push_back(resolveDes);
+		}
+		m_renderpass = m_renderpassCache->get(desc);
+	}
 
-		m_renderpass->addAttachmentDescription(attachmentDes);
+	void Application::setSampleCount(VkSampleCountFlagBits samples)
+	{
+		samples = clampSampleCount(vkContext.vk_physicalDevice, samples);
+		if (samples == m_sampleCount)
+		{
+			return;
+		}
 
-		//对于画布的索引设置及格式要求
-		VkAttachmentReference attachmentRef{};
-		attachmentRef.attachment = 0;
-		attachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		//管线会被立即销毁重建，等待还在使用它们的帧
+		vkDeviceWaitIdle(vkContext.vk_device);
+		m_sampleCount = samples;
+		if (!m_renderGraph->isDynamicRendering())
+		{
+			createRenderpass();
+		}
 
-		//创建子流程
-		Subpass subpass{};
-		subpass.addColorAttachmentReference(attachmentRef);
-		subpass.buildSubpassDescription();
+		uint32_t rebuilt = 0;
+		for (const auto& pipeline : { m_opaquePipeline, m_transparentPipeline })
+		{
+			if (pipeline->getSampleCount() == samples)
+			{
+				continue;
+			}
+
+			pipeline->setSampleCount(samples);
+			pipeline->setRenderpass(m_renderpass);
+			pipeline->buildPipeline();
+			rebuilt++;
+		}
 
-		m_renderpass->addSubpass(subpass);
+		LOG_I("MSAA set to {}x, rebuilt {} pipelines.", static_cast<uint32_t>(samples), rebuilt);
+	}
 
-		//子流程之间的依赖关系
-		VkSubpassDependency dependency{};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.dstSubpass = 0;
-		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.srcAccessMask = 0;
-		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	void Application::createTextures()
+	{
+		const uint32_t size = 64;
+		const glm::vec4 colors[] = {
+			{ 1.0f, 0.3f, 0.3f, 1.0f },
+			{ 0.3f, 1.0f, 0.3f, 1.0f },
+			{ 0.3f, 0.3f, 1.0f, 1.0f },
+			{ 1.0f, 1.0f, 0.3f, 1.0f },
+		};
+
+		//四张小图放进一页，整个场景只引用一个bindless下标
+		m_textureAtlas = TextureAtlas::create(vkContext.vk_device, vkContext.vk_physicalDevice, m_bindlessHeap,
+			m_samplerCache, m_swapChain->getImageCount(), 256, 1);
+
+		std::vector<std::vector<uint32_t>> pixels(std::size(colors), std::vector<uint32_t>(size * size));
+		std::vector<AtlasImage> images;
+		for (size_t i = 0; i < std::size(colors); i++)
+		{
+			//棋盘格
+			for (uint32_t y = 0; y < size; y++)
+			{
+				for (uint32_t x = 0; x < size; x++)
+				{
+					bool dark = ((x / 8) + (y / 8)) % 2 == 0;
+					pixels[i][y * size + x] = packColor(dark ? colors[i] * 0.5f + glm::vec4(0, 0, 0, 0.5f) : colors[i]);
+				}
+			}
+			images.push_back({ size, size, pixels[i].data() });
+		}
 
-		m_renderpass->addDependency(dependency);
+		for (const auto& region : m_textureAtlas->insertBatch(images))
+		{
+			if (!region)
+			{
+				throw std::runtime_error("Demo textures do not fit into the texture atlas.");
+			}
+			m_spriteRegions.push_back(*region);
+		}
 
-		m_renderpass->buildRenderpass();
+		m_textureAtlas->flushSync();
 	}
 
+	void Application::updateScene(FramePacket& packet)
+	{
+		//演示场景：铺满窗口的旋转方块，相邻方块旋转时会互相覆盖，按伪随机的深度分层
+		//每隔几个方块一个半透明的，走从后到前的半透明pipeline
+		const float time = static_cast<float>(glfwGetTime());
+		const int columns = 40;
+		const int rows = 30;
+		const glm::vec2 cell = { (float)WIDTH / columns, (float)HEIGHT / rows };
+
+		auto& spriteBatch = packet.spriteBatch;
+		spriteBatch.clear();
+		for (int y = 0; y < rows; y++)
+		{
+			for (int x = 0; x < columns; x++)
+			{
+				glm::vec2 position = (glm::vec2(x, y) + 0.5f) * cell;
+				bool transparent = (x * 3 + y) % 7 == 0;
+				glm::vec4 color = { (float)x / columns, (float)y / rows, 0.5f + 0.5f * std::sin(time),
+									transparent ? 0.5f : 1.0f };
+				const auto& region = m_spriteRegions[(x + y) % m_spriteRegions.size()];
+				float depth = static_cast<float>((x * 7 + y * 13) % 16) / 16.0f;
+				spriteBatch.add(position, cell * 1.2f, time + 0.1f * (x + y), packColor(color), region,
+					transparent ? m_transparentPipelineId : m_opaquePipelineId, depth);
+			}
+		}
+
+		//流式纹理的sprite在最前面来回缩放，屏幕尺寸变化时请求的mip随之变化
+		packet.streamedSprites.clear();
+		for (uint32_t i = 0; i < m_streamedTextures.size(); i++)
+		{
+			StreamedSprite sprite{};
+			sprite.texture = i;
+			sprite.position = { (i + 0.5f) * (float)WIDTH / m_streamedTextures.size(), HEIGHT * 0.5f };
+			sprite.size = glm::vec2(32.0f + 480.0f * (0.5f + 0.5f * std::sin(time * 0.5f + (float)i)));
+			sprite.rotation = 0.0f;
+			sprite.depth = 0.0f;
+			packet.streamedSprites.push_back(sprite);
+		}
+	}
+
+	void Application::recordCommandBuffer(uint32_t imageIndex, FramePacket& packet)
+	{
+		TOY_PROFILE_FUNCTION();
+		const auto& commandBuffer = m_commandBuffers[m_currentFrame];
+
+		commandBuffer->begin();
+
+		//读回这个飞行帧上一次的计时，fence已经等待过，不会阻塞
+		m_gpuProfiler->beginFrame(commandBuffer, m_currentFrame);
+		if (++m_frameCount % GPU_STATS_INTERVAL == 0 && LOG_ENABLED_I)
+		{
+			for (const auto& stats : m_gpuProfiler->getStats())
+			{
+				LOG_I("GPU {}: avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms", stats.name,
+					stats.avgMs, stats.minMs, stats.maxMs);
+			}
+		}
+		uint32_t frameScope = m_gpuProfiler->beginScope(commandBuffer, "frame");
+
+		//流式纹理和图集的上传必须在renderpass之外录制
+		{
+			GpuScope streamScope(m_gpuProfiler, commandBuffer, "textureStreaming");
+			m_textureStreamer->update(commandBuffer, m_currentFrame);
+			m_textureAtlas->beginFrame(m_currentFrame);
+			m_textureAtlas->recordUploads(commandBuffer);
+		}
+
+		//按屏幕尺寸请求mip，由下一次update发起读取；本帧使用当前已经常驻的最高精度
+		for (const auto& sprite : packet.streamedSprites)
+		{
+			auto handle = m_streamedTextures[sprite.texture];
+			m_textureStreamer->requestScreenSize(handle, sprite.size);
+			packet.spriteBatch.add(sprite.position, sprite.size, sprite.rotation, 0xFFFFFFFF,
+				m_textureStreamer->getTextureIndex(handle), { 0.0f, 0.0f, 1.0f, 1.0f }, 0, m_opaquePipelineId,
+				sprite.depth);
+		}
+
+		//所有pass的draw先提交到DrawStream，排序后由各个pass按编号录制
+		m_drawStream->reset();
+		m_spriteRenderer->submit(*m_drawStream, m_currentFrame, packet.spriteBatch, DRAW_PASS_SPRITES);
+		m_drawStream->sort();
+
+		//交换链图像在acquire信号量等待的阶段之后才可用，结束时转换到PRESENT_SRC
+		m_renderGraph->reset();
+		auto backbuffer = m_renderGraph->importImage("backbuffer",
+			m_swapChain->getImages()[imageIndex], m_swapChain->getImageViews()[imageIndex],
+			m_swapChain->getImageFormat(), m_swapChain->getExtent(),
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+		//深度只在精灵pass内使用，tile-based GPU上不占用显存
+		RGTextureDesc depthDesc{};
+		depthDesc.width = m_swapChain->getExtent().width;
+		depthDesc.height = m_swapChain->getExtent().height;
+		depthDesc.format = m_depthFormat;
+		depthDesc.samples = m_sampleCount;
+		depthDesc.transient = true;
+		auto depth = m_renderGraph->createTexture("depth", depthDesc);
+
+		auto& spritePass = m_renderGraph->addPass("sprites");
+		if (m_sampleCount != VK_SAMPLE_COUNT_1_BIT)
+		{
+			//多重采样的颜色同样只在pass内存在，结束时直接resolve到交换链
+			RGTextureDesc colorDesc = depthDesc;
+			colorDesc.format = m_swapChain->getImageFormat();
+			auto msaaColor = m_renderGraph->createTexture("msaaColor", colorDesc);
+			spritePass.addColorOutput(msaaColor, RGLoadOp::Clear, { 0.0f, 0.0f, 0.0f, 1.0f }, backbuffer);
+		}
+		else
+		{
+			spritePass.addColorOutput(backbuffer, RGLoadOp::Clear, { 0.0f, 0.0f, 0.0f, 1.0f });
+		}
+		spritePass.setDepthOutput(depth, RGLoadOp::Clear, 1.0f);
+		spritePass.setExecute([this](const CommandBufferPtr& cmd) {
+			m_drawStream->execute(cmd, DRAW_PASS_SPRITES);
+		});
+
+		m_renderGraph->compile();
+		m_renderGraph->execute(commandBuffer);
+
+		m_gpuProfiler->endScope(commandBuffer, frameScope);
+		commandBuffer->end();
+	}
 } // ToyEngine
\ No newline at end of file
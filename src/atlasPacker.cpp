@@ -0,0 +1,150 @@
+#include "atlasPacker.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace ToyEngine
+{
+	SkylinePacker::SkylinePacker(uint32_t width, uint32_t height, uint32_t padding)
+	{
+		m_width = width;
+		m_height = height;
+		m_padding = padding;
+		reset();
+	}
+
+	void SkylinePacker::reset()
+	{
+		m_usedArea = 0;
+		m_skyline.clear();
+		m_skyline.push_back({ 0, 0, m_width });
+	}
+
+	float SkylinePacker::getOccupancy() const
+	{
+		return static_cast<float>(static_cast<double>(m_usedArea) / (static_cast<double>(m_width) * m_height));
+	}
+
+	std::optional<AtlasRect> SkylinePacker::insert(uint32_t width, uint32_t height)
+	{
+		if (width == 0 || height == 0)
+		{
+			return std::nullopt;
+		}
+
+		const uint32_t paddedWidth = width + m_padding;
+		const uint32_t paddedHeight = height + m_padding;
+
+		size_t bestIndex = SIZE_MAX;
+		uint32_t bestTop = UINT32_MAX;
+		uint32_t bestNodeWidth = UINT32_MAX;
+		uint32_t bestY = 0;
+
+		for (size_t i = 0; i < m_skyline.size(); i++)
+		{
+			uint32_t y = 0;
+			if (!fit(i, paddedWidth, paddedHeight, y))
+			{
+				continue;
+			}
+
+			uint32_t top = y + paddedHeight;
+			if (top < bestTop || (top == bestTop && m_skyline[i].width < bestNodeWidth))
+			{
+				bestIndex = i;
+				bestTop = top;
+				bestNodeWidth = m_skyline[i].width;
+				bestY = y;
+			}
+		}
+
+		if (bestIndex == SIZE_MAX)
+		{
+			return std::nullopt;
+		}
+
+		AtlasRect rect{ m_skyline[bestIndex].x, bestY, width, height };
+		addNode(bestIndex, rect.x, bestY, paddedWidth, paddedHeight);
+		m_usedArea += static_cast<uint64_t>(paddedWidth) * paddedHeight;
+		return rect;
+	}
+
+	bool SkylinePacker::fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const
+	{
+		//最右侧的图块允许padding超出边界
+		uint32_t x = m_skyline[index].x;
+		if (x + width > m_width + m_padding)
+		{
+			return false;
+		}
+
+		//矩形跨过的所有段中最高的那段决定放置高度
+		uint32_t remaining = width;
+		y = m_skyline[index].y;
+		size_t i = index;
+		while (remaining > 0)
+		{
+			if (i >= m_skyline.size())
+			{
+				//只有padding超出边界
+				break;
+			}
+
+			y = std::max(y, m_skyline[i].y);
+			if (y + height > m_height + m_padding)
+			{
+				return false;
+			}
+
+			remaining -= std::min(remaining, m_skyline[i].width);
+			i++;
+		}
+
+		return true;
+	}
+
+	void SkylinePacker::addNode(size_t index, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+	{
+		//超出右边界的padding不记入轮廓
+		width = std::min(width, m_width - x);
+		m_skyline.insert(m_skyline.begin() + static_cast<std::ptrdiff_t>(index), { x, y + height, width });
+
+		//裁掉被新段覆盖的后续段
+		const uint32_t right = x + width;
+		size_t i = index + 1;
+		while (i < m_skyline.size())
+		{
+			SkylineNode& node = m_skyline[i];
+			if (node.x >= right)
+			{
+				break;
+			}
+
+			uint32_t nodeRight = node.x + node.width;
+			if (nodeRight <= right)
+			{
+				m_skyline.erase(m_skyline.begin() + static_cast<std::ptrdiff_t>(i));
+				continue;
+			}
+
+			node.width = nodeRight - right;
+			node.x = right;
+			break;
+		}
+
+		//合并相邻的同高段，保持段数尽量少
+		i = 0;
+		while (i + 1 < m_skyline.size())
+		{
+			if (m_skyline[i].y == m_skyline[i + 1].y)
+			{
+				m_skyline[i].width += m_skyline[i + 1].width;
+				m_skyline.erase(m_skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+} // ToyEngine
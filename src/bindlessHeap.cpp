@@ -0,0 +1,275 @@
+#include "bindlessHeap.h"
+#include "logger.h"
+
+namespace ToyEngine
+{
+	BindlessIndexAllocator::BindlessIndexAllocator(uint32_t capacity)
+		: m_capacity(capacity)
+	{
+	}
+
+	uint32_t BindlessIndexAllocator::allocate()
+	{
+		uint32_t index = INVALID_INDEX;
+		if (!m_freeList.empty())
+		{
+			index = m_freeList.back();
+			m_freeList.pop_back();
+		}
+		else if (m_next < m_capacity)
+		{
+			index = m_next++;
+			m_live.resize(m_next, false);
+		}
+
+		if (index != INVALID_INDEX)
+		{
+			m_live[index] = true;
+		}
+		return index;
+	}
+
+	void BindlessIndexAllocator::release(uint32_t index, uint32_t framesInFlight)
+	{
+		if (index == INVALID_INDEX)
+		{
+			return;
+		}
+
+		//重复释放会让同一个下标两次进入空闲链表，之后两个资源共用一个槽位
+		if (!isLive(index))
+		{
+			LOG_E("Bindless index {} is not allocated or already released.", index);
+			return;
+		}
+
+		m_live[index] = false;
+		m_pending.push_back({ index, framesInFlight });
+	}
+
+	void BindlessIndexAllocator::nextFrame()
+	{
+		size_t i = 0;
+		while (i < m_pending.size())
+		{
+			if (m_pending[i].framesLeft == 0)
+			{
+				m_freeList.push_back(m_pending[i].index);
+				m_pending[i] = m_pending.back();
+				m_pending.pop_back();
+			}
+			else
+			{
+				m_pending[i].framesLeft--;
+				i++;
+			}
+		}
+	}
+
+	BindlessHeapPtr BindlessHeap::create(const VkDevice& device,
+		uint32_t framesInFlight,
+		uint32_t maxTextures,
+		uint32_t maxBuffers)
+	{
+		return std::make_shared<BindlessHeap>(device, framesInFlight, maxTextures, maxBuffers);
+	}
+
+	BindlessHeap::BindlessHeap(const VkDevice& device,
+		uint32_t framesInFlight,
+		uint32_t maxTextures,
+		uint32_t maxBuffers)
+	{
+		if (!vkContext.vk_descriptorIndexingSupported)
+		{
+			LOG_E("Bindless heap requires descriptor indexing.");
+			throw std::runtime_error("Bindless heap requires descriptor indexing.");
+		}
+
+		m_device = device;
+		m_framesInFlight = framesInFlight;
+
+		//数组大小不能超过update after bind的设备限制，combined image sampler同时占用image和sampler的额度
+		const auto& limits = vkContext.vk_vulkan12Properties;
+		maxTextures = std::min({ maxTextures,
+			limits.maxDescriptorSetUpdateAfterBindSampledImages,
+			limits.maxDescriptorSetUpdateAfterBindSamplers,
+			limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			limits.maxPerStageDescriptorUpdateAfterBindSamplers });
+		maxBuffers = std::min({ maxBuffers,
+			limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+			limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+		m_textureIndices = BindlessIndexAllocator(maxTextures);
+		m_bufferIndices = BindlessIndexAllocator(maxBuffers);
+
+		//set layout
+		std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+		bindings[TEXTURE_BINDING].binding = TEXTURE_BINDING;
+		bindings[TEXTURE_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[TEXTURE_BINDING].descriptorCount = maxTextures;
+		bindings[TEXTURE_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+		bindings[BUFFER_BINDING].binding = BUFFER_BINDING;
+		bindings[BUFFER_BINDING].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[BUFFER_BINDING].descriptorCount = maxBuffers;
+		bindings[BUFFER_BINDING].stageFlags = VK_SHADER_STAGE_ALL;
+
+		//PARTIALLY_BOUND：未写入的槽位只要不被访问就合法
+		//UPDATE_AFTER_BIND：set绑定后仍然可以写入新的槽位
+		//UPDATE_UNUSED_WHILE_PENDING：命令缓冲执行中可以更新没被使用的槽位
+		std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size(),
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+				| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+				| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &bindingFlagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create bindless descriptor set layout.");
+		}
+
+		//pool
+		std::vector<VkDescriptorPoolSize> poolSizes(2);
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = maxTextures;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[1].descriptorCount = maxBuffers;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+
+		if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create bindless descriptor pool.");
+		}
+
+		//整个程序只需要这一个set
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_setLayout;
+
+		if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate bindless descriptor set.");
+		}
+
+		LOG_I("Bindless heap created: {} textures, {} buffers.", maxTextures, maxBuffers);
+	}
+
+	BindlessHeap::~BindlessHeap()
+	{
+		//set随pool一起释放
+		if (m_descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+		}
+
+		if (m_setLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+		}
+	}
+
+	uint32_t BindlessHeap::registerTexture(VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+	{
+		uint32_t index = m_textureIndices.allocate();
+		if (index == INVALID_INDEX)
+		{
+			LOG_E("Bindless texture table is full.");
+			throw std::runtime_error("Bindless texture table is full.");
+		}
+
+		writeTexture(index, imageView, sampler, layout);
+		return index;
+	}
+
+	void BindlessHeap::updateTexture(uint32_t index, VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+	{
+		if (!m_textureIndices.isLive(index))
+		{
+			LOG_E("Bindless texture {} is updated but not registered.", index);
+			return;
+		}
+
+		writeTexture(index, imageView, sampler, layout);
+	}
+
+	void BindlessHeap::releaseTexture(uint32_t index)
+	{
+		m_textureIndices.release(index, m_framesInFlight);
+	}
+
+	uint32_t BindlessHeap::registerBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+	{
+		uint32_t index = m_bufferIndices.allocate();
+		if (index == INVALID_INDEX)
+		{
+			LOG_E("Bindless buffer table is full.");
+			throw std::runtime_error("Bindless buffer table is full.");
+		}
+
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = buffer;
+		bufferInfo.offset = offset;
+		bufferInfo.range = range;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_descriptorSet;
+		write.dstBinding = BUFFER_BINDING;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+		return index;
+	}
+
+	void BindlessHeap::releaseBuffer(uint32_t index)
+	{
+		m_bufferIndices.release(index, m_framesInFlight);
+	}
+
+	void BindlessHeap::nextFrame()
+	{
+		m_textureIndices.nextFrame();
+		m_bufferIndices.nextFrame();
+	}
+
+	void BindlessHeap::writeTexture(uint32_t index, VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+	{
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageView = imageView;
+		imageInfo.sampler = sampler;
+		imageInfo.imageLayout = layout;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_descriptorSet;
+		write.dstBinding = TEXTURE_BINDING;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+	}
+} // ToyEngine
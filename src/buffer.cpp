@@ -22,6 +22,7 @@ namespace ToyEngine
 	{
 		m_device = device;
 		m_physicalDevice = physicalDevice;
+		m_size = size;
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
@@ -51,6 +52,10 @@ namespace ToyEngine
 
 	Buffer::~Buffer()
 	{
+		if(m_mappedData != nullptr)
+		{
+			vkUnmapMemory(m_device, m_bufferMemory);
+		}
 		if(m_buffer != VK_NULL_HANDLE)
 		{
 			vkDestroyBuffer(m_device, m_buffer, nullptr);
@@ -105,6 +110,12 @@ namespace ToyEngine
 
 	void Buffer::updateBufferByMap(void* data, size_t size)
 	{
+		if(m_mappedData != nullptr)
+		{
+			memcpy(m_mappedData, data, size);
+			return;
+		}
+
 		void* mappedData = nullptr;
 		vkMapMemory(m_device, m_bufferMemory, 0, size, 0, &mappedData);
 		memcpy(mappedData, data, size);
@@ -117,4 +128,17 @@ namespace ToyEngine
 		staging->updateBufferByMap(data, size);
 		copyBuffer(staging->getBuffer(), m_buffer, static_cast<VkDeviceSize>(size));
 	}
+
+	void* Buffer::map()
+	{
+		if(m_mappedData == nullptr)
+		{
+			if(vkMapMemory(m_device, m_bufferMemory, 0, VK_WHOLE_SIZE, 0, &m_mappedData) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to map buffer memory.");
+			}
+		}
+
+		return m_mappedData;
+	}
 } // ToyEngine
\ No newline at end of file
@@ -43,6 +43,9 @@ namespace ToyEngine
 		{
 			throw std::runtime_error("Failed to begin recording command buffer.");
 		}
+
+		invalidateState();
+		m_stats = {};
 	}
 
 	void CommandBuffer::beginRenderPass(const VkRenderPassBeginInfo& renderPassInfo, const VkSubpassContents& contents)
@@ -52,12 +55,177 @@ namespace ToyEngine
 
 	void CommandBuffer::bindGraphicPipeline(VkPipeline const& pipeline)
 	{
+		if (pipeline == m_boundPipeline)
+		{
+			m_stats.elidedCalls++;
+			return;
+		}
+
 		vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		m_boundPipeline = pipeline;
+		m_stats.pipelineBinds++;
+
+		//绑定静态viewport/scissor的pipeline后之前设置的动态值失效，不知道新pipeline是哪种时都当作失效
+		m_viewportValid = false;
+		m_scissorValid = false;
+	}
+
+	void CommandBuffer::bindDescriptorSet(VkPipelineLayout layout,
+		uint32_t setIndex,
+		VkDescriptorSet descriptorSet,
+		std::initializer_list<uint32_t> dynamicOffsets)
+	{
+		bindDescriptorSet(layout, setIndex, descriptorSet, static_cast<uint32_t>(dynamicOffsets.size()),
+			dynamicOffsets.begin());
+	}
+
+	void CommandBuffer::bindDescriptorSet(VkPipelineLayout layout,
+		uint32_t setIndex,
+		VkDescriptorSet descriptorSet,
+		uint32_t dynamicOffsetCount,
+		const uint32_t* dynamicOffsets)
+	{
+		if (setIndex >= MAX_BOUND_DESCRIPTOR_SETS || dynamicOffsetCount > MAX_DYNAMIC_OFFSETS)
+		{
+			//超出跟踪范围的不做过滤
+			vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex,
+				1, &descriptorSet, dynamicOffsetCount, dynamicOffsets);
+			m_stats.descriptorBinds++;
+			invalidateIncompatible(layout, setIndex);
+			return;
+		}
+
+		auto& bound = m_boundSets[setIndex];
+		if (bound.layout == layout && bound.set == descriptorSet && bound.dynamicOffsetCount == dynamicOffsetCount
+			&& std::equal(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, bound.dynamicOffsets))
+		{
+			m_stats.elidedCalls++;
+			return;
+		}
+
+		vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setIndex,
+			1, &descriptorSet, dynamicOffsetCount, dynamicOffsets);
+		m_stats.descriptorBinds++;
+		invalidateIncompatible(layout, setIndex);
+
+		bound.layout = layout;
+		bound.set = descriptorSet;
+		bound.dynamicOffsetCount = dynamicOffsetCount;
+		std::copy(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, bound.dynamicOffsets);
+	}
+
+	void CommandBuffer::pushConstants(VkPipelineLayout layout,
+		VkShaderStageFlags stages,
+		uint32_t offset,
+		uint32_t size,
+		const void* data)
+	{
+		if (offset + size > MAX_PUSH_CONSTANT_SIZE)
+		{
+			throw std::runtime_error("Push constant range is larger than 128 bytes.");
+		}
+
+		//layout或者stage不同时无法保证之前的值仍然有效，重新开始记录
+		if (layout != m_pushConstantLayout || stages != m_pushConstantStages)
+		{
+			m_pushConstantLayout = layout;
+			m_pushConstantStages = stages;
+			m_pushConstantValid = 0;
+		}
+
+		const uint32_t firstWord = offset / 4;
+		const uint32_t wordCount = (size + 3) / 4;
+		const uint32_t mask = (wordCount >= 32 ? ~0u : ((1u << wordCount) - 1u)) << firstWord;
+		if ((m_pushConstantValid & mask) == mask && std::memcmp(m_pushConstantData + offset, data, size) == 0)
+		{
+			m_stats.elidedCalls++;
+			return;
+		}
+
+		vkCmdPushConstants(m_commandBuffer, layout, stages, offset, size, data);
+		m_stats.pushConstantUpdates++;
+
+		std::memcpy(m_pushConstantData + offset, data, size);
+		m_pushConstantValid |= mask;
+	}
+
+	void CommandBuffer::bindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset)
+	{
+		if (binding < MAX_VERTEX_BINDINGS)
+		{
+			auto& bound = m_boundVertexBuffers[binding];
+			if (bound.buffer == buffer && bound.offset == offset)
+			{
+				m_stats.elidedCalls++;
+				return;
+			}
+			bound = { buffer, offset };
+		}
+
+		vkCmdBindVertexBuffers(m_commandBuffer, binding, 1, &buffer, &offset);
+		m_stats.vertexBufferBinds++;
+	}
+
+	void CommandBuffer::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+	{
+		if (m_boundIndexBuffer.buffer == buffer && m_boundIndexBuffer.offset == offset
+			&& m_boundIndexType == indexType)
+		{
+			m_stats.elidedCalls++;
+			return;
+		}
+
+		vkCmdBindIndexBuffer(m_commandBuffer, buffer, offset, indexType);
+		m_stats.indexBufferBinds++;
+
+		m_boundIndexBuffer = { buffer, offset };
+		m_boundIndexType = indexType;
+	}
+
+	void CommandBuffer::setViewport(const VkViewport& viewport)
+	{
+		if (m_viewportValid && std::memcmp(&m_viewport, &viewport, sizeof(VkViewport)) == 0)
+		{
+			m_stats.elidedCalls++;
+			return;
+		}
+
+		vkCmdSetViewport(m_commandBuffer, 0, 1, &viewport);
+		m_stats.dynamicStateSets++;
+
+		m_viewport = viewport;
+		m_viewportValid = true;
+	}
+
+	void CommandBuffer::setScissor(const VkRect2D& scissor)
+	{
+		if (m_scissorValid && std::memcmp(&m_scissor, &scissor, sizeof(VkRect2D)) == 0)
+		{
+			m_stats.elidedCalls++;
+			return;
+		}
+
+		vkCmdSetScissor(m_commandBuffer, 0, 1, &scissor);
+		m_stats.dynamicStateSets++;
+
+		m_scissor = scissor;
+		m_scissorValid = true;
+	}
+
+	void CommandBuffer::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+	{
+		vkCmdDraw(m_commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+		m_stats.draws++;
 	}
 
-	void CommandBuffer::draw(uint32_t vertexCount)
+	void CommandBuffer::drawIndexed(uint32_t indexCount,
+		uint32_t instanceCount,
+		uint32_t firstIndex,
+		int32_t vertexOffset,
+		uint32_t firstInstance)
 	{
-		vkCmdDraw(m_commandBuffer, vertexCount, 1, 0, 0);
+		vkCmdDrawIndexed(m_commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+		m_stats.draws++;
 	}
 
 	void CommandBuffer::endRenderPass()
@@ -65,6 +233,26 @@ namespace ToyEngine
 		vkCmdEndRenderPass(m_commandBuffer);
 	}
 
+	void CommandBuffer::beginRendering(const VkRenderingInfoKHR& renderingInfo)
+	{
+		vkContext.vk_cmdBeginRendering(m_commandBuffer, &renderingInfo);
+	}
+
+	void CommandBuffer::endRendering()
+	{
+		vkContext.vk_cmdEndRendering(m_commandBuffer);
+	}
+
+	void CommandBuffer::writeTimestamp(VkPipelineStageFlagBits stage, VkQueryPool queryPool, uint32_t query)
+	{
+		vkCmdWriteTimestamp(m_commandBuffer, stage, queryPool, query);
+	}
+
+	void CommandBuffer::resetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount)
+	{
+		vkCmdResetQueryPool(m_commandBuffer, queryPool, firstQuery, queryCount);
+	}
+
 	void CommandBuffer::end()
 	{
 		if (vkEndCommandBuffer(m_commandBuffer) != VK_SUCCESS)
@@ -79,6 +267,49 @@ namespace ToyEngine
 		vkCmdCopyBuffer(m_commandBuffer, srcBuffer, dstBuffer, copyInfoCount, copyInfos.data());
 	}
 
+	void CommandBuffer::copyBufferToImage(const VkBuffer& srcBuffer, const VkImage& dstImage, VkImageLayout dstLayout,
+		const std::vector<VkBufferImageCopy>& copyInfos)
+	{
+		vkCmdCopyBufferToImage(m_commandBuffer, srcBuffer, dstImage, dstLayout,
+			static_cast<uint32_t>(copyInfos.size()), copyInfos.data());
+	}
+
+	void CommandBuffer::copyImageToBuffer(const VkImage& srcImage, VkImageLayout srcLayout, const VkBuffer& dstBuffer,
+		const std::vector<VkBufferImageCopy>& copyInfos)
+	{
+		vkCmdCopyImageToBuffer(m_commandBuffer, srcImage, srcLayout, dstBuffer,
+			static_cast<uint32_t>(copyInfos.size()), copyInfos.data());
+	}
+
+	void CommandBuffer::blitImage(const VkImage& srcImage, VkImageLayout srcLayout,
+		const VkImage& dstImage, VkImageLayout dstLayout,
+		const std::vector<VkImageBlit>& blits, VkFilter filter)
+	{
+		vkCmdBlitImage(m_commandBuffer, srcImage, srcLayout, dstImage, dstLayout,
+			static_cast<uint32_t>(blits.size()), blits.data(), filter);
+	}
+
+	void CommandBuffer::clearColorImage(const VkImage& image, VkImageLayout layout, const VkClearColorValue& color,
+		const VkImageSubresourceRange& range)
+	{
+		vkCmdClearColorImage(m_commandBuffer, image, layout, &color, 1, &range);
+	}
+
+	void CommandBuffer::pipelineBarrier(VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+		const std::vector<VkImageMemoryBarrier>& imageBarriers,
+		const std::vector<VkBufferMemoryBarrier>& bufferBarriers)
+	{
+		if (imageBarriers.empty() && bufferBarriers.empty())
+		{
+			return;
+		}
+
+		vkCmdPipelineBarrier(m_commandBuffer, srcStage, dstStage, 0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
 	void CommandBuffer::submitSync(VkQueue const& queue, VkFence const& fence)
 	{
 		VkSubmitInfo submitInfo{};
@@ -96,4 +327,44 @@ namespace ToyEngine
 			throw std::runtime_error("Failed to wait queue idle.");
 		}
 	}
+
+	void CommandBuffer::invalidateIncompatible(VkPipelineLayout layout, uint32_t setIndex)
+	{
+		//按pipeline layout兼容性规则，用另一个layout绑定set N后，更高编号的set和push constant可能被破坏
+		//这里无法判断两个layout是否兼容，layout不同就当作失效
+		for (uint32_t i = setIndex + 1; i < MAX_BOUND_DESCRIPTOR_SETS; i++)
+		{
+			if (m_boundSets[i].layout != layout)
+			{
+				m_boundSets[i] = BoundDescriptorSet{};
+			}
+		}
+
+		if (m_pushConstantLayout != layout)
+		{
+			m_pushConstantLayout = VK_NULL_HANDLE;
+			m_pushConstantStages = 0;
+			m_pushConstantValid = 0;
+		}
+	}
+
+	void CommandBuffer::invalidateState()
+	{
+		m_boundPipeline = VK_NULL_HANDLE;
+		for (auto& bound : m_boundSets)
+		{
+			bound = BoundDescriptorSet{};
+		}
+		m_pushConstantLayout = VK_NULL_HANDLE;
+		m_pushConstantStages = 0;
+		m_pushConstantValid = 0;
+		for (auto& bound : m_boundVertexBuffers)
+		{
+			bound = BoundBuffer{};
+		}
+		m_boundIndexBuffer = BoundBuffer{};
+		m_boundIndexType = VK_INDEX_TYPE_UINT16;
+		m_viewportValid = false;
+		m_scissorValid = false;
+	}
 } // ToyEngine
\ No newline at end of file
@@ -1,6 +1,9 @@
 ﻿#include "context.h"
 #include "logger.h"
+#include "binaryLog.h"
 #include "base.h"
+#include <csignal>
+#include <string_view>
 
 namespace ToyEngine
 {
@@ -19,10 +22,52 @@ namespace ToyEngine
 		void* pUserData)
 	{
 		//std::cout << "Validation layer: " << pCallbackData->pMessage << std::endl;
-		LOG_I("Validation layer: {}", pCallbackData->pMessage);
+		static_cast<Context*>(pUserData)->reportValidationMessage(messageSeverity, pCallbackData);
 		return VK_FALSE;
 	}
 
+	static void debugBreak()
+	{
+#if defined(_MSC_VER)
+		__debugbreak();
+#else
+		std::raise(SIGTRAP);
+#endif
+	}
+
+	ValidationConfig ValidationConfig::fromEnvironment()
+	{
+		ValidationConfig config{};
+#ifndef NDEBUG
+		config.validation = true;
+#endif
+
+		if (const char* value = std::getenv("TOY2D_VALIDATION"))
+		{
+			std::string_view mode(value);
+			if (mode == "0" || mode == "off")
+			{
+				config.validation = false;
+			}
+			else if (mode == "break")
+			{
+				config.validation = true;
+				config.breakOnError = true;
+			}
+			else
+			{
+				config.validation = true;
+			}
+		}
+
+		if (const char* value = std::getenv("TOY2D_DEBUG_UTILS"))
+		{
+			config.debugUtils = value[0] != '\0' && value[0] != '0';
+		}
+		config.debugUtils = config.debugUtils || config.validation;
+		return config;
+	}
+
 	static VkResult CreatDebugUtilsMessengerEXT(
 		VkInstance instance,
 		const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
@@ -56,20 +101,60 @@ namespace ToyEngine
 		}
 	}
 
-	Context::Context(bool enableValidationLayers, GLFWwindow* window)
-		: m_enableValidationLayers(enableValidationLayers)
+	static bool hasDeviceExtension(VkPhysicalDevice device, const char* name)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+		for (const auto& extension : extensions)
+		{
+			if (std::strcmp(extension.extensionName, name) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	//bindless需要：运行时数组、非一致索引、部分绑定以及绑定后更新
+	static bool hasDescriptorIndexing(const VkPhysicalDeviceVulkan12Features& f)
 	{
+		return f.descriptorIndexing
+			&& f.runtimeDescriptorArray
+			&& f.descriptorBindingPartiallyBound
+			&& f.descriptorBindingUpdateUnusedWhilePending
+			&& f.descriptorBindingSampledImageUpdateAfterBind
+			&& f.descriptorBindingStorageBufferUpdateAfterBind
+			&& f.shaderSampledImageArrayNonUniformIndexing
+			&& f.shaderStorageBufferArrayNonUniformIndexing;
+	}
+
+	Context::Context(const ValidationConfig& validation, GLFWwindow* window)
+		: m_validationConfig(validation), m_headless(window == nullptr)
+	{
+		//验证层依赖debug utils输出消息
+		m_validationConfig.debugUtils = m_validationConfig.debugUtils || m_validationConfig.validation;
 		m_instanceLayers.push_back("VK_LAYER_KHRONOS_validation");
 
-		m_deviceRequiredExtensions = {
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME
-		};
+		if (!m_headless)
+		{
+			m_deviceRequiredExtensions = {
+				VK_KHR_SWAPCHAIN_EXTENSION_NAME
+			};
+		}
 
 		//printAvailableExtensions();
 		createInstance();
 		pickPhysicalDevice();
-		createSurface(window);
+		if (!m_headless)
+		{
+			createSurface(window);
+		}
 		queryQueueFamilyIndices();
+		queryDeviceFeatures();
 		createLogicalDevice();
 		getGraphicsQueue();
 
@@ -77,11 +162,23 @@ namespace ToyEngine
 
 	Context::~Context()
 	{
-		if (m_enableValidationLayers)
+		if (m_debugger != VK_NULL_HANDLE)
 		{
 			DestroyDebugUtilsMessengerEXT(vk_instance, &m_debugger, nullptr);
 		}
-		vkDestroySurfaceKHR(vk_instance, vk_surface, nullptr);
+
+		//重复出现的消息在退出时汇总一次
+		for (const auto& message : getValidationMessages())
+		{
+			if (message.count > 1)
+			{
+				LOG_W("Validation message {} ({}) was reported {} times.", message.name, message.id, message.count);
+			}
+		}
+		if (vk_surface != VK_NULL_HANDLE)
+		{
+			vkDestroySurfaceKHR(vk_instance, vk_surface, nullptr);
+		}
 		vkDestroyDevice(vk_device, nullptr);
 		vkDestroyInstance(vk_instance, nullptr);
 	}
@@ -91,9 +188,17 @@ namespace ToyEngine
 		return *m_instance;
 	}
 
+	void Context::Init(const ValidationConfig& validation, GLFWwindow* window)
+	{
+		m_instance.reset(new Context(validation, window));
+	}
+
 	void Context::Init(bool enableValidationLayers, GLFWwindow* window)
 	{
-		m_instance.reset(new Context(enableValidationLayers, window));
+		ValidationConfig validation{};
+		validation.validation = enableValidationLayers;
+		validation.debugUtils = enableValidationLayers;
+		Init(validation, window);
 	}
 
 	void Context::Quit()
@@ -103,7 +208,9 @@ namespace ToyEngine
 
 	void Context::createInstance()
 	{
-		if (m_enableValidationLayers && !checkValidationLayerSupport())
+		LOG_I("Validation layers {}, debug utils {}{}.", m_validationConfig.validation ? "on" : "off",
+			m_validationConfig.debugUtils ? "on" : "off", m_validationConfig.breakOnError ? ", break on error" : "");
+		if (m_validationConfig.validation && !checkValidationLayerSupport())
 		{
 			LOG_E("Validation layers requested, but not available.");
 			throw std::runtime_error("Validation layers requested, but not available.");
@@ -127,7 +234,7 @@ namespace ToyEngine
 		createInfo.ppEnabledExtensionNames = extensions.data();
 
 		//layer
-		if (m_enableValidationLayers)
+		if (m_validationConfig.validation)
 		{
 			createInfo.enabledLayerCount = static_cast<uint32_t>(m_instanceLayers.size());
 			createInfo.ppEnabledLayerNames = m_instanceLayers.data();
@@ -167,16 +274,48 @@ namespace ToyEngine
 
 	std::vector<const char*> Context::getRequiredExtensions()
 	{
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		//无窗口时不需要surface相关扩展，也不要求glfw已经初始化
+		std::vector<const char*> extensions;
+		if (!m_headless)
+		{
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
-		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		//只开debug utils时扩展可能不存在，去掉即可；验证层本身提供该扩展
+		if (m_validationConfig.debugUtils && !m_validationConfig.validation
+			&& !isInstanceExtensionSupported(VK_EXT_DEBUG_UTILS_EXTENSION_NAME))
+		{
+			LOG_W("{} is not available, debug utils are disabled.", VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+			m_validationConfig.debugUtils = false;
+		}
+		if (m_validationConfig.debugUtils)
+		{
+			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+		}
 
 		return extensions;
 	}
 
+	bool Context::isInstanceExtensionSupported(const char* name)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+		for (const auto& extension : extensions)
+		{
+			if (std::strcmp(extension.extensionName, name) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	bool Context::checkValidationLayerSupport()
 	{
 		uint32_t layerCount = 0;
@@ -209,7 +348,7 @@ namespace ToyEngine
 
 	void Context::setDebugger()
 	{
-		if (!m_enableValidationLayers)
+		if (!m_validationConfig.validation)
 			return;
 
 		VkDebugUtilsMessengerCreateInfoEXT createInfo{};
@@ -220,7 +359,7 @@ namespace ToyEngine
 			VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
 				| VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
 		createInfo.pfnUserCallback = debugCallback;
-		createInfo.pUserData = nullptr;
+		createInfo.pUserData = this;
 
 		if (CreatDebugUtilsMessengerEXT(vk_instance, &createInfo, nullptr, &m_debugger) != VK_SUCCESS)
 		{
@@ -241,22 +380,35 @@ namespace ToyEngine
 		VkPhysicalDeviceProperties deviceProperties;
 		vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
-		//纹理压缩 浮点数运算特性 多视口渲染等
-		VkPhysicalDeviceFeatures deviceFeatures;
-		vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-
-		if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+		if (!isDeviceSuitable(device))
 		{
-			score += 1000;
+			return 0;
 		}
 
-		score += static_cast<int>(deviceProperties.limits.maxImageDimension2D);
-
-		if (!deviceFeatures.geometryShader)
+		const char* requiredName = std::getenv("TOY2D_DEVICE");
+		if (requiredName != nullptr && std::strstr(deviceProperties.deviceName, requiredName) == nullptr)
 		{
 			return 0;
 		}
 
+		//独显优先，其次是集显和虚拟GPU，CPU实现(例如lavapipe，用于没有GPU的CI)最后
+		switch (deviceProperties.deviceType)
+		{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+			score += 100000;
+			break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+			score += 50000;
+			break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+			score += 10000;
+			break;
+		default:
+			break;
+		}
+
+		score += static_cast<int>(deviceProperties.limits.maxImageDimension2D);
+
 		return score;
 	}
 
@@ -266,11 +418,46 @@ namespace ToyEngine
 		VkPhysicalDeviceProperties deviceProperties;
 		vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
-		//纹理压缩 浮点数运算特性 多视口渲染等
-		VkPhysicalDeviceFeatures deviceFeatures;
-		vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+		//Vulkan12Features等结构需要1.2
+		if (VK_API_VERSION_MAJOR(deviceProperties.apiVersion) == 1 && VK_API_VERSION_MINOR(deviceProperties.apiVersion) < 2)
+		{
+			return false;
+		}
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+		bool hasGraphicsQueue = std::any_of(queueFamilies.begin(), queueFamilies.end(),
+			[](const VkQueueFamilyProperties& family) {
+				return family.queueCount > 0 && (family.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+			});
 
-		return deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU && deviceFeatures.geometryShader;
+		//显示支持要等surface创建之后才能查询，这里只检查交换链扩展
+		if (!hasGraphicsQueue || (!m_headless && !hasDeviceExtension(device, VK_KHR_SWAPCHAIN_EXTENSION_NAME)))
+		{
+			return false;
+		}
+
+		//窗口程序的精灵渲染只有bindless一条路径，在选择设备时就排除不支持的设备
+		if (!m_headless)
+		{
+			VkPhysicalDeviceVulkan12Features vulkan12Features{};
+			vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			VkPhysicalDeviceFeatures2 features2{};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &vulkan12Features;
+			vkGetPhysicalDeviceFeatures2(device, &features2);
+			if (!hasDescriptorIndexing(vulkan12Features))
+			{
+				LOG_W("{} does not support descriptor indexing required by bindless textures, skipped.",
+					deviceProperties.deviceName);
+				return false;
+			}
+		}
+
+		return true;
 	}
 
 	void Context::pickPhysicalDevice()
@@ -294,9 +481,13 @@ namespace ToyEngine
 			candidates.insert(std::make_pair(score, device));
 		}
 
-		if (candidates.rbegin()->first > 0 && isDeviceSuitable(candidates.rbegin()->second))
+		if (candidates.rbegin()->first > 0)
 		{
 			vk_physicalDevice = candidates.rbegin()->second;
+
+			VkPhysicalDeviceProperties properties{};
+			vkGetPhysicalDeviceProperties(vk_physicalDevice, &properties);
+			LOG_I("Selected physical device: {}", properties.deviceName);
 		}
 
 		if (vk_physicalDevice == VK_NULL_HANDLE)
@@ -320,20 +511,28 @@ namespace ToyEngine
 			{
 				vk_graphicsQueueFamilyIndex = i;
 			}
-			//寻找支持显示的队列族
+			//寻找支持显示的队列族，无窗口时直接使用图形队列
 			VkBool32 presentSupport = VK_FALSE;
-			vkGetPhysicalDeviceSurfaceSupportKHR(vk_physicalDevice, i, vk_surface, &presentSupport);
+			if (!m_headless)
+			{
+				vkGetPhysicalDeviceSurfaceSupportKHR(vk_physicalDevice, i, vk_surface, &presentSupport);
+			}
 			if (presentSupport)
 			{
 				vk_presentQueueFamilyIndex = i;
 			}
 
-			if (vk_graphicsQueueFamilyIndex.has_value() && vk_presentQueueFamilyIndex.has_value())
+			if (vk_graphicsQueueFamilyIndex.has_value() && (m_headless || vk_presentQueueFamilyIndex.has_value()))
 			{
 				break;
 			}
 		}
 
+		if (m_headless)
+		{
+			vk_presentQueueFamilyIndex = vk_graphicsQueueFamilyIndex;
+		}
+
 		if (!vk_graphicsQueueFamilyIndex.has_value() || !vk_presentQueueFamilyIndex.has_value())
 		{
 			LOG_E("Failed to find a suitable queue family.");
@@ -341,6 +540,135 @@ namespace ToyEngine
 		}
 	}
 
+	void Context::queryDeviceFeatures()
+	{
+		vk_vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &vk_vulkan12Properties;
+		vkGetPhysicalDeviceProperties2(vk_physicalDevice, &properties2);
+		vk_physicalDeviceProperties = properties2.properties;
+
+		//设备既不是1.3也没有扩展时，不能把动态渲染的特性结构挂到查询链上
+		const uint32_t apiVersion = vk_physicalDeviceProperties.apiVersion;
+		m_dynamicRenderingCore = VK_API_VERSION_MAJOR(apiVersion) > 1 || VK_API_VERSION_MINOR(apiVersion) >= 3;
+		const bool dynamicRenderingExtension = !m_dynamicRenderingCore
+			&& isDeviceExtensionSupported(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+		m_supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		if (m_dynamicRenderingCore || dynamicRenderingExtension)
+		{
+			m_supportedVulkan12Features.pNext = &dynamicRenderingFeatures;
+		}
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &m_supportedVulkan12Features;
+		vkGetPhysicalDeviceFeatures2(vk_physicalDevice, &features2);
+		m_supportedVulkan12Features.pNext = nullptr;
+
+		vk_dynamicRenderingSupported = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+		if (vk_dynamicRenderingSupported && dynamicRenderingExtension)
+		{
+			m_deviceRequiredExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		}
+
+		vk_textureCompressionBC = features2.features.textureCompressionBC;
+		vk_textureCompressionETC2 = features2.features.textureCompressionETC2;
+		vk_textureCompressionASTC = features2.features.textureCompressionASTC_LDR;
+
+		//窗口模式下isDeviceSuitable已经排除了不支持的设备，无窗口时只有用到BindlessHeap的功能不可用
+		vk_descriptorIndexingSupported = hasDescriptorIndexing(m_supportedVulkan12Features);
+		if (!vk_descriptorIndexingSupported)
+		{
+			LOG_W("Descriptor indexing is not fully supported, BindlessHeap cannot be created on this device.");
+		}
+
+		//可选扩展，存在时才开启
+		vk_memoryBudgetSupported = isDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		if (vk_memoryBudgetSupported)
+		{
+			m_deviceRequiredExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+	}
+
+	bool Context::isDeviceExtensionSupported(const char* name)
+	{
+		return hasDeviceExtension(vk_physicalDevice, name);
+	}
+
+	Context::MemoryBudget Context::queryDeviceLocalBudget()
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+		memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memoryProperties.pNext = vk_memoryBudgetSupported ? &budgetProperties : nullptr;
+		vkGetPhysicalDeviceMemoryProperties2(vk_physicalDevice, &memoryProperties);
+
+		MemoryBudget result{};
+		const auto& heaps = memoryProperties.memoryProperties;
+		for (uint32_t i = 0; i < heaps.memoryHeapCount; i++)
+		{
+			if (!(heaps.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+			{
+				continue;
+			}
+
+			if (vk_memoryBudgetSupported)
+			{
+				result.budget += budgetProperties.heapBudget[i];
+				result.usage += budgetProperties.heapUsage[i];
+			}
+			else
+			{
+				//没有预算扩展时保守地只用堆大小的80%
+				result.budget += heaps.memoryHeaps[i].size / 5 * 4;
+			}
+		}
+
+		return result;
+	}
+
+	const VkFormatProperties& Context::getFormatProperties(VkFormat format)
+	{
+		std::lock_guard<std::mutex> lock(m_formatMutex);
+		auto it = m_formatProperties.find(format);
+		if (it != m_formatProperties.end())
+		{
+			return it->second;
+		}
+
+		VkFormatProperties properties{};
+		vkGetPhysicalDeviceFormatProperties(vk_physicalDevice, format, &properties);
+		return m_formatProperties.emplace(format, properties).first->second;
+	}
+
+	bool Context::isFormatSampleable(VkFormat format)
+	{
+		if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !vk_textureCompressionBC)
+		{
+			return false;
+		}
+
+		if (format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK
+			&& !vk_textureCompressionETC2)
+		{
+			return false;
+		}
+
+		if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK
+			&& !vk_textureCompressionASTC)
+		{
+			return false;
+		}
+
+		return (getFormatProperties(format).optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	}
+
 	void Context::createLogicalDevice()
 	{
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
@@ -360,17 +688,46 @@ namespace ToyEngine
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
-		VkPhysicalDeviceFeatures deviceFeatures{};
+		//通过pNext链开启扩展特性，此时pEnabledFeatures必须为空，基础特性放在features2.features中
+		VkPhysicalDeviceVulkan12Features enabledVulkan12Features{};
+		enabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		if (vk_descriptorIndexingSupported)
+		{
+			enabledVulkan12Features.descriptorIndexing = VK_TRUE;
+			enabledVulkan12Features.runtimeDescriptorArray = VK_TRUE;
+			enabledVulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+			enabledVulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			enabledVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			enabledVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+			enabledVulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			enabledVulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+		}
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR enabledDynamicRendering{};
+		enabledDynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		enabledDynamicRendering.dynamicRendering = VK_TRUE;
+		if (vk_dynamicRenderingSupported)
+		{
+			enabledVulkan12Features.pNext = &enabledDynamicRendering;
+		}
+
+		VkPhysicalDeviceFeatures2 deviceFeatures{};
+		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures.pNext = &enabledVulkan12Features;
+		deviceFeatures.features.textureCompressionBC = vk_textureCompressionBC;
+		deviceFeatures.features.textureCompressionETC2 = vk_textureCompressionETC2;
+		deviceFeatures.features.textureCompressionASTC_LDR = vk_textureCompressionASTC;
 
 		VkDeviceCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &deviceFeatures;
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-		createInfo.pEnabledFeatures = &deviceFeatures;
+		createInfo.pEnabledFeatures = nullptr;
 		createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceRequiredExtensions.size());
 		createInfo.ppEnabledExtensionNames = m_deviceRequiredExtensions.data();
 
-		if (m_enableValidationLayers)
+		if (m_validationConfig.validation)
 		{
 			createInfo.enabledLayerCount = static_cast<uint32_t>(m_instanceLayers.size());
 			createInfo.ppEnabledLayerNames = m_instanceLayers.data();
@@ -392,6 +749,15 @@ namespace ToyEngine
 
 		vkGetDeviceQueue(vk_device, vk_graphicsQueueFamilyIndex.value(), 0, &vk_graphicsQueue);
 		vkGetDeviceQueue(vk_device, vk_presentQueueFamilyIndex.value(), 0, &vk_presentQueue);
+
+		if (vk_dynamicRenderingSupported)
+		{
+			vk_cmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(vk_device,
+				m_dynamicRenderingCore ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR");
+			vk_cmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(vk_device,
+				m_dynamicRenderingCore ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR");
+			vk_dynamicRenderingSupported = vk_cmdBeginRendering != nullptr && vk_cmdEndRendering != nullptr;
+		}
 	}
 
 	void Context::getGraphicsQueue()
@@ -412,4 +778,75 @@ namespace ToyEngine
 		}
 	}
 
+	void Context::reportValidationMessage(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		const VkDebugUtilsMessengerCallbackDataEXT* data)
+	{
+		//loader等没有ID的消息按名字或内容去重
+		const char* name = data->pMessageIdName != nullptr ? data->pMessageIdName : "";
+		uint64_t key = data->messageIdNumber != 0
+			? static_cast<uint32_t>(data->messageIdNumber)
+			: std::hash<std::string_view>{}(name[0] != '\0' ? name : data->pMessage);
+
+		uint64_t count = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_validationMutex);
+			auto& stats = m_validationMessages[key];
+			if (stats.count == 0)
+			{
+				stats.id = data->messageIdNumber;
+				stats.name = name;
+				stats.severity = severity;
+			}
+			count = ++stats.count;
+		}
+
+		bool error = severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		if (count == 1)
+		{
+			//验证层可能每次API调用都回调，只拷贝消息，格式化交给后台线程
+			if (error)
+			{
+				LOG_BIN(E, "Validation layer: {}", data->pMessage);
+			}
+			else
+			{
+				LOG_BIN(W, "Validation layer: {}", data->pMessage);
+			}
+		}
+		else
+		{
+			uint64_t power = 10;
+			while (power < count)
+			{
+				power *= 10;
+			}
+			if (power == count)
+			{
+				LOG_BIN(W, "Validation message {} has been reported {} times.", name, count);
+			}
+		}
+
+		if (error && m_validationConfig.breakOnError)
+		{
+			debugBreak();
+		}
+	}
+
+	std::vector<ValidationMessageStats> Context::getValidationMessages()
+	{
+		std::vector<ValidationMessageStats> messages;
+		{
+			std::lock_guard<std::mutex> lock(m_validationMutex);
+			messages.reserve(m_validationMessages.size());
+			for (const auto& [key, stats] : m_validationMessages)
+			{
+				messages.push_back(stats);
+			}
+		}
+
+		std::sort(messages.begin(), messages.end(), [](const auto& a, const auto& b) {
+			return a.count > b.count;
+		});
+		return messages;
+	}
 } // toy2d
\ No newline at end of file
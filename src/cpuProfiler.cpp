@@ -0,0 +1,143 @@
+#include "cpuProfiler.h"
+#include "logger.h"
+#include <iomanip>
+#include <mutex>
+
+namespace ToyEngine
+{
+	//单线程写入的环形buffer，head只增不减，读取方用acquire读取head后拷贝最近的事件
+	struct ProfileThreadBuffer
+	{
+		uint32_t threadId{ 0 };
+		std::string threadName;
+		std::unique_ptr<ProfileEvent[]> events{ new ProfileEvent[CpuProfiler::CAPACITY] };
+		std::atomic<uint64_t> head{ 0 };
+	};
+
+	//buffer由全局列表持有，线程退出后记录的事件仍然可以导出
+	static std::mutex s_buffersMutex;
+	static std::vector<std::shared_ptr<ProfileThreadBuffer>> s_buffers;
+	static std::atomic<uint64_t> s_frameCount{ 0 };
+
+	static ProfileThreadBuffer& getThreadBuffer()
+	{
+		thread_local ProfileThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			auto newBuffer = std::make_shared<ProfileThreadBuffer>();
+
+			std::lock_guard<std::mutex> lock(s_buffersMutex);
+			newBuffer->threadId = static_cast<uint32_t>(s_buffers.size());
+			newBuffer->threadName = "thread " + std::to_string(newBuffer->threadId);
+			s_buffers.push_back(newBuffer);
+			buffer = newBuffer.get();
+		}
+
+		return *buffer;
+	}
+
+	static void writeJsonString(std::ofstream& out, const char* text)
+	{
+		out << '"';
+		for (const char* c = text; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				out << '\\';
+			}
+			out << *c;
+		}
+		out << '"';
+	}
+
+	void CpuProfiler::record(const char* name, uint64_t beginNs, uint64_t endNs)
+	{
+		auto& buffer = getThreadBuffer();
+		uint64_t head = buffer.head.load(std::memory_order_relaxed);
+		buffer.events[head & (CAPACITY - 1)] = { name, beginNs, endNs };
+		buffer.head.store(head + 1, std::memory_order_release);
+	}
+
+	void CpuProfiler::frameMark()
+	{
+		uint64_t time = now();
+		record("frame", time, time);
+		s_frameCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void CpuProfiler::setThreadName(const std::string& name)
+	{
+		auto& buffer = getThreadBuffer();
+		std::lock_guard<std::mutex> lock(s_buffersMutex);
+		buffer.threadName = name;
+	}
+
+	uint64_t CpuProfiler::getFrameCount()
+	{
+		return s_frameCount.load(std::memory_order_relaxed);
+	}
+
+	bool CpuProfiler::exportChromeTrace(const std::string& path)
+	{
+		std::ofstream out(path, std::ios::out | std::ios::trunc);
+		if (!out.is_open())
+		{
+			LOG_E("Failed to open profile trace file {}.", path);
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+		//时间戳以最早的事件为0点，单位微秒
+		uint64_t origin = UINT64_MAX;
+		std::vector<std::vector<ProfileEvent>> snapshots(s_buffers.size());
+		for (size_t i = 0; i < s_buffers.size(); i++)
+		{
+			const auto& buffer = *s_buffers[i];
+			uint64_t head = buffer.head.load(std::memory_order_acquire);
+			uint64_t count = std::min<uint64_t>(head, CAPACITY);
+			snapshots[i].reserve(count);
+			for (uint64_t e = head - count; e < head; e++)
+			{
+				const auto& event = buffer.events[e & (CAPACITY - 1)];
+				snapshots[i].push_back(event);
+				origin = std::min(origin, event.beginNs);
+			}
+		}
+
+		size_t eventCount = 0;
+		out << std::fixed << std::setprecision(3);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		for (size_t i = 0; i < s_buffers.size(); i++)
+		{
+			const auto& buffer = *s_buffers[i];
+			out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadId
+				<< ",\"args\":{\"name\":";
+			writeJsonString(out, buffer.threadName.c_str());
+			out << "}}";
+			first = false;
+
+			for (const auto& event : snapshots[i])
+			{
+				out << ",\n{\"name\":";
+				writeJsonString(out, event.name != nullptr ? event.name : "");
+				out << ",\"pid\":1,\"tid\":" << buffer.threadId
+					<< ",\"ts\":" << (event.beginNs - origin) / 1000.0;
+				if (event.endNs == event.beginNs)
+				{
+					out << ",\"ph\":\"i\",\"s\":\"g\"}";
+				}
+				else
+				{
+					out << ",\"ph\":\"X\",\"dur\":" << (event.endNs - event.beginNs) / 1000.0 << "}";
+				}
+				eventCount++;
+			}
+		}
+		out << "\n]}\n";
+
+		LOG_I("Exported {} profile events from {} threads to {}.", eventCount, s_buffers.size(), path);
+		return true;
+	}
+} // ToyEngine
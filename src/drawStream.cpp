@@ -0,0 +1,192 @@
+#include "drawStream.h"
+#include "tool.h"
+#include "logger.h"
+#include "cpuProfiler.h"
+
+namespace ToyEngine
+{
+	//push constant数据按4字节对齐，vkCmdPushConstants要求offset和size都是4的倍数
+	static constexpr uint32_t DATA_ALIGNMENT = 4;
+
+	static uint64_t quantizeDepth(float depth)
+	{
+		return static_cast<uint64_t>(glm::clamp(depth, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+
+	uint64_t DrawKey::opaque(uint32_t pass, uint32_t pipeline, uint32_t material, float depth, uint32_t texture)
+	{
+		return (static_cast<uint64_t>(pass & 0xF) << 60)
+			| (static_cast<uint64_t>(pipeline & 0x7FF) << 48)
+			| (static_cast<uint64_t>(material & 0xFFF) << 36)
+			| (quantizeDepth(depth) << 20)
+			| (texture & 0xFFFFF);
+	}
+
+	uint64_t DrawKey::transparent(uint32_t pass, uint32_t pipeline, uint32_t material, float depth, uint32_t texture)
+	{
+		return (static_cast<uint64_t>(pass & 0xF) << 60)
+			| (1ull << 59)
+			| ((0xFFFF - quantizeDepth(depth)) << 43)
+			| (static_cast<uint64_t>(pipeline & 0x7FF) << 32)
+			| (static_cast<uint64_t>(material & 0xFFF) << 20)
+			| (texture & 0xFFFFF);
+	}
+
+	DrawStreamPtr DrawStream::create(uint32_t maxCommands, uint32_t maxDataBytes)
+	{
+		return std::make_shared<DrawStream>(maxCommands, maxDataBytes);
+	}
+
+	DrawStream::DrawStream(uint32_t maxCommands, uint32_t maxDataBytes)
+		: m_commands(maxCommands), m_sortItems(maxCommands), m_sortScratch(maxCommands), m_data(maxDataBytes)
+	{
+	}
+
+	void DrawStream::reset()
+	{
+		m_commandCount.store(0, std::memory_order_relaxed);
+		m_dataHead.store(0, std::memory_order_relaxed);
+		m_dropped.store(0, std::memory_order_relaxed);
+		m_draws = 0;
+		m_merged = 0;
+	}
+
+	bool DrawStream::submit(uint64_t key, const DrawCommand& command, const void* pushConstants)
+	{
+		//先分配数据区再占命令槽，数据区不足时不会留下空的命令
+		uint32_t dataOffset = 0;
+		if (command.pushConstantSize > 0)
+		{
+			uint32_t size = (command.pushConstantSize + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+			dataOffset = m_dataHead.fetch_add(size, std::memory_order_relaxed);
+			if (pushConstants == nullptr || dataOffset + size > m_data.size())
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				LOG_EVERY_MS(W, 1000, "Draw stream data overflow: {} bytes.", m_data.size());
+				return false;
+			}
+			std::memcpy(m_data.data() + dataOffset, pushConstants, command.pushConstantSize);
+		}
+
+		uint32_t index = m_commandCount.fetch_add(1, std::memory_order_relaxed);
+		if (index >= m_commands.size())
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			LOG_EVERY_MS(W, 1000, "Draw stream overflow: capacity {}.", m_commands.size());
+			return false;
+		}
+
+		m_commands[index] = command;
+		m_commands[index].pushConstantOffset = dataOffset;
+		m_sortItems[index] = { key, index };
+		return true;
+	}
+
+	void DrawStream::sort()
+	{
+		TOY_PROFILE_FUNCTION();
+		radixSort(m_sortItems.data(), m_sortScratch.data(), size(),
+			[](const SortItem& item)
+			{
+			  return item.key;
+			});
+	}
+
+	void DrawStream::execute(const CommandBufferPtr& commandBuffer, uint32_t pass)
+	{
+		TOY_PROFILE_FUNCTION();
+		auto begin = m_sortItems.begin();
+		auto end = m_sortItems.begin() + static_cast<std::ptrdiff_t>(size());
+		auto first = std::lower_bound(begin, end, pass, [](const SortItem& item, uint32_t value)
+		{
+		  return DrawKey::getPass(item.key) < value;
+		});
+		auto last = std::upper_bound(first, end, pass, [](uint32_t value, const SortItem& item)
+		{
+		  return value < DrawKey::getPass(item.key);
+		});
+		if (first == last)
+		{
+			return;
+		}
+
+		//instanced sprite的批次常常被拆成相连的实例区间，状态相同时合并成一次draw
+		DrawCommand pending = m_commands[first->index];
+		for (auto it = first + 1; it != last; ++it)
+		{
+			const DrawCommand& command = m_commands[it->index];
+			if (sameState(pending, command)
+				&& command.vertexCount == pending.vertexCount
+				&& command.firstVertex == pending.firstVertex
+				&& command.baseVertex == pending.baseVertex
+				&& command.firstInstance == pending.firstInstance + pending.instanceCount)
+			{
+				pending.instanceCount += command.instanceCount;
+				m_merged++;
+				continue;
+			}
+
+			record(commandBuffer, pending);
+			pending = command;
+		}
+		record(commandBuffer, pending);
+	}
+
+	DrawStreamStats DrawStream::getStats() const
+	{
+		DrawStreamStats stats{};
+		stats.submitted = static_cast<uint32_t>(size());
+		stats.dropped = m_dropped.load(std::memory_order_relaxed);
+		stats.draws = m_draws;
+		stats.merged = m_merged;
+		return stats;
+	}
+
+	bool DrawStream::sameState(const DrawCommand& a, const DrawCommand& b) const
+	{
+		return a.pipeline == b.pipeline
+			&& a.layout == b.layout
+			&& a.descriptorSet == b.descriptorSet
+			&& a.dynamicOffsetCount == b.dynamicOffsetCount
+			&& (a.dynamicOffsetCount == 0 || a.dynamicOffset == b.dynamicOffset)
+			&& a.vertexBuffer == b.vertexBuffer
+			&& a.vertexOffset == b.vertexOffset
+			&& a.indexBuffer == b.indexBuffer
+			&& (a.indexBuffer == VK_NULL_HANDLE || (a.indexOffset == b.indexOffset && a.indexType == b.indexType))
+			&& a.pushConstantStages == b.pushConstantStages
+			&& a.pushConstantSize == b.pushConstantSize
+			&& std::memcmp(m_data.data() + a.pushConstantOffset, m_data.data() + b.pushConstantOffset,
+				a.pushConstantSize) == 0;
+	}
+
+	void DrawStream::record(const CommandBufferPtr& commandBuffer, const DrawCommand& command)
+	{
+		commandBuffer->bindGraphicPipeline(command.pipeline);
+		if (command.descriptorSet != VK_NULL_HANDLE)
+		{
+			commandBuffer->bindDescriptorSet(command.layout, 0, command.descriptorSet,
+				command.dynamicOffsetCount, &command.dynamicOffset);
+		}
+		if (command.vertexBuffer != VK_NULL_HANDLE)
+		{
+			commandBuffer->bindVertexBuffer(0, command.vertexBuffer, command.vertexOffset);
+		}
+		if (command.pushConstantSize > 0)
+		{
+			commandBuffer->pushConstants(command.layout, command.pushConstantStages, 0, command.pushConstantSize,
+				m_data.data() + command.pushConstantOffset);
+		}
+		if (command.indexBuffer != VK_NULL_HANDLE)
+		{
+			commandBuffer->bindIndexBuffer(command.indexBuffer, command.indexOffset, command.indexType);
+			commandBuffer->drawIndexed(command.vertexCount, command.instanceCount, command.firstVertex,
+				command.baseVertex, command.firstInstance);
+		}
+		else
+		{
+			commandBuffer->draw(command.vertexCount, command.instanceCount, command.firstVertex,
+				command.firstInstance);
+		}
+		m_draws++;
+	}
+} // ToyEngine
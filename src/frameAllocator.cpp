@@ -0,0 +1,143 @@
+#include "frameAllocator.h"
+#include "logger.h"
+
+namespace ToyEngine
+{
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	FrameUniformAllocatorPtr FrameUniformAllocator::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		VkDeviceSize bytesPerFrame,
+		uint32_t framesInFlight,
+		uint32_t maxAllocationSize)
+	{
+		return std::make_shared<FrameUniformAllocator>(device, physicalDevice, bytesPerFrame, framesInFlight,
+			maxAllocationSize);
+	}
+
+	FrameUniformAllocator::FrameUniformAllocator(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		VkDeviceSize bytesPerFrame,
+		uint32_t framesInFlight,
+		uint32_t maxAllocationSize)
+	{
+		m_device = device;
+		m_framesInFlight = framesInFlight;
+
+		const auto& limits = vkContext.vk_physicalDeviceProperties.limits;
+		m_alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 16);
+		m_maxAllocationSize = std::min(maxAllocationSize, limits.maxUniformBufferRange);
+		m_bytesPerFrame = alignUp(bytesPerFrame, m_alignment);
+
+		//dynamic offset + range不能越过buffer末尾，所以在最后多留一个range
+		VkDeviceSize totalSize = m_bytesPerFrame * m_framesInFlight + m_maxAllocationSize;
+		m_buffer = Buffer::create(device, physicalDevice, totalSize,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		m_mapped = static_cast<uint8_t*>(m_buffer->map());
+
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+
+		if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create frame uniform descriptor set layout.");
+		}
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		poolSize.descriptorCount = 1;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create frame uniform descriptor pool.");
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_setLayout;
+
+		if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate frame uniform descriptor set.");
+		}
+
+		//offset始终为0，实际位置由dynamic offset决定
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = m_buffer->getBuffer();
+		bufferInfo.offset = 0;
+		bufferInfo.range = m_maxAllocationSize;
+
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_descriptorSet;
+		write.dstBinding = 0;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		write.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+		beginFrame(0);
+	}
+
+	FrameUniformAllocator::~FrameUniformAllocator()
+	{
+		if (m_descriptorPool != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+		}
+
+		if (m_setLayout != VK_NULL_HANDLE)
+		{
+			vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+		}
+
+		m_buffer.reset();
+	}
+
+	void FrameUniformAllocator::beginFrame(uint32_t frameIndex)
+	{
+		m_frameBegin = m_bytesPerFrame * (frameIndex % m_framesInFlight);
+		m_frameEnd = m_frameBegin + m_bytesPerFrame;
+		m_head = m_frameBegin;
+	}
+
+	FrameAllocation FrameUniformAllocator::allocate(uint32_t size)
+	{
+		if (size > m_maxAllocationSize)
+		{
+			LOG_E("Uniform allocation of {} bytes exceeds the descriptor range {}.", size, m_maxAllocationSize);
+			throw std::runtime_error("Uniform allocation is too large.");
+		}
+
+		VkDeviceSize offset = alignUp(m_head, m_alignment);
+		if (offset + size > m_frameEnd)
+		{
+			LOG_E("Frame uniform allocator is out of memory ({} bytes per frame).", m_bytesPerFrame);
+			throw std::runtime_error("Frame uniform allocator is out of memory.");
+		}
+
+		m_head = offset + size;
+		return { m_mapped + offset, static_cast<uint32_t>(offset) };
+	}
+} // ToyEngine
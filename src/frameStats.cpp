@@ -0,0 +1,321 @@
+#include "frameStats.h"
+#include "logger.h"
+#include <cmath>
+#include <iomanip>
+
+namespace ToyEngine
+{
+	const char* toString(FrameStage stage)
+	{
+		switch (stage)
+		{
+		case FrameStage::FenceWait:
+			return "fenceWait";
+		case FrameStage::Acquire:
+			return "acquire";
+		case FrameStage::Record:
+			return "record";
+		case FrameStage::Submit:
+			return "submit";
+		case FrameStage::Present:
+			return "present";
+		case FrameStage::PacketWait:
+			return "packetWait";
+		default:
+			return "unknown";
+		}
+	}
+
+	void FrameStats::Histogram::add(double ms)
+	{
+		buckets[toBucket(ms)]++;
+		count++;
+	}
+
+	void FrameStats::Histogram::remove(double ms)
+	{
+		buckets[toBucket(ms)]--;
+		count--;
+	}
+
+	double FrameStats::Histogram::percentile(double p) const
+	{
+		if (count == 0)
+		{
+			return 0.0;
+		}
+
+		//第一个累计数量达到rank的桶，返回桶的上沿
+		auto rank = static_cast<uint32_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * count));
+		rank = std::max(rank, 1u);
+		uint32_t accumulated = 0;
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			accumulated += buckets[i];
+			if (accumulated >= rank)
+			{
+				return (i + 1) * BUCKET_MS;
+			}
+		}
+		return BUCKET_COUNT * BUCKET_MS;
+	}
+
+	FrameStatsPtr FrameStats::create()
+	{
+		return std::make_shared<FrameStats>();
+	}
+
+	FrameStats::FrameStats()
+	{
+		m_records.resize(WINDOW_SIZE);
+	}
+
+	void FrameStats::beginFrame()
+	{
+		m_current = {};
+		m_current.frameIndex = m_frameCount;
+		m_frameBegin = Clock::now();
+		m_inFrame = true;
+	}
+
+	void FrameStats::endFrame()
+	{
+		if (!m_inFrame)
+		{
+			return;
+		}
+
+		auto now = Clock::now();
+		m_current.frameMs = elapsedMs(m_frameCount == 0 ? m_frameBegin : m_lastFrameEnd, now);
+		m_lastFrameEnd = now;
+		m_inFrame = false;
+
+		//窗口满了先把被覆盖的样本从直方图中移除
+		auto& slot = m_records[m_next];
+		if (m_count == WINDOW_SIZE)
+		{
+			for (uint32_t metric = 0; metric < METRIC_COUNT; metric++)
+			{
+				m_histograms[metric].remove(getMetric(slot, metric));
+			}
+		}
+
+		slot = m_current;
+		for (uint32_t metric = 0; metric < METRIC_COUNT; metric++)
+		{
+			m_histograms[metric].add(getMetric(slot, metric));
+		}
+
+		m_next = (m_next + 1) % WINDOW_SIZE;
+		m_count = std::min(m_count + 1, WINDOW_SIZE);
+		m_frameCount++;
+	}
+
+	void FrameStats::beginStage(FrameStage stage)
+	{
+		m_stageBegin[static_cast<uint32_t>(stage)] = Clock::now();
+	}
+
+	void FrameStats::endStage(FrameStage stage)
+	{
+		auto index = static_cast<uint32_t>(stage);
+		m_current.stageMs[index] += elapsedMs(m_stageBegin[index], Clock::now());
+	}
+
+	void FrameStats::addCommandStats(const CommandBufferStats& stats)
+	{
+		m_current.draws += stats.draws;
+		m_current.pipelineBinds += stats.pipelineBinds;
+		m_current.descriptorBinds += stats.descriptorBinds;
+		m_current.elidedCalls += stats.elidedCalls;
+	}
+
+	void FrameStats::addUploadBytes(uint64_t bytes)
+	{
+		m_current.uploadBytes += bytes;
+	}
+
+	FrameRecord FrameStats::getLastFrame() const
+	{
+		if (m_count == 0)
+		{
+			return {};
+		}
+
+		return m_records[(m_next + WINDOW_SIZE - 1) % WINDOW_SIZE];
+	}
+
+	std::vector<FrameRecord> FrameStats::getHistory() const
+	{
+		std::vector<FrameRecord> history;
+		history.reserve(m_count);
+		uint32_t first = (m_next + WINDOW_SIZE - m_count) % WINDOW_SIZE;
+		for (uint32_t i = 0; i < m_count; i++)
+		{
+			history.push_back(m_records[(first + i) % WINDOW_SIZE]);
+		}
+		return history;
+	}
+
+	FrameStatsSummary FrameStats::getSummary() const
+	{
+		FrameStatsSummary summary{};
+		summary.sampleCount = m_count;
+		if (m_count == 0)
+		{
+			return summary;
+		}
+
+		summary.frame = summarize(0);
+		for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+		{
+			summary.stages[stage] = summarize(stage + 1);
+		}
+
+		//环形数组中未写入的记录全为0，直接求和即可
+		for (const auto& record : m_records)
+		{
+			summary.avgDraws += record.draws;
+			summary.avgPipelineBinds += record.pipelineBinds;
+			summary.avgDescriptorBinds += record.descriptorBinds;
+			summary.avgElidedCalls += record.elidedCalls;
+			summary.avgUploadBytes += static_cast<double>(record.uploadBytes);
+		}
+		summary.avgDraws /= m_count;
+		summary.avgPipelineBinds /= m_count;
+		summary.avgDescriptorBinds /= m_count;
+		summary.avgElidedCalls /= m_count;
+		summary.avgUploadBytes /= m_count;
+		return summary;
+	}
+
+	double FrameStats::getFramePercentile(double percentile) const
+	{
+		return m_histograms[0].percentile(percentile);
+	}
+
+	double FrameStats::getStagePercentile(FrameStage stage, double percentile) const
+	{
+		return m_histograms[static_cast<uint32_t>(stage) + 1].percentile(percentile);
+	}
+
+	bool FrameStats::writeCsv(const std::string& path) const
+	{
+		std::ofstream out(path, std::ios::out | std::ios::trunc);
+		if (!out.is_open())
+		{
+			LOG_E("Failed to open frame stats file {}.", path);
+			return false;
+		}
+
+		out << "frame,frameMs";
+		for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+		{
+			out << "," << toString(static_cast<FrameStage>(stage)) << "Ms";
+		}
+		out << ",draws,pipelineBinds,descriptorBinds,elidedCalls,uploadBytes\n";
+
+		out << std::fixed << std::setprecision(4);
+		for (const auto& record : getHistory())
+		{
+			out << record.frameIndex << "," << record.frameMs;
+			for (double stageMs : record.stageMs)
+			{
+				out << "," << stageMs;
+			}
+			out << "," << record.draws << "," << record.pipelineBinds << "," << record.descriptorBinds
+				<< "," << record.elidedCalls << "," << record.uploadBytes << "\n";
+		}
+
+		LOG_I("Wrote {} frame records to {}.", m_count, path);
+		return true;
+	}
+
+	bool FrameStats::writeJson(const std::string& path) const
+	{
+		std::ofstream out(path, std::ios::out | std::ios::trunc);
+		if (!out.is_open())
+		{
+			LOG_E("Failed to open frame stats file {}.", path);
+			return false;
+		}
+
+		auto summary = getSummary();
+		auto writeTiming = [&out](const TimingSummary& timing) {
+			out << "{\"avgMs\":" << timing.avgMs << ",\"maxMs\":" << timing.maxMs
+				<< ",\"p50Ms\":" << timing.p50Ms << ",\"p95Ms\":" << timing.p95Ms
+				<< ",\"p99Ms\":" << timing.p99Ms << "}";
+		};
+
+		out << std::fixed << std::setprecision(4);
+		out << "{\n\"frameCount\":" << m_frameCount << ",\n\"sampleCount\":" << summary.sampleCount
+			<< ",\n\"frame\":";
+		writeTiming(summary.frame);
+
+		out << ",\n\"stages\":{";
+		for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+		{
+			out << (stage == 0 ? "" : ",") << "\n\"" << toString(static_cast<FrameStage>(stage)) << "\":";
+			writeTiming(summary.stages[stage]);
+		}
+		out << "\n},\n\"counters\":{\"avgDraws\":" << summary.avgDraws
+			<< ",\"avgPipelineBinds\":" << summary.avgPipelineBinds
+			<< ",\"avgDescriptorBinds\":" << summary.avgDescriptorBinds
+			<< ",\"avgElidedCalls\":" << summary.avgElidedCalls
+			<< ",\"avgUploadBytes\":" << summary.avgUploadBytes << "}";
+
+		//只输出非空的桶
+		out << ",\n\"frameHistogram\":{\"bucketMs\":" << BUCKET_MS << ",\"buckets\":[";
+		bool first = true;
+		const auto& histogram = m_histograms[0];
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			if (histogram.buckets[i] == 0)
+			{
+				continue;
+			}
+			out << (first ? "" : ",") << "[" << i << "," << histogram.buckets[i] << "]";
+			first = false;
+		}
+		out << "]}\n}\n";
+
+		LOG_I("Wrote frame stats summary to {}.", path);
+		return true;
+	}
+
+	double FrameStats::getMetric(const FrameRecord& record, uint32_t metric)
+	{
+		return metric == 0 ? record.frameMs : record.stageMs[metric - 1];
+	}
+
+	uint32_t FrameStats::toBucket(double ms)
+	{
+		auto bucket = static_cast<int64_t>(ms / BUCKET_MS);
+		return static_cast<uint32_t>(std::clamp<int64_t>(bucket, 0, BUCKET_COUNT - 1));
+	}
+
+	double FrameStats::elapsedMs(Clock::time_point begin, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - begin).count();
+	}
+
+	TimingSummary FrameStats::summarize(uint32_t metric) const
+	{
+		TimingSummary timing{};
+		uint32_t first = (m_next + WINDOW_SIZE - m_count) % WINDOW_SIZE;
+		for (uint32_t i = 0; i < m_count; i++)
+		{
+			double ms = getMetric(m_records[(first + i) % WINDOW_SIZE], metric);
+			timing.avgMs += ms;
+			timing.maxMs = std::max(timing.maxMs, ms);
+		}
+		timing.avgMs /= std::max(m_count, 1u);
+
+		//桶的上沿可能超过真实的最大值
+		const auto& histogram = m_histograms[metric];
+		timing.p50Ms = std::min(histogram.percentile(50.0), timing.maxMs);
+		timing.p95Ms = std::min(histogram.percentile(95.0), timing.maxMs);
+		timing.p99Ms = std::min(histogram.percentile(99.0), timing.maxMs);
+		return timing;
+	}
+} // ToyEngine
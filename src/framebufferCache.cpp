@@ -0,0 +1,111 @@
+#include "framebufferCache.h"
+#include "logger.h"
+#include "tool.h"
+
+namespace ToyEngine
+{
+	FramebufferCachePtr FramebufferCache::create(const VkDevice& device, uint32_t framesInFlight)
+	{
+		return std::make_shared<FramebufferCache>(device, framesInFlight);
+	}
+
+	FramebufferCache::FramebufferCache(const VkDevice& device, uint32_t framesInFlight)
+	{
+		m_device = device;
+		m_framesInFlight = framesInFlight;
+	}
+
+	FramebufferCache::~FramebufferCache()
+	{
+		for (auto& [key, framebuffer] : m_framebuffers)
+		{
+			vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+		}
+		m_framebuffers.clear();
+
+		for (auto& retired : m_retired)
+		{
+			vkDestroyFramebuffer(m_device, retired.framebuffer, nullptr);
+		}
+		m_retired.clear();
+	}
+
+	VkFramebuffer FramebufferCache::get(VkRenderPass renderPass, const std::vector<VkImageView>& views,
+		VkExtent2D extent)
+	{
+		FramebufferKey key{ renderPass, views, extent.width, extent.height };
+		auto it = m_framebuffers.find(key);
+		if (it != m_framebuffers.end())
+		{
+			return it->second;
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+		framebufferInfo.pAttachments = views.data();
+		framebufferInfo.width = extent.width;
+		framebufferInfo.height = extent.height;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer{ VK_NULL_HANDLE };
+		if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create framebuffer.");
+		}
+
+		m_framebuffers.emplace(std::move(key), framebuffer);
+		return framebuffer;
+	}
+
+	void FramebufferCache::evictViews(const std::vector<VkImageView>& views)
+	{
+		for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();)
+		{
+			bool stale = std::any_of(it->first.views.begin(), it->first.views.end(), [&views](VkImageView view) {
+				return std::find(views.begin(), views.end(), view) != views.end();
+			});
+
+			if (stale)
+			{
+				m_retired.push_back({ it->second, m_framesInFlight + 1 });
+				it = m_framebuffers.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	void FramebufferCache::nextFrame()
+	{
+		for (size_t i = 0; i < m_retired.size();)
+		{
+			if (--m_retired[i].framesLeft == 0)
+			{
+				vkDestroyFramebuffer(m_device, m_retired[i].framebuffer, nullptr);
+				m_retired[i] = m_retired.back();
+				m_retired.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	size_t FramebufferCache::FramebufferKeyHash::operator()(const FramebufferKey& key) const
+	{
+		uint64_t hash = 0;
+		hashCombine(hash, (uint64_t)key.renderPass);
+		for (auto view : key.views)
+		{
+			hashCombine(hash, (uint64_t)view);
+		}
+		hashCombine(hash, key.width);
+		hashCombine(hash, key.height);
+		return static_cast<size_t>(hash);
+	}
+} // ToyEngine
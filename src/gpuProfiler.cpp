@@ -0,0 +1,205 @@
+#include "gpuProfiler.h"
+#include "logger.h"
+
+namespace ToyEngine
+{
+	GpuProfilerPtr GpuProfiler::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		uint32_t queueFamilyIndex,
+		uint32_t framesInFlight,
+		uint32_t maxScopesPerFrame)
+	{
+		return std::make_shared<GpuProfiler>(device, physicalDevice, queueFamilyIndex, framesInFlight,
+			maxScopesPerFrame);
+	}
+
+	GpuProfiler::GpuProfiler(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		uint32_t queueFamilyIndex,
+		uint32_t framesInFlight,
+		uint32_t maxScopesPerFrame)
+	{
+		m_device = device;
+		m_maxScopes = maxScopesPerFrame;
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+		m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+		if (!m_supported)
+		{
+			LOG_W("Timestamp queries are not supported on this queue, GPU profiling is disabled.");
+			return;
+		}
+
+		m_timestampPeriod = properties.limits.timestampPeriod;
+		m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+		m_frames.resize(framesInFlight);
+		for (auto& frame : m_frames)
+		{
+			VkQueryPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			poolInfo.queryCount = m_maxScopes * 2;
+
+			if (vkCreateQueryPool(m_device, &poolInfo, nullptr, &frame.queryPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create timestamp query pool.");
+			}
+			frame.scopes.reserve(m_maxScopes);
+		}
+		m_results.resize(m_maxScopes * 2);
+	}
+
+	GpuProfiler::~GpuProfiler()
+	{
+		for (auto& frame : m_frames)
+		{
+			if (frame.queryPool != VK_NULL_HANDLE)
+			{
+				vkDestroyQueryPool(m_device, frame.queryPool, nullptr);
+			}
+		}
+		m_frames.clear();
+	}
+
+	void GpuProfiler::beginFrame(const CommandBufferPtr& commandBuffer, uint32_t frameIndex)
+	{
+		if (!m_supported)
+		{
+			return;
+		}
+
+		auto& frame = m_frames[frameIndex % m_frames.size()];
+		collect(frame);
+
+		frame.scopes.clear();
+		frame.queryCount = 0;
+		commandBuffer->resetQueryPool(frame.queryPool, 0, m_maxScopes * 2);
+		m_currentFrame = &frame;
+	}
+
+	uint32_t GpuProfiler::beginScope(const CommandBufferPtr& commandBuffer, const std::string& name)
+	{
+		if (!m_supported || m_currentFrame == nullptr || m_currentFrame->scopes.size() >= m_maxScopes)
+		{
+			return INVALID_SCOPE;
+		}
+
+		auto it = m_nameIds.find(name);
+		if (it == m_nameIds.end())
+		{
+			it = m_nameIds.emplace(name, static_cast<uint32_t>(m_histories.size())).first;
+			m_histories.emplace_back();
+			m_histories.back().name = name;
+		}
+
+		auto& frame = *m_currentFrame;
+		FrameScope scope{ it->second, frame.queryCount, false };
+		frame.queryCount += 2;
+		frame.scopes.push_back(scope);
+
+		commandBuffer->writeTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope.query);
+		return static_cast<uint32_t>(frame.scopes.size() - 1);
+	}
+
+	void GpuProfiler::endScope(const CommandBufferPtr& commandBuffer, uint32_t scope)
+	{
+		if (scope == INVALID_SCOPE || m_currentFrame == nullptr || scope >= m_currentFrame->scopes.size())
+		{
+			return;
+		}
+
+		auto& frameScope = m_currentFrame->scopes[scope];
+		commandBuffer->writeTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_currentFrame->queryPool,
+			frameScope.query + 1);
+		frameScope.closed = true;
+	}
+
+	void GpuProfiler::collect(Frame& frame)
+	{
+		if (frame.queryCount == 0)
+		{
+			return;
+		}
+
+		//fence已经等待过，结果一定可用；不带WAIT标志，万一没有就绪返回VK_NOT_READY，丢弃这一帧
+		VkResult result = vkGetQueryPoolResults(m_device, frame.queryPool, 0, frame.queryCount,
+			frame.queryCount * sizeof(uint64_t), m_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS)
+		{
+			return;
+		}
+
+		for (const auto& scope : frame.scopes)
+		{
+			if (!scope.closed)
+			{
+				continue;
+			}
+
+			uint64_t begin = m_results[scope.query] & m_timestampMask;
+			uint64_t end = m_results[scope.query + 1] & m_timestampMask;
+			uint64_t ticks = (end - begin) & m_timestampMask;
+
+			auto& history = m_histories[scope.nameId];
+			history.samples[history.next] = static_cast<double>(ticks) * m_timestampPeriod * 1e-6;
+			history.next = (history.next + 1) % WINDOW_SIZE;
+			history.count = std::min(history.count + 1, WINDOW_SIZE);
+		}
+	}
+
+	GpuScopeStats GpuProfiler::summarize(const ScopeHistory& history) const
+	{
+		GpuScopeStats stats{};
+		stats.name = history.name;
+		stats.sampleCount = history.count;
+		if (history.count == 0)
+		{
+			return stats;
+		}
+
+		stats.lastMs = history.samples[(history.next + WINDOW_SIZE - 1) % WINDOW_SIZE];
+		stats.minMs = history.samples[0];
+		stats.maxMs = history.samples[0];
+		double sum = 0.0;
+		for (uint32_t i = 0; i < history.count; i++)
+		{
+			stats.minMs = std::min(stats.minMs, history.samples[i]);
+			stats.maxMs = std::max(stats.maxMs, history.samples[i]);
+			sum += history.samples[i];
+		}
+		stats.avgMs = sum / history.count;
+		return stats;
+	}
+
+	std::vector<GpuScopeStats> GpuProfiler::getStats() const
+	{
+		std::vector<GpuScopeStats> stats;
+		stats.reserve(m_histories.size());
+		for (const auto& history : m_histories)
+		{
+			stats.push_back(summarize(history));
+		}
+		return stats;
+	}
+
+	bool GpuProfiler::getStats(const std::string& name, GpuScopeStats& stats) const
+	{
+		auto it = m_nameIds.find(name);
+		if (it == m_nameIds.end())
+		{
+			return false;
+		}
+
+		stats = summarize(m_histories[it->second]);
+		return true;
+	}
+} // ToyEngine
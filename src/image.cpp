@@ -0,0 +1,469 @@
+#include "image.h"
+#include "logger.h"
+
+namespace ToyEngine
+{
+	FormatBlockInfo getFormatBlockInfo(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_UNORM:
+			return { 1, 1, 1 };
+		case VK_FORMAT_R8G8_UNORM:
+			return { 1, 1, 2 };
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+			return { 1, 1, 4 };
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+			return { 1, 1, 8 };
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return { 1, 1, 16 };
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+			return { 4, 4, 8 };
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+			return { 4, 4, 16 };
+		default:
+			return { 1, 1, 0 };
+		}
+	}
+
+	VkImageAspectFlags getFormatAspect(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_S8_UINT:
+			return VK_IMAGE_ASPECT_STENCIL_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	bool isIntegerFormat(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_UINT:
+		case VK_FORMAT_R8_SINT:
+		case VK_FORMAT_R8G8_UINT:
+		case VK_FORMAT_R8G8_SINT:
+		case VK_FORMAT_R8G8B8_UINT:
+		case VK_FORMAT_R8G8B8_SINT:
+		case VK_FORMAT_B8G8R8_UINT:
+		case VK_FORMAT_B8G8R8_SINT:
+		case VK_FORMAT_R8G8B8A8_UINT:
+		case VK_FORMAT_R8G8B8A8_SINT:
+		case VK_FORMAT_B8G8R8A8_UINT:
+		case VK_FORMAT_B8G8R8A8_SINT:
+		case VK_FORMAT_R16_UINT:
+		case VK_FORMAT_R16_SINT:
+		case VK_FORMAT_R16G16_UINT:
+		case VK_FORMAT_R16G16_SINT:
+		case VK_FORMAT_R16G16B16_UINT:
+		case VK_FORMAT_R16G16B16_SINT:
+		case VK_FORMAT_R16G16B16A16_UINT:
+		case VK_FORMAT_R16G16B16A16_SINT:
+		case VK_FORMAT_R32_UINT:
+		case VK_FORMAT_R32_SINT:
+		case VK_FORMAT_R32G32_UINT:
+		case VK_FORMAT_R32G32_SINT:
+		case VK_FORMAT_R32G32B32_UINT:
+		case VK_FORMAT_R32G32B32_SINT:
+		case VK_FORMAT_R32G32B32A32_UINT:
+		case VK_FORMAT_R32G32B32A32_SINT:
+		case VK_FORMAT_R64_UINT:
+		case VK_FORMAT_R64_SINT:
+		case VK_FORMAT_R64G64_UINT:
+		case VK_FORMAT_R64G64_SINT:
+		case VK_FORMAT_R64G64B64_UINT:
+		case VK_FORMAT_R64G64B64_SINT:
+		case VK_FORMAT_R64G64B64A64_UINT:
+		case VK_FORMAT_R64G64B64A64_SINT:
+		case VK_FORMAT_A8B8G8R8_UINT_PACK32:
+		case VK_FORMAT_A8B8G8R8_SINT_PACK32:
+		case VK_FORMAT_A2R10G10B10_UINT_PACK32:
+		case VK_FORMAT_A2R10G10B10_SINT_PACK32:
+		case VK_FORMAT_A2B10G10R10_UINT_PACK32:
+		case VK_FORMAT_A2B10G10R10_SINT_PACK32:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	VkSampleCountFlagBits clampSampleCount(VkPhysicalDevice physicalDevice, VkSampleCountFlagBits requested)
+	{
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		//多重采样的颜色和深度在同一个renderpass中，采样数必须一致
+		VkSampleCountFlags supported = properties.limits.framebufferColorSampleCounts
+			& properties.limits.framebufferDepthSampleCounts;
+		for (uint32_t count = requested; count > 1; count >>= 1)
+		{
+			if (supported & count)
+			{
+				return static_cast<VkSampleCountFlagBits>(count);
+			}
+		}
+
+		return VK_SAMPLE_COUNT_1_BIT;
+	}
+
+	VkFormat findDepthFormat(VkPhysicalDevice physicalDevice, bool requireStencil)
+	{
+		//D24S8在部分移动GPU上不支持，D32_SFLOAT_S8在部分桌面GPU上不支持，依次尝试
+		const VkFormat depthFormats[] = {
+			VK_FORMAT_D32_SFLOAT,
+			VK_FORMAT_D24_UNORM_S8_UINT,
+			VK_FORMAT_D32_SFLOAT_S8_UINT,
+			VK_FORMAT_D16_UNORM,
+			VK_FORMAT_D16_UNORM_S8_UINT,
+		};
+
+		for (VkFormat format : depthFormats)
+		{
+			if (requireStencil && (getFormatAspect(format) & VK_IMAGE_ASPECT_STENCIL_BIT) == 0)
+			{
+				continue;
+			}
+
+			VkFormatProperties properties{};
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+			if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+			{
+				return format;
+			}
+		}
+
+		throw std::runtime_error("Failed to find a supported depth format.");
+	}
+
+	bool tryFindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties,
+		uint32_t& index)
+	{
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+		{
+			if ((typeFilter & (1 << i)) && ((memProperties.memoryTypes[i].propertyFlags & properties) == properties))
+			{
+				index = i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		uint32_t index = 0;
+		if (!tryFindMemoryTypeIndex(physicalDevice, typeFilter, properties, index))
+		{
+			throw std::runtime_error("Failed to find suitable memory type for image.");
+		}
+
+		return index;
+	}
+
+	ImagePtr Image::create(const VkDevice& device, VkPhysicalDevice const& physicalDevice, const ImageDesc& desc)
+	{
+		return std::make_shared<Image>(device, physicalDevice, desc);
+	}
+
+	ImagePtr Image::createUnbound(const VkDevice& device, VkPhysicalDevice const& physicalDevice, const ImageDesc& desc)
+	{
+		return std::make_shared<Image>(device, physicalDevice, desc, false);
+	}
+
+	Image::Image(const VkDevice& device, VkPhysicalDevice const& physicalDevice, const ImageDesc& desc,
+		bool allocateMemory)
+	{
+		m_device = device;
+		m_physicalDevice = physicalDevice;
+		m_desc = desc;
+
+		uint32_t fullChain = calculateMipLevels(desc.width, desc.height);
+		m_desc.mipLevels = desc.mipLevels == 0 ? fullChain : std::min(desc.mipLevels, fullChain);
+
+		//生成mip时每一级既是blit的源也是目标
+		if (m_desc.mipLevels > 1)
+		{
+			m_desc.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = m_desc.format;
+		imageInfo.extent = { m_desc.width, m_desc.height, 1 };
+		imageInfo.mipLevels = m_desc.mipLevels;
+		imageInfo.arrayLayers = m_desc.arrayLayers;
+		imageInfo.samples = m_desc.samples;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = m_desc.usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(m_device, &imageInfo, nullptr, &m_image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create image.");
+		}
+
+		if (!allocateMemory)
+		{
+			m_ownsMemory = false;
+			return;
+		}
+
+		VkMemoryRequirements memRequirements{};
+		vkGetImageMemoryRequirements(m_device, m_image, &memRequirements);
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex =
+			findMemoryTypeIndex(m_physicalDevice, memRequirements.memoryTypeBits, m_desc.memoryProperties);
+
+		if (vkAllocateMemory(m_device, &allocInfo, nullptr, &m_imageMemory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate image memory.");
+		}
+		m_memorySize = memRequirements.size;
+
+		vkBindImageMemory(m_device, m_image, m_imageMemory, 0);
+		createImageView();
+	}
+
+	VkMemoryRequirements Image::getMemoryRequirements() const
+	{
+		VkMemoryRequirements memRequirements{};
+		vkGetImageMemoryRequirements(m_device, m_image, &memRequirements);
+		return memRequirements;
+	}
+
+	void Image::bindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+	{
+		if (vkBindImageMemory(m_device, m_image, memory, offset) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to bind image memory.");
+		}
+
+		m_memorySize = getMemoryRequirements().size;
+		createImageView();
+	}
+
+	void Image::createImageView()
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_image;
+		viewInfo.viewType = m_desc.viewType;
+		viewInfo.format = m_desc.format;
+		viewInfo.subresourceRange.aspectMask = m_desc.aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = m_desc.mipLevels;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = m_desc.arrayLayers;
+
+		if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_imageView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create image view.");
+		}
+	}
+
+	Image::~Image()
+	{
+		if (m_imageView != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(m_device, m_imageView, nullptr);
+		}
+
+		if (m_image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(m_device, m_image, nullptr);
+		}
+
+		if (m_ownsMemory && m_imageMemory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(m_device, m_imageMemory, nullptr);
+		}
+	}
+
+	uint32_t Image::calculateMipLevels(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		uint32_t size = std::max(width, height);
+		while (size > 1)
+		{
+			size >>= 1;
+			levels++;
+		}
+
+		return levels;
+	}
+
+	VkDeviceSize Image::getLevelSize(uint32_t mipLevel) const
+	{
+		auto block = getFormatBlockInfo(m_desc.format);
+		VkDeviceSize blocksX = (getLevelWidth(mipLevel) + block.blockWidth - 1) / block.blockWidth;
+		VkDeviceSize blocksY = (getLevelHeight(mipLevel) + block.blockHeight - 1) / block.blockHeight;
+		return blocksX * blocksY * block.bytesPerBlock * m_desc.arrayLayers;
+	}
+
+	VkImageMemoryBarrier Image::transition(VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+	{
+		auto barrier = makeBarrier(m_layout, newLayout, srcAccess, dstAccess, 0, m_desc.mipLevels);
+		m_layout = newLayout;
+		return barrier;
+	}
+
+	VkImageMemoryBarrier Image::makeBarrier(VkImageLayout oldLayout,
+		VkImageLayout newLayout,
+		VkAccessFlags srcAccess,
+		VkAccessFlags dstAccess,
+		uint32_t baseMipLevel,
+		uint32_t levelCount) const
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_image;
+		barrier.subresourceRange.aspectMask = m_desc.aspect;
+		barrier.subresourceRange.baseMipLevel = baseMipLevel;
+		barrier.subresourceRange.levelCount = levelCount;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = m_desc.arrayLayers;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		return barrier;
+	}
+
+	void Image::generateMips(const CommandBufferPtr& commandBuffer, const std::vector<ImagePtr>& images)
+	{
+		std::vector<VkFilter> filters(images.size(), VK_FILTER_LINEAR);
+		std::vector<bool> blittable(images.size(), false);
+		uint32_t maxLevels = 1;
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			VkFilter filter = VK_FILTER_LINEAR;
+			blittable[i] = images[i]->getMipLevels() > 1 && images[i]->getBlitFilter(filter);
+			filters[i] = filter;
+			if (images[i]->getMipLevels() > 1 && !blittable[i])
+			{
+				LOG_W("Format {} does not support blit, mips are left as uploaded.", (int)images[i]->getFormat());
+			}
+			if (blittable[i])
+			{
+				maxLevels = std::max(maxLevels, images[i]->getMipLevels());
+			}
+		}
+
+		//第level级从level-1级缩小而来：先把所有图的level-1级转为TRANSFER_SRC，再逐张blit
+		std::vector<VkImageMemoryBarrier> barriers;
+		for (uint32_t level = 1; level < maxLevels; level++)
+		{
+			barriers.clear();
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				if (blittable[i] && level < images[i]->getMipLevels())
+				{
+					barriers.push_back(images[i]->makeBarrier(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						VK_ACCESS_TRANSFER_WRITE_BIT,
+						VK_ACCESS_TRANSFER_READ_BIT,
+						level - 1, 1));
+				}
+			}
+			commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, barriers);
+
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				const auto& image = images[i];
+				if (!blittable[i] || level >= image->getMipLevels())
+				{
+					continue;
+				}
+
+				VkImageBlit blit{};
+				blit.srcSubresource = { image->getAspect(), level - 1, 0, image->getArrayLayers() };
+				blit.srcOffsets[1] = { static_cast<int32_t>(std::max(image->getWidth() >> (level - 1), 1u)),
+									   static_cast<int32_t>(std::max(image->getHeight() >> (level - 1), 1u)), 1 };
+				blit.dstSubresource = { image->getAspect(), level, 0, image->getArrayLayers() };
+				blit.dstOffsets[1] = { static_cast<int32_t>(std::max(image->getWidth() >> level, 1u)),
+									   static_cast<int32_t>(std::max(image->getHeight() >> level, 1u)), 1 };
+
+				commandBuffer->blitImage(image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, { blit }, filters[i]);
+			}
+		}
+
+		//生成过的图：除最后一级外都在TRANSFER_SRC；其余图全部在TRANSFER_DST
+		barriers.clear();
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			const auto& image = images[i];
+			uint32_t levels = image->getMipLevels();
+			if (blittable[i])
+			{
+				barriers.push_back(image->makeBarrier(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+					0, levels - 1));
+				barriers.push_back(image->makeBarrier(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+					levels - 1, 1));
+			}
+			else
+			{
+				barriers.push_back(image->makeBarrier(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+					0, levels));
+			}
+			image->setLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		}
+		commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, barriers);
+	}
+
+	bool Image::getBlitFilter(VkFilter& filter) const
+	{
+		auto features = vkContext.getFormatProperties(m_desc.format).optimalTilingFeatures;
+		if (!(features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) || !(features & VK_FORMAT_FEATURE_BLIT_DST_BIT))
+		{
+			return false;
+		}
+
+		filter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+		return true;
+	}
+} // ToyEngine
@@ -0,0 +1,169 @@
+#include "imageUploader.h"
+#include "commandpool.h"
+#include "logger.h"
+
+namespace ToyEngine
+{
+	ImageUploaderPtr ImageUploader::create(const VkDevice& device, VkPhysicalDevice const& physicalDevice)
+	{
+		return std::make_shared<ImageUploader>(device, physicalDevice);
+	}
+
+	ImageUploader::ImageUploader(const VkDevice& device, VkPhysicalDevice const& physicalDevice)
+	{
+		m_device = device;
+		m_physicalDevice = physicalDevice;
+
+		//16字节覆盖所有非压缩纹素大小和压缩格式的块大小
+		m_offsetAlignment = std::max<VkDeviceSize>(16,
+			vkContext.vk_physicalDeviceProperties.limits.optimalBufferCopyOffsetAlignment);
+	}
+
+	void ImageUploader::enqueue(const ImagePtr& image, const void* data, size_t size, bool generateMips)
+	{
+		append(image, 0, data, size, generateMips && image->getMipLevels() > 1);
+	}
+
+	void ImageUploader::enqueueLevel(const ImagePtr& image, uint32_t mipLevel, const void* data, size_t size)
+	{
+		if (mipLevel >= image->getMipLevels())
+		{
+			throw std::runtime_error("Upload mip level is out of range.");
+		}
+
+		append(image, mipLevel, data, size, false);
+	}
+
+	void ImageUploader::append(const ImagePtr& image, uint32_t mipLevel, const void* data, size_t size, bool generateMips)
+	{
+		VkDeviceSize expected = image->getLevelSize(mipLevel);
+		if (expected != 0 && size < expected)
+		{
+			LOG_E("Upload data for mip {} is {} bytes, expected {}.", mipLevel, size, expected);
+			throw std::runtime_error("Image upload data is too small.");
+		}
+
+		size_t offset = (m_data.size() + m_offsetAlignment - 1) / m_offsetAlignment * m_offsetAlignment;
+		m_data.resize(offset + size);
+		std::memcpy(m_data.data() + offset, data, size);
+
+		m_copies.push_back({ findOrAddImage(image, generateMips), mipLevel, offset });
+	}
+
+	uint32_t ImageUploader::findOrAddImage(const ImagePtr& image, bool generateMips)
+	{
+		for (uint32_t i = 0; i < m_images.size(); i++)
+		{
+			if (m_images[i].image == image)
+			{
+				m_images[i].generateMips = m_images[i].generateMips || generateMips;
+				return i;
+			}
+		}
+
+		m_images.push_back({ image, generateMips });
+		return static_cast<uint32_t>(m_images.size() - 1);
+	}
+
+	BufferPtr ImageUploader::record(const CommandBufferPtr& commandBuffer)
+	{
+		if (m_copies.empty())
+		{
+			return nullptr;
+		}
+
+		auto staging = Buffer::create(m_device, m_physicalDevice, m_data.size(),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		staging->updateBufferByMap(m_data.data(), m_data.size());
+
+		//所有图一次barrier进入TRANSFER_DST，从记录的布局转换，只更新部分mip时其余级别的内容保留
+		std::vector<VkImageMemoryBarrier> barriers;
+		barriers.reserve(m_images.size());
+		VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		for (auto& pending : m_images)
+		{
+			bool wasSampled = pending.image->getLayout() == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			if (wasSampled)
+			{
+				srcStage |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			}
+			barriers.push_back(pending.image->transition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				wasSampled ? VK_ACCESS_SHADER_READ_BIT : 0,
+				VK_ACCESS_TRANSFER_WRITE_BIT));
+		}
+		commandBuffer->pipelineBarrier(srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, barriers);
+
+		//每张图的所有区域合并成一次拷贝
+		std::vector<std::vector<VkBufferImageCopy>> regions(m_images.size());
+		for (const auto& copy : m_copies)
+		{
+			const auto& image = m_images[copy.imageSlot].image;
+
+			VkBufferImageCopy region{};
+			region.bufferOffset = copy.offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = image->getAspect();
+			region.imageSubresource.mipLevel = copy.mipLevel;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = image->getArrayLayers();
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = { image->getLevelWidth(copy.mipLevel), image->getLevelHeight(copy.mipLevel), 1 };
+			regions[copy.imageSlot].push_back(region);
+		}
+
+		for (size_t i = 0; i < m_images.size(); i++)
+		{
+			commandBuffer->copyBufferToImage(staging->getBuffer(), m_images[i].image->getImage(),
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions[i]);
+		}
+
+		//需要生成mip的图由generateMips转换到SHADER_READ_ONLY，其余图在这里一次barrier转换
+		std::vector<ImagePtr> mipImages;
+		std::vector<ImagePtr> plainImages;
+		for (const auto& pending : m_images)
+		{
+			(pending.generateMips ? mipImages : plainImages).push_back(pending.image);
+		}
+
+		Image::generateMips(commandBuffer, mipImages);
+
+		barriers.clear();
+		for (const auto& image : plainImages)
+		{
+			barriers.push_back(image->transition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+		}
+		commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, barriers);
+
+		m_copies.clear();
+		m_images.clear();
+		m_data.clear();
+
+		return staging;
+	}
+
+	void ImageUploader::flush()
+	{
+		if (m_copies.empty())
+		{
+			return;
+		}
+
+		size_t imageCount = m_images.size();
+		size_t bytes = m_data.size();
+
+		auto commandPool = CommandPool::create(m_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+		auto commandBuffer = CommandBuffer::create(m_device, commandPool);
+
+		//staging需要保留到提交完成
+		commandBuffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		auto staging = record(commandBuffer);
+		commandBuffer->end();
+
+		commandBuffer->submitSync(vkContext.vk_graphicsQueue, VK_NULL_HANDLE);
+
+		LOG_I("Uploaded {} images ({} bytes) in one submission.", imageCount, bytes);
+	}
+} // ToyEngine
@@ -0,0 +1,351 @@
+#include "jobSystem.h"
+#include "logger.h"
+#include "cpuProfiler.h"
+
+namespace ToyEngine
+{
+	//找不到任务时先让出这么多次再休眠，避免刚提交的任务要等线程被唤醒
+	static constexpr uint32_t SPIN_COUNT = 64;
+
+	static thread_local const JobSystem* t_owner = nullptr;
+	static thread_local int32_t t_workerIndex = -1;
+
+	//选择窃取对象用的xorshift
+	static uint32_t nextRandom()
+	{
+		thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	WorkStealingDeque::WorkStealingDeque()
+		: m_buffer(CAPACITY)
+	{
+	}
+
+	bool WorkStealingDeque::push(Job* job)
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		int64_t top = m_top.load(std::memory_order_acquire);
+		if (bottom - top >= CAPACITY)
+		{
+			return false;
+		}
+
+		m_buffer[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Job* WorkStealingDeque::pop()
+	{
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			//已经为空
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = m_buffer[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			//最后一个元素，与steal竞争
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				job = nullptr;
+			}
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* WorkStealingDeque::steal()
+	{
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		Job* job = m_buffer[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return job;
+	}
+
+	JobSystemPtr JobSystem::create(uint32_t workerCount)
+	{
+		return std::make_shared<JobSystem>(workerCount);
+	}
+
+	JobSystem& JobSystem::getInstance()
+	{
+		static JobSystem instance([]()
+		{
+		  if (const char* value = std::getenv("TOY2D_WORKERS"))
+		  {
+			  return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		  }
+		  return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}());
+		return instance;
+	}
+
+	JobSystem::JobSystem(uint32_t workerCount)
+	{
+		m_deques.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			m_deques.push_back(std::make_unique<WorkStealingDeque>());
+		}
+
+		//所有队列创建完后再启动线程，工作线程会访问其它线程的队列
+		m_workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		while (m_queued.load(std::memory_order_acquire) > 0)
+		{
+			if (!tryRunOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stop.store(true, std::memory_order_release);
+		}
+		m_sleepCondition.notify_all();
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	void JobSystem::submit(std::function<void()> function, JobCounter* counter)
+	{
+		auto job = new Job{ std::move(function), counter };
+		if (counter != nullptr)
+		{
+			counter->m_value.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		int32_t index = getWorkerIndex();
+		if (index >= 0)
+		{
+			if (!m_deques[index]->push(job))
+			{
+				execute(job);
+				return;
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(m_injectMutex);
+			m_injected.push_back(job);
+			m_injectedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		//与workerLoop中先增加m_sleeping再检查m_queued的顺序配合，两边至少有一边能看到对方
+		m_queued.fetch_add(1, std::memory_order_seq_cst);
+		if (m_sleeping.load(std::memory_order_seq_cst) > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_sleepCondition.notify_one();
+		}
+	}
+
+	void JobSystem::wait(const JobCounter& counter)
+	{
+		while (!counter.isDone())
+		{
+			if (!tryRunOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const RangeFunction& function)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		ParallelForState state(function, std::max(grainSize, 1u));
+		runRange(state, begin, end);
+		wait(state.counter);
+
+		if (state.error)
+		{
+			std::rethrow_exception(state.error);
+		}
+	}
+
+	void JobSystem::workerLoop(uint32_t index)
+	{
+		t_owner = this;
+		t_workerIndex = static_cast<int32_t>(index);
+		TOY_PROFILE_THREAD("worker " + std::to_string(index));
+
+		uint32_t spins = 0;
+		while (true)
+		{
+			if (Job* job = findJob())
+			{
+				execute(job);
+				spins = 0;
+				continue;
+			}
+
+			if (m_stop.load(std::memory_order_acquire))
+			{
+				break;
+			}
+
+			if (++spins < SPIN_COUNT)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+			m_sleepCondition.wait(lock, [this]()
+			{
+			  return m_queued.load(std::memory_order_seq_cst) > 0 || m_stop.load(std::memory_order_acquire);
+			});
+			m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+			spins = 0;
+		}
+
+		t_owner = nullptr;
+		t_workerIndex = -1;
+	}
+
+	int32_t JobSystem::getWorkerIndex() const
+	{
+		return t_owner == this ? t_workerIndex : -1;
+	}
+
+	Job* JobSystem::findJob()
+	{
+		Job* job = nullptr;
+		int32_t index = getWorkerIndex();
+		if (index >= 0)
+		{
+			job = m_deques[index]->pop();
+		}
+
+		if (job == nullptr && m_injectedCount.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_injectMutex);
+			if (!m_injected.empty())
+			{
+				job = m_injected.front();
+				m_injected.pop_front();
+				m_injectedCount.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+		if (job == nullptr && !m_deques.empty())
+		{
+			auto count = static_cast<uint32_t>(m_deques.size());
+			uint32_t first = nextRandom() % count;
+			for (uint32_t i = 0; i < count && job == nullptr; i++)
+			{
+				uint32_t victim = (first + i) % count;
+				if (static_cast<int32_t>(victim) != index)
+				{
+					job = m_deques[victim]->steal();
+				}
+			}
+		}
+
+		if (job != nullptr)
+		{
+			m_queued.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	bool JobSystem::tryRunOne()
+	{
+		Job* job = findJob();
+		if (job == nullptr)
+		{
+			return false;
+		}
+		execute(job);
+		return true;
+	}
+
+	void JobSystem::execute(Job* job)
+	{
+		try
+		{
+			job->function();
+		}
+		catch (const std::exception& e)
+		{
+			LOG_E("Job threw an exception: {}", e.what());
+		}
+		catch (...)
+		{
+			LOG_E("Job threw an unknown exception.");
+		}
+
+		//减一之后等待方可能立即销毁计数器，不能再访问它
+		if (job->counter != nullptr)
+		{
+			job->counter->m_value.fetch_sub(1, std::memory_order_release);
+		}
+		delete job;
+	}
+
+	void JobSystem::runRange(ParallelForState& state, uint32_t begin, uint32_t end)
+	{
+		while (end - begin > state.grainSize)
+		{
+			uint32_t middle = begin + (end - begin) / 2;
+			submit([this, &state, middle, end]()
+			{
+			  runRange(state, middle, end);
+			}, &state.counter);
+			end = middle;
+		}
+
+		try
+		{
+			state.function(begin, end);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(state.errorMutex);
+			if (!state.error)
+			{
+				state.error = std::current_exception();
+			}
+		}
+	}
+
+} // ToyEngine
@@ -0,0 +1,354 @@
+#include "ktx2Loader.h"
+#include "logger.h"
+#include "jobSystem.h"
+#include <filesystem>
+
+namespace ToyEngine
+{
+	static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	static constexpr size_t KTX2_HEADER_SIZE = 80;
+	static constexpr size_t KTX2_LEVEL_INDEX_SIZE = 24;
+
+	template<typename T>
+	static T readValue(const uint8_t* src)
+	{
+		T value;
+		std::memcpy(&value, src, sizeof(T));
+		return value;
+	}
+
+	//可以在CPU上解码的格式，以及解码后对应的RGBA8格式
+	static bool getCpuDecodeFormat(VkFormat format, BlockFormat& blockFormat, VkFormat& decodedFormat)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			blockFormat = BlockFormat::BC1;
+			decodedFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			return true;
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			blockFormat = BlockFormat::BC1;
+			decodedFormat = VK_FORMAT_R8G8B8A8_SRGB;
+			return true;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+			blockFormat = BlockFormat::BC3;
+			decodedFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			return true;
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+			blockFormat = BlockFormat::BC3;
+			decodedFormat = VK_FORMAT_R8G8B8A8_SRGB;
+			return true;
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+			blockFormat = BlockFormat::ETC2_RGB8;
+			decodedFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			return true;
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+			blockFormat = BlockFormat::ETC2_RGB8;
+			decodedFormat = VK_FORMAT_R8G8B8A8_SRGB;
+			return true;
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+			blockFormat = BlockFormat::ETC2_RGBA8;
+			decodedFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			return true;
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+			blockFormat = BlockFormat::ETC2_RGBA8;
+			decodedFormat = VK_FORMAT_R8G8B8A8_SRGB;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	Ktx2FilePtr Ktx2File::open(const std::string& path)
+	{
+		return std::make_shared<Ktx2File>(MappedFile::create(path));
+	}
+
+	Ktx2File::Ktx2File(const MappedFilePtr& file)
+	{
+		m_file = file;
+		const uint8_t* data = file->getData();
+		const size_t size = file->getSize();
+
+		if (size < KTX2_HEADER_SIZE || std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		{
+			throw std::runtime_error("Not a KTX2 file: " + file->getPath());
+		}
+
+		m_format = static_cast<VkFormat>(readValue<uint32_t>(data + 12));
+		m_width = readValue<uint32_t>(data + 20);
+		m_height = std::max(readValue<uint32_t>(data + 24), 1u);
+		uint32_t depth = readValue<uint32_t>(data + 28);
+		m_layerCount = std::max(readValue<uint32_t>(data + 32), 1u);
+		uint32_t faceCount = readValue<uint32_t>(data + 36);
+		m_levelCount = readValue<uint32_t>(data + 40);
+		uint32_t supercompression = readValue<uint32_t>(data + 44);
+
+		if (m_format == VK_FORMAT_UNDEFINED)
+		{
+			throw std::runtime_error("Basis Universal KTX2 files are not supported: " + file->getPath());
+		}
+
+		if (depth > 1 || faceCount != 1 || m_width == 0)
+		{
+			throw std::runtime_error("Only 2D KTX2 textures are supported: " + file->getPath());
+		}
+
+		if (supercompression != 0)
+		{
+			throw std::runtime_error("Supercompressed KTX2 files are not supported: " + file->getPath());
+		}
+
+		//levelCount为0时文件中仍然有一级数据
+		uint32_t storedLevels = std::max(m_levelCount, 1u);
+		if (size < KTX2_HEADER_SIZE + static_cast<uint64_t>(storedLevels) * KTX2_LEVEL_INDEX_SIZE)
+		{
+			throw std::runtime_error("Truncated KTX2 level index: " + file->getPath());
+		}
+
+		m_levels.resize(storedLevels);
+		for (uint32_t level = 0; level < storedLevels; level++)
+		{
+			const uint8_t* entry = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_SIZE;
+			auto offset = readValue<uint64_t>(entry);
+			auto length = readValue<uint64_t>(entry + 8);
+			//分开比较，避免构造的offset + length溢出后通过检查
+			if (offset > size || length > size - offset)
+			{
+				throw std::runtime_error("KTX2 level data is out of range: " + file->getPath());
+			}
+
+			m_levels[level].data = data + offset;
+			m_levels[level].size = static_cast<size_t>(length);
+		}
+	}
+
+	Ktx2FilePtr selectKtx2Variant(const std::string& basePath)
+	{
+		Ktx2FilePtr fallback{ nullptr };
+
+		for (const auto& suffix : TextureLoader::getVariants())
+		{
+			std::string path = basePath + suffix;
+			if (!std::filesystem::exists(path))
+			{
+				continue;
+			}
+
+			Ktx2FilePtr file{ nullptr };
+			try
+			{
+				file = Ktx2File::open(path);
+			}
+			catch (const std::exception& e)
+			{
+				LOG_W("Skip texture variant: {}", e.what());
+				continue;
+			}
+
+			if (vkContext.isFormatSampleable(file->getFormat()))
+			{
+				return file;
+			}
+
+			BlockFormat blockFormat;
+			VkFormat decodedFormat;
+			if (fallback == nullptr && getCpuDecodeFormat(file->getFormat(), blockFormat, decodedFormat))
+			{
+				fallback = file;
+			}
+		}
+
+		if (fallback == nullptr)
+		{
+			LOG_E("No usable texture variant for {}.", basePath);
+		}
+
+		return fallback;
+	}
+
+	bool readKtx2Level(const Ktx2FilePtr& file, uint32_t level, VkFormat& format, std::vector<uint8_t>& out)
+	{
+		const auto& src = file->getLevel(level);
+
+		BlockFormat blockFormat;
+		if (vkContext.isFormatSampleable(file->getFormat())
+			|| !getCpuDecodeFormat(file->getFormat(), blockFormat, format))
+		{
+			//直接拷贝，同时把映射的页读入内存
+			format = file->getFormat();
+			out.assign(src.data, src.data + src.size);
+			return true;
+		}
+
+		uint32_t width = std::max(file->getWidth() >> level, 1u);
+		uint32_t height = std::max(file->getHeight() >> level, 1u);
+		size_t srcLayerSize = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(blockFormat);
+		size_t dstLayerSize = static_cast<size_t>(width) * height * 4;
+
+		if (src.size < srcLayerSize * file->getLayerCount())
+		{
+			LOG_E("Texture {} level {} is truncated.", file->getPath(), level);
+			return false;
+		}
+
+		out.resize(dstLayerSize * file->getLayerCount());
+		for (uint32_t layer = 0; layer < file->getLayerCount(); layer++)
+		{
+			decodeBlocks(blockFormat, src.data + layer * srcLayerSize, width, height, out.data() + layer * dstLayerSize);
+		}
+
+		return true;
+	}
+
+	TextureLoaderPtr TextureLoader::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		const SamplerCachePtr& samplerCache)
+	{
+		return std::make_shared<TextureLoader>(device, physicalDevice, bindlessHeap, samplerCache);
+	}
+
+	TextureLoader::TextureLoader(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		const SamplerCachePtr& samplerCache)
+	{
+		m_device = device;
+		m_physicalDevice = physicalDevice;
+		m_bindlessHeap = bindlessHeap;
+		m_samplerCache = samplerCache;
+	}
+
+	const std::vector<std::string>& TextureLoader::getVariants()
+	{
+		static const std::vector<std::string> variants = {
+			".bc7.ktx2",
+			".astc.ktx2",
+			".etc2.ktx2",
+			".bc3.ktx2",
+			".bc1.ktx2",
+			".ktx2",
+		};
+		return variants;
+	}
+
+	TextureLoader::PreparedTexture TextureLoader::prepare(const std::string& basePath)
+	{
+		PreparedTexture prepared{};
+		auto file = selectKtx2Variant(basePath);
+		if (file == nullptr)
+		{
+			return prepared;
+		}
+
+		prepared.file = file;
+		prepared.format = file->getFormat();
+		if (vkContext.isFormatSampleable(file->getFormat()))
+		{
+			return prepared;
+		}
+
+		//设备不支持任何变体，在当前(工作)线程中逐级解码为RGBA8
+		uint32_t levelCount = std::max(file->getLevelCount(), 1u);
+		prepared.decodedLevels.resize(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			if (!readKtx2Level(file, level, prepared.format, prepared.decodedLevels[level]))
+			{
+				prepared.file = nullptr;
+				return prepared;
+			}
+		}
+
+		LOG_W("Format {} is not supported, {} was decoded on the CPU.", (int)file->getFormat(), file->getPath());
+		return prepared;
+	}
+
+	std::vector<LoadedTexture> TextureLoader::loadBatch(const std::vector<std::string>& basePaths)
+	{
+		//解析和解码在任务系统中进行，Vulkan对象的创建和上传留在调用线程，等待期间调用线程也参与解码
+		std::vector<PreparedTexture> prepared(basePaths.size());
+		JobSystem::getInstance().parallelFor(0, static_cast<uint32_t>(basePaths.size()), 1,
+			[&basePaths, &prepared](uint32_t begin, uint32_t end)
+			{
+			  for (uint32_t i = begin; i < end; i++)
+			  {
+				  prepared[i] = prepare(basePaths[i]);
+			  }
+			});
+
+		auto uploader = ImageUploader::create(m_device, m_physicalDevice);
+		std::vector<LoadedTexture> textures(prepared.size());
+		VkDeviceSize gpuBytes = 0;
+		VkDeviceSize rgbaBytes = 0;
+
+		for (size_t i = 0; i < prepared.size(); i++)
+		{
+			const auto& item = prepared[i];
+			if (item.file == nullptr)
+			{
+				continue;
+			}
+
+			const auto& file = item.file;
+			bool decoded = !item.decodedLevels.empty();
+
+			//文件没有mip链时：非压缩数据由GPU生成，压缩数据无法blit，只保留第0级
+			bool generateMips = file->getLevelCount() == 0 && getFormatBlockInfo(item.format).blockWidth == 1;
+
+			ImageDesc desc{};
+			desc.width = file->getWidth();
+			desc.height = file->getHeight();
+			desc.arrayLayers = file->getLayerCount();
+			desc.format = item.format;
+			desc.mipLevels = generateMips ? 0 : std::max(file->getLevelCount(), 1u);
+			auto image = Image::create(m_device, m_physicalDevice, desc);
+
+			uint32_t levelCount = std::max(file->getLevelCount(), 1u);
+			for (uint32_t level = 0; level < levelCount; level++)
+			{
+				const void* data = decoded ? item.decodedLevels[level].data() : file->getLevel(level).data;
+				size_t size = decoded ? item.decodedLevels[level].size() : file->getLevel(level).size;
+				if (generateMips)
+				{
+					uploader->enqueue(image, data, size, true);
+				}
+				else
+				{
+					uploader->enqueueLevel(image, level, data, size);
+				}
+			}
+
+			textures[i].image = image;
+			textures[i].format = item.format;
+			textures[i].decodedOnCpu = decoded;
+
+			gpuBytes += image->getMemorySize();
+			rgbaBytes += static_cast<VkDeviceSize>(desc.width) * desc.height * 4 * desc.arrayLayers * 4 / 3;
+		}
+
+		uploader->flush();
+
+		VkSampler sampler = m_samplerCache->get(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+		for (auto& texture : textures)
+		{
+			if (texture.image != nullptr)
+			{
+				texture.textureIndex = m_bindlessHeap->registerTexture(texture.image->getImageView(), sampler);
+			}
+		}
+
+		LOG_I("Loaded {} textures: {} KB on GPU, {} KB as mipmapped RGBA8.",
+			basePaths.size(), gpuBytes / 1024, rgbaBytes / 1024);
+
+		return textures;
+	}
+
+	LoadedTexture TextureLoader::load(const std::string& basePath)
+	{
+		return loadBatch({ basePath })[0];
+	}
+} // ToyEngine
@@ -0,0 +1,119 @@
+#include "mappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ToyEngine
+{
+	MappedFilePtr MappedFile::create(const std::string& path)
+	{
+		return std::make_shared<MappedFile>(path);
+	}
+
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path)
+	{
+		m_path = path;
+
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error("Failed to open file: " + path);
+		}
+		m_file = file;
+
+		LARGE_INTEGER size{};
+		GetFileSizeEx(file, &size);
+		m_size = static_cast<size_t>(size.QuadPart);
+		if (m_size == 0)
+		{
+			return;
+		}
+
+		m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping == nullptr)
+		{
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map file: " + path);
+		}
+
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (m_data == nullptr)
+		{
+			CloseHandle(m_mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map file: " + path);
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data != nullptr)
+		{
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping != nullptr)
+		{
+			CloseHandle(m_mapping);
+		}
+		if (m_file != nullptr)
+		{
+			CloseHandle(m_file);
+		}
+	}
+#else
+	MappedFile::MappedFile(const std::string& path)
+	{
+		m_path = path;
+
+		m_file = open(path.c_str(), O_RDONLY);
+		if (m_file < 0)
+		{
+			throw std::runtime_error("Failed to open file: " + path);
+		}
+
+		struct stat info{};
+		if (fstat(m_file, &info) != 0)
+		{
+			close(m_file);
+			throw std::runtime_error("Failed to stat file: " + path);
+		}
+		m_size = static_cast<size_t>(info.st_size);
+		if (m_size == 0)
+		{
+			return;
+		}
+
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+		if (data == MAP_FAILED)
+		{
+			close(m_file);
+			throw std::runtime_error("Failed to map file: " + path);
+		}
+		m_data = static_cast<const uint8_t*>(data);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data != nullptr)
+		{
+			munmap(const_cast<uint8_t*>(m_data), m_size);
+		}
+		if (m_file >= 0)
+		{
+			close(m_file);
+		}
+	}
+#endif
+} // ToyEngine
@@ -1,5 +1,7 @@
 #include "pipeline.h"
 #include "logger.h"
+#include "image.h"
+#include "cpuProfiler.h"
 
 namespace ToyEngine
 {
@@ -17,8 +19,12 @@ namespace ToyEngine
 		m_viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 		m_rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 		m_multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		m_multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 		m_colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 		m_depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		m_depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+		m_depthStencil.minDepthBounds = 0.0f;
+		m_depthStencil.maxDepthBounds = 1.0f;
 		m_layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	}
 
@@ -42,8 +48,10 @@ namespace ToyEngine
 		m_shaders = shaders;
 	}
 
-	void Pipeline::buildPipeline()
+	void Pipeline::buildPipeline(VkPipelineCache cache)
 	{
+		TOY_PROFILE_ZONE("Pipeline::buildPipeline");
+
 		//设置shader
 		std::vector<VkPipelineShaderStageCreateInfo> shaderCreateInfos;
 		for (auto& shader : m_shaders)
@@ -56,6 +64,15 @@ namespace ToyEngine
 			shaderCreateInfos.push_back(shaderCreateInfo);
 		}
 
+		//通过setVertexInput设置的顶点描述优先
+		if (!m_vertexBindings.empty() || !m_vertexAttributes.empty())
+		{
+			m_vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(m_vertexBindings.size());
+			m_vertexInputInfo.pVertexBindingDescriptions = m_vertexBindings.data();
+			m_vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(m_vertexAttributes.size());
+			m_vertexInputInfo.pVertexAttributeDescriptions = m_vertexAttributes.data();
+		}
+
 		//设置视口与剪裁
 		m_viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 		m_viewportState.viewportCount = static_cast<uint32_t>(m_viewports.size());
@@ -67,7 +84,19 @@ namespace ToyEngine
 		m_colorBlending.attachmentCount = static_cast<uint32_t>(m_colorBlendAttachment.size());
 		m_colorBlending.pAttachments = m_colorBlendAttachment.data();
 
-		//layout生成
+		//layout生成，通过set/push constant接口声明的内容优先
+		if (!m_setLayouts.empty())
+		{
+			m_layout.setLayoutCount = static_cast<uint32_t>(m_setLayouts.size());
+			m_layout.pSetLayouts = m_setLayouts.data();
+		}
+
+		if (!m_pushConstantRanges.empty())
+		{
+			m_layout.pushConstantRangeCount = static_cast<uint32_t>(m_pushConstantRanges.size());
+			m_layout.pPushConstantRanges = m_pushConstantRanges.data();
+		}
+
 		if (m_pipelineLayout != VK_NULL_HANDLE)
 		{
 			vkDestroyPipelineLayout(vkContext.vk_device, m_pipelineLayout, nullptr);
@@ -88,10 +117,34 @@ namespace ToyEngine
 		pipelineCreateInfo.pRasterizationState = &m_rasterizer;
 		pipelineCreateInfo.pMultisampleState = &m_multisampling;
 		pipelineCreateInfo.pColorBlendState = &m_colorBlending;
-		pipelineCreateInfo.pDepthStencilState = nullptr;//Todo:add depth stencil
+		//没有深度附件时驱动忽略这个状态
+		pipelineCreateInfo.pDepthStencilState = &m_depthStencil;
 		pipelineCreateInfo.layout = m_pipelineLayout;
-		pipelineCreateInfo.renderPass = m_renderpass->getRenderPass();
 		pipelineCreateInfo.subpass = 0;
+
+		//没有renderpass时走动态渲染，附件格式通过pNext传入
+		VkPipelineRenderingCreateInfoKHR renderingCreateInfo{};
+		if (m_renderpass == nullptr)
+		{
+			if (m_colorFormats.empty())
+			{
+				throw std::runtime_error("Pipeline without renderpass needs rendering formats.");
+			}
+
+			renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+			renderingCreateInfo.colorAttachmentCount = static_cast<uint32_t>(m_colorFormats.size());
+			renderingCreateInfo.pColorAttachmentFormats = m_colorFormats.data();
+			renderingCreateInfo.depthAttachmentFormat = m_depthFormat;
+			//带模板的格式在开始渲染时会同时作为模板附件，格式要对应
+			renderingCreateInfo.stencilAttachmentFormat =
+				(getFormatAspect(m_depthFormat) & VK_IMAGE_ASPECT_STENCIL_BIT) ? m_depthFormat : VK_FORMAT_UNDEFINED;
+			pipelineCreateInfo.pNext = &renderingCreateInfo;
+			pipelineCreateInfo.renderPass = VK_NULL_HANDLE;
+		}
+		else
+		{
+			pipelineCreateInfo.renderPass = m_renderpass->getRenderPass();
+		}
 		//以存在的pipeline为基础进行创建，会更快，但是需要指定flags为VK_PIPELINE_CREATE_DERIVATIVE_BIT
 		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 		pipelineCreateInfo.basePipelineIndex = -1;
@@ -100,7 +153,7 @@ namespace ToyEngine
 		{
 			vkDestroyPipeline(vkContext.vk_device, m_pipeline, nullptr);
 		}
-		if (vkCreateGraphicsPipelines(vkContext.vk_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_pipeline)
+		if (vkCreateGraphicsPipelines(vkContext.vk_device, cache, 1, &pipelineCreateInfo, nullptr, &m_pipeline)
 			!= VK_SUCCESS)
 		{
 			throw std::runtime_error("Failed to create graphics pipeline.");
@@ -111,6 +164,38 @@ namespace ToyEngine
 		}
 	}
 
+	void Pipeline::setVertexInput(const std::vector<VkVertexInputBindingDescription>& bindings,
+		const std::vector<VkVertexInputAttributeDescription>& attributes)
+	{
+		m_vertexBindings = bindings;
+		m_vertexAttributes = attributes;
+	}
+
+	void Pipeline::setSampleCount(VkSampleCountFlagBits samples)
+	{
+		m_multisampling.rasterizationSamples = samples;
+	}
+
+	void Pipeline::setRenderpass(const RenderpassPtr& renderpass)
+	{
+		m_renderpass = renderpass;
+	}
+
+	void Pipeline::setDepthTest(bool testEnable, bool writeEnable, VkCompareOp compareOp)
+	{
+		m_depthStencil.depthTestEnable = testEnable ? VK_TRUE : VK_FALSE;
+		m_depthStencil.depthWriteEnable = writeEnable ? VK_TRUE : VK_FALSE;
+		m_depthStencil.depthCompareOp = compareOp;
+		m_depthStencil.depthBoundsTestEnable = VK_FALSE;
+		m_depthStencil.stencilTestEnable = VK_FALSE;
+	}
+
+	void Pipeline::setRenderingFormats(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat)
+	{
+		m_colorFormats = colorFormats;
+		m_depthFormat = depthFormat;
+	}
+
 	void Pipeline::setViewport(const std::vector<VkViewport>& viewports)
 	{
 		m_viewports = viewports;
@@ -125,4 +210,21 @@ namespace ToyEngine
 	{
 		m_colorBlendAttachment.push_back(attachment);
 	}
+
+	void Pipeline::setDescriptorSetLayouts(const std::vector<VkDescriptorSetLayout>& layouts)
+	{
+		m_setLayouts = layouts;
+	}
+
+	void Pipeline::addPushConstantRange(const VkPushConstantRange& range)
+	{
+		if (range.offset + range.size > MAX_PUSH_CONSTANT_SIZE)
+		{
+			LOG_E("Push constant range [{}, {}) exceeds {} bytes.", range.offset, range.offset + range.size,
+				MAX_PUSH_CONSTANT_SIZE);
+			throw std::runtime_error("Push constant range is too large.");
+		}
+
+		m_pushConstantRanges.push_back(range);
+	}
 } // ToyEngine
\ No newline at end of file
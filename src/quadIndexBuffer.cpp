@@ -0,0 +1,53 @@
+#include "quadIndexBuffer.h"
+
+namespace ToyEngine
+{
+	QuadIndexBufferPtr QuadIndexBuffer::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		uint32_t maxQuads)
+	{
+		return std::make_shared<QuadIndexBuffer>(device, physicalDevice, maxQuads);
+	}
+
+	QuadIndexBuffer::QuadIndexBuffer(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		uint32_t maxQuads)
+	{
+		if (maxQuads == 0 || maxQuads > MAX_QUADS)
+		{
+			throw std::runtime_error("Quad index buffer size is out of range.");
+		}
+
+		m_maxQuads = maxQuads;
+		const uint32_t indexCount = maxQuads * INDICES_PER_QUAD;
+
+		std::vector<uint8_t> indices;
+		if (maxQuads <= MAX_QUADS_UINT16)
+		{
+			m_indexType = VK_INDEX_TYPE_UINT16;
+			indices.resize(indexCount * sizeof(uint16_t));
+			fillIndices(reinterpret_cast<uint16_t*>(indices.data()), maxQuads);
+		}
+		else
+		{
+			m_indexType = VK_INDEX_TYPE_UINT32;
+			indices.resize(indexCount * sizeof(uint32_t));
+			fillIndices(reinterpret_cast<uint32_t*>(indices.data()), maxQuads);
+		}
+
+		m_buffer = Buffer::create(device, physicalDevice, indices.size(),
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		m_buffer->updateBufferByStage(indices.data(), indices.size());
+	}
+
+	QuadIndexBuffer::~QuadIndexBuffer()
+	{
+		m_buffer.reset();
+	}
+
+	void QuadIndexBuffer::bind(const CommandBufferPtr& commandBuffer) const
+	{
+		commandBuffer->bindIndexBuffer(m_buffer->getBuffer(), 0, m_indexType);
+	}
+} // ToyEngine
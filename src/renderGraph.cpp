@@ -0,0 +1,1066 @@
+#include "renderGraph.h"
+#include "logger.h"
+#include "tool.h"
+#include <algorithm>
+
+namespace ToyEngine
+{
+	static VkAttachmentLoadOp toVkLoadOp(RGLoadOp loadOp)
+	{
+		switch (loadOp)
+		{
+		case RGLoadOp::Clear:
+			return VK_ATTACHMENT_LOAD_OP_CLEAR;
+		case RGLoadOp::DontCare:
+			return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		default:
+			return VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+	}
+
+	static VkImageMemoryBarrier makeImageBarrier(VkImage image, VkImageAspectFlags aspect,
+		VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = aspect;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		return barrier;
+	}
+
+	RenderGraphPass::RenderGraphPass(const std::string& name, uint32_t index)
+	{
+		m_name = name;
+		m_index = index;
+	}
+
+	void RenderGraphPass::addColorOutput(RGResource resource, RGLoadOp loadOp, const VkClearColorValue& clearColor,
+		RGResource resolveTarget)
+	{
+		m_colorOutputs.push_back({ resource, loadOp, clearColor, resolveTarget });
+		m_accesses.push_back({ resource, Usage::ColorAttachment });
+		if (resolveTarget != RG_INVALID_RESOURCE)
+		{
+			m_accesses.push_back({ resolveTarget, Usage::ResolveAttachment });
+		}
+	}
+
+	void RenderGraphPass::setDepthOutput(RGResource resource, RGLoadOp loadOp, float clearDepth)
+	{
+		if (m_depthOutput.resource != RG_INVALID_RESOURCE)
+		{
+			throw std::runtime_error("Pass " + m_name + " already has a depth output.");
+		}
+
+		m_depthOutput.resource = resource;
+		m_depthOutput.loadOp = loadOp;
+		m_depthOutput.clearDepth = clearDepth;
+		m_accesses.push_back({ resource, Usage::DepthAttachment });
+	}
+
+	void RenderGraphPass::addTextureInput(RGResource resource)
+	{
+		m_accesses.push_back({ resource, Usage::Sampled });
+	}
+
+	void RenderGraphPass::addTransferInput(RGResource resource)
+	{
+		m_accesses.push_back({ resource, Usage::TransferSrc });
+	}
+
+	void RenderGraphPass::addTransferOutput(RGResource resource)
+	{
+		m_accesses.push_back({ resource, Usage::TransferDst });
+	}
+
+	RenderGraphPtr RenderGraph::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const RenderpassCachePtr& renderpassCache,
+		const FramebufferCachePtr& framebufferCache,
+		uint32_t framesInFlight)
+	{
+		return std::make_shared<RenderGraph>(device, physicalDevice, renderpassCache, framebufferCache,
+			framesInFlight);
+	}
+
+	RenderGraph::RenderGraph(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const RenderpassCachePtr& renderpassCache,
+		const FramebufferCachePtr& framebufferCache,
+		uint32_t framesInFlight)
+	{
+		m_device = device;
+		m_physicalDevice = physicalDevice;
+		m_renderpassCache = renderpassCache;
+		m_framebufferCache = framebufferCache;
+		m_framesInFlight = framesInFlight;
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		for (auto& retired : m_retired)
+		{
+			destroyRetired(retired);
+		}
+		m_retired.clear();
+
+		releasePhysical(true);
+	}
+
+	void RenderGraph::reset()
+	{
+		for (size_t i = 0; i < m_retired.size();)
+		{
+			if (--m_retired[i].framesLeft == 0)
+			{
+				destroyRetired(m_retired[i]);
+				m_retired[i] = std::move(m_retired.back());
+				m_retired.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		m_passes.clear();
+		m_resources.clear();
+		m_finalBarriers.clear();
+		m_finalSrcStages = 0;
+		m_compiled = false;
+	}
+
+	RGResource RenderGraph::importImage(const std::string& name, VkImage image, VkImageView imageView,
+		VkFormat format, VkExtent2D extent,
+		VkImageLayout initialLayout, VkPipelineStageFlags initialStage,
+		VkImageLayout finalLayout)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.imported = true;
+		resource.image = image;
+		resource.imageView = imageView;
+		resource.desc.width = extent.width;
+		resource.desc.height = extent.height;
+		resource.desc.format = format;
+		resource.aspect = getFormatAspect(format);
+		resource.initialLayout = initialLayout;
+		resource.initialStage = initialStage == 0
+			? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) : initialStage;
+		resource.finalLayout = finalLayout;
+
+		m_resources.push_back(resource);
+		return static_cast<RGResource>(m_resources.size() - 1);
+	}
+
+	RGResource RenderGraph::createTexture(const std::string& name, const RGTextureDesc& desc)
+	{
+		if (desc.width == 0 || desc.height == 0)
+		{
+			throw std::runtime_error("Render graph texture " + name + " has zero extent.");
+		}
+
+		Resource resource{};
+		resource.name = name;
+		resource.desc = desc;
+		resource.aspect = getFormatAspect(desc.format);
+
+		m_resources.push_back(resource);
+		return static_cast<RGResource>(m_resources.size() - 1);
+	}
+
+	RenderGraphPass& RenderGraph::addPass(const std::string& name)
+	{
+		m_passes.push_back(std::make_unique<RenderGraphPass>(name, static_cast<uint32_t>(m_passes.size())));
+		return *m_passes.back();
+	}
+
+	void RenderGraph::compile()
+	{
+		for (const auto& pass : m_passes)
+		{
+			for (const auto& access : pass->m_accesses)
+			{
+				if (access.resource >= m_resources.size())
+				{
+					throw std::runtime_error("Pass " + pass->m_name + " uses an invalid render graph resource.");
+				}
+			}
+		}
+
+		cullPasses();
+		computeLifetimes();
+		allocateTransients();
+		buildBarriers();
+		buildRenderPasses();
+
+		m_stats.passCount = static_cast<uint32_t>(m_passes.size());
+		m_stats.culledPassCount = 0;
+		for (const auto& pass : m_passes)
+		{
+			if (pass->m_culled)
+			{
+				m_stats.culledPassCount++;
+			}
+		}
+
+		m_compiled = true;
+	}
+
+	void RenderGraph::cullPasses()
+	{
+		//导入资源是图的输出，自带一个引用
+		for (auto& resource : m_resources)
+		{
+			resource.refCount = resource.imported ? 1 : 0;
+			resource.writers.clear();
+		}
+
+		for (auto& pass : m_passes)
+		{
+			pass->m_culled = false;
+			pass->m_refCount = pass->m_sideEffect ? 1 : 0;
+
+			for (const auto& access : pass->m_accesses)
+			{
+				auto& resource = m_resources[access.resource];
+				if (RenderGraphPass::isWrite(access.usage))
+				{
+					pass->m_refCount++;
+					resource.writers.push_back(pass->m_index);
+				}
+				else
+				{
+					resource.refCount++;
+				}
+			}
+		}
+
+		std::vector<RGResource> unreferenced;
+		auto cull = [&](RenderGraphPass& pass) {
+			pass.m_culled = true;
+			for (const auto& access : pass.m_accesses)
+			{
+				if (RenderGraphPass::isWrite(access.usage))
+				{
+					continue;
+				}
+
+				auto& input = m_resources[access.resource];
+				if (input.refCount > 0 && --input.refCount == 0)
+				{
+					unreferenced.push_back(access.resource);
+				}
+			}
+		};
+
+		for (RGResource i = 0; i < m_resources.size(); i++)
+		{
+			if (m_resources[i].refCount == 0)
+			{
+				unreferenced.push_back(i);
+			}
+		}
+
+		//既没有输出也没有副作用的pass直接剔除
+		for (auto& pass : m_passes)
+		{
+			if (pass->m_refCount == 0)
+			{
+				cull(*pass);
+			}
+		}
+
+		//没有人读的资源，它的写入者少一个引用；写入者所有输出都没人读时被剔除，它读的资源随之少一个引用
+		while (!unreferenced.empty())
+		{
+			RGResource index = unreferenced.back();
+			unreferenced.pop_back();
+
+			for (uint32_t writer : m_resources[index].writers)
+			{
+				auto& pass = m_passes[writer];
+				if (!pass->m_culled && pass->m_refCount > 0 && --pass->m_refCount == 0)
+				{
+					cull(*pass);
+				}
+			}
+		}
+	}
+
+	void RenderGraph::computeLifetimes()
+	{
+		for (auto& resource : m_resources)
+		{
+			resource.firstPass = UINT32_MAX;
+			resource.lastPass = 0;
+			resource.usage = 0;
+		}
+
+		for (const auto& pass : m_passes)
+		{
+			if (pass->m_culled)
+			{
+				continue;
+			}
+
+			for (const auto& access : pass->m_accesses)
+			{
+				auto& resource = m_resources[access.resource];
+				resource.firstPass = std::min(resource.firstPass, pass->m_index);
+				resource.lastPass = std::max(resource.lastPass, pass->m_index);
+				resource.usage |= getImageUsage(access.usage);
+			}
+		}
+
+		//只作为附件使用的临时纹理才能使用lazily allocated内存
+		const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+			| VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		for (auto& resource : m_resources)
+		{
+			resource.lazy = !resource.imported && resource.desc.transient && (resource.usage & ~attachmentUsage) == 0;
+		}
+	}
+
+	void RenderGraph::allocateTransients()
+	{
+		//按首次使用排序的临时纹理
+		std::vector<RGResource> transients;
+		for (RGResource i = 0; i < m_resources.size(); i++)
+		{
+			const auto& resource = m_resources[i];
+			if (!resource.imported && resource.firstPass != UINT32_MAX)
+			{
+				transients.push_back(i);
+			}
+		}
+		std::stable_sort(transients.begin(), transients.end(), [this](RGResource a, RGResource b) {
+			return m_resources[a].firstPass < m_resources[b].firstPass;
+		});
+
+		uint64_t key = 0;
+		hashCombine(key, transients.size());
+		for (RGResource index : transients)
+		{
+			const auto& resource = m_resources[index];
+			hashCombine(key, resource.desc.width);
+			hashCombine(key, resource.desc.height);
+			hashCombine(key, resource.desc.format);
+			hashCombine(key, resource.desc.samples);
+			hashCombine(key, resource.usage);
+			hashCombine(key, resource.lazy);
+			hashCombine(key, resource.firstPass);
+			hashCombine(key, resource.lastPass);
+		}
+
+		if (key != m_physicalKey || m_physicalImages.size() != transients.size())
+		{
+			releasePhysical(false);
+			m_stats.lazyCount = 0;
+
+			for (RGResource index : transients)
+			{
+				const auto& resource = m_resources[index];
+
+				ImageDesc desc{};
+				desc.width = resource.desc.width;
+				desc.height = resource.desc.height;
+				desc.format = resource.desc.format;
+				desc.samples = resource.desc.samples;
+				desc.usage = resource.usage;
+				desc.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				desc.aspect = resource.aspect;
+				if (resource.lazy)
+				{
+					desc.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+				}
+				else if (resource.desc.transient)
+				{
+					LOG_W("Transient texture {} is sampled or copied, using regular device memory.", resource.name);
+				}
+
+				auto image = Image::createUnbound(m_device, m_physicalDevice, desc);
+				auto requirement = image->getMemoryRequirements();
+
+				//桌面GPU一般没有lazily allocated内存，退回普通显存，仍然可以别名
+				VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+				uint32_t memoryType = 0;
+				if (resource.lazy && tryFindMemoryTypeIndex(m_physicalDevice, requirement.memoryTypeBits,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, memoryType))
+				{
+					properties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+					m_stats.lazyCount++;
+				}
+
+				//首次适配：上一个使用者已经结束、内存属性相同且类型兼容的块
+				uint32_t block = UINT32_MAX;
+				for (uint32_t b = 0; b < m_blocks.size(); b++)
+				{
+					if (m_blocks[b].lastPass < resource.firstPass
+						&& m_blocks[b].memoryProperties == properties
+						&& tryFindMemoryTypeIndex(m_physicalDevice,
+							m_blocks[b].memoryTypeBits & requirement.memoryTypeBits, properties, memoryType))
+					{
+						block = b;
+						break;
+					}
+				}
+
+				if (block == UINT32_MAX)
+				{
+					MemoryBlock newBlock{};
+					newBlock.memoryTypeBits = requirement.memoryTypeBits;
+					newBlock.memoryProperties = properties;
+					m_blocks.push_back(newBlock);
+					block = static_cast<uint32_t>(m_blocks.size() - 1);
+				}
+
+				auto& memoryBlock = m_blocks[block];
+				memoryBlock.size = std::max(memoryBlock.size, requirement.size);
+				memoryBlock.alignment = std::max(memoryBlock.alignment, requirement.alignment);
+				memoryBlock.memoryTypeBits &= requirement.memoryTypeBits;
+				memoryBlock.lastPass = resource.lastPass;
+
+				m_physicalImages.push_back(image);
+				m_physicalBlocks.push_back(block);
+			}
+
+			for (auto& block : m_blocks)
+			{
+				VkMemoryAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+				allocInfo.allocationSize = block.size;
+				allocInfo.memoryTypeIndex = findMemoryTypeIndex(m_physicalDevice, block.memoryTypeBits,
+					block.memoryProperties);
+
+				if (vkAllocateMemory(m_device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed to allocate render graph memory.");
+				}
+			}
+
+			for (size_t i = 0; i < m_physicalImages.size(); i++)
+			{
+				m_physicalImages[i]->bindMemory(m_blocks[m_physicalBlocks[i]].memory, 0);
+			}
+
+			m_physicalKey = key;
+
+			m_stats.transientCount = static_cast<uint32_t>(m_physicalImages.size());
+			m_stats.transientBytes = 0;
+			m_stats.allocatedBytes = 0;
+			for (const auto& image : m_physicalImages)
+			{
+				m_stats.transientBytes += image->getMemorySize();
+			}
+			for (const auto& block : m_blocks)
+			{
+				m_stats.allocatedBytes += block.size;
+			}
+
+			if (!m_physicalImages.empty())
+			{
+				LOG_I("Render graph allocated {} transient images ({} lazy) in {} blocks: {} KB ({} KB without aliasing).",
+					m_stats.transientCount, m_stats.lazyCount, m_blocks.size(),
+					m_stats.allocatedBytes / 1024, m_stats.transientBytes / 1024);
+			}
+		}
+
+		for (size_t i = 0; i < transients.size(); i++)
+		{
+			auto& resource = m_resources[transients[i]];
+			resource.image = m_physicalImages[i]->getImage();
+			resource.imageView = m_physicalImages[i]->getImageView();
+			resource.block = m_physicalBlocks[i];
+		}
+	}
+
+	void RenderGraph::buildBarriers()
+	{
+		for (auto& resource : m_resources)
+		{
+			resource.state = {};
+			if (resource.imported)
+			{
+				resource.state.layout = resource.initialLayout;
+				resource.state.writeStages = resource.initialStage;
+				resource.state.hasContent = resource.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+
+		m_stats.barrierCount = 0;
+		m_stats.imageBarrierCount = 0;
+
+		for (auto& pass : m_passes)
+		{
+			pass->m_barriers.clear();
+			pass->m_srcStages = 0;
+			pass->m_dstStages = 0;
+
+			if (pass->m_culled)
+			{
+				continue;
+			}
+
+			for (const auto& access : pass->m_accesses)
+			{
+				auto& resource = m_resources[access.resource];
+				auto& state = resource.state;
+				const auto info = getUsageInfo(access.usage);
+				const bool write = RenderGraphPass::isWrite(access.usage);
+
+				//临时纹理的内容每帧都是未定义的，但要等同一块内存上一个使用者(本帧更早的pass或上一帧)结束，并让它的写入可用(写后写)
+				if (!resource.imported && resource.firstPass == pass->m_index && state.writeStages == 0)
+				{
+					state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+					state.writeStages = m_blocks[resource.block].lastStages;
+					state.writeAccess = m_blocks[resource.block].lastAccess;
+				}
+
+				//附件的load/store：没有内容可读时LOAD等价于DONT_CARE；导入资源是图的输出，临时纹理之后没人使用时不写回
+				bool discard = false;
+				auto deriveOps = [&](RGLoadOp loadOp, VkAttachmentLoadOp& vkLoadOp, VkAttachmentStoreOp& vkStoreOp) {
+					if (loadOp == RGLoadOp::Load && !state.hasContent)
+					{
+						loadOp = RGLoadOp::DontCare;
+					}
+					vkLoadOp = toVkLoadOp(loadOp);
+					vkStoreOp = resource.imported || resource.lastPass > pass->m_index
+								? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					discard = loadOp != RGLoadOp::Load;
+				};
+
+				if (access.usage == RenderGraphPass::Usage::ColorAttachment)
+				{
+					for (auto& output : pass->m_colorOutputs)
+					{
+						if (output.resource == access.resource)
+						{
+							deriveOps(output.loadOp, output.vkLoadOp, output.vkStoreOp);
+						}
+					}
+				}
+				else if (access.usage == RenderGraphPass::Usage::ResolveAttachment)
+				{
+					//resolve覆盖整张图，旧内容总是可以丢弃
+					for (auto& output : pass->m_colorOutputs)
+					{
+						if (output.resolve == access.resource)
+						{
+							VkAttachmentLoadOp unused{};
+							deriveOps(RGLoadOp::DontCare, unused, output.vkResolveStoreOp);
+						}
+					}
+				}
+				else if (access.usage == RenderGraphPass::Usage::DepthAttachment)
+				{
+					auto& output = pass->m_depthOutput;
+					deriveOps(output.loadOp, output.vkLoadOp, output.vkStoreOp);
+				}
+
+				if (write)
+				{
+					state.hasContent = true;
+				}
+
+				if (state.layout != info.layout)
+				{
+					//旧内容不需要保留时从UNDEFINED转换，驱动可以跳过解压/保留
+					pass->m_barriers.push_back(makeImageBarrier(resource.image, resource.aspect,
+						discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout, info.layout, state.writeAccess, info.access));
+					pass->m_srcStages |= state.writeStages | state.readStages;
+					pass->m_dstStages |= info.stage;
+
+					//布局转换本身也是一次写入
+					state.layout = info.layout;
+					state.writeStages = info.stage;
+					state.writeAccess = write ? info.access : 0;
+					state.visibleStages = info.stage;
+					state.readStages = write ? 0 : info.stage;
+				}
+				else if (write)
+				{
+					//写后写、读后写
+					if ((state.writeStages | state.readStages) != 0)
+					{
+						pass->m_barriers.push_back(makeImageBarrier(resource.image, resource.aspect,
+							state.layout, info.layout, state.writeAccess, info.access));
+						pass->m_srcStages |= state.writeStages | state.readStages;
+						pass->m_dstStages |= info.stage;
+					}
+
+					state.writeStages = info.stage;
+					state.writeAccess = info.access;
+					state.visibleStages = info.stage;
+					state.readStages = 0;
+				}
+				else
+				{
+					//写后读，已经对这个阶段可见时不需要重复
+					if ((info.stage & ~state.visibleStages) != 0 && state.writeStages != 0)
+					{
+						pass->m_barriers.push_back(makeImageBarrier(resource.image, resource.aspect,
+							state.layout, info.layout, state.writeAccess, info.access));
+						pass->m_srcStages |= state.writeStages;
+						pass->m_dstStages |= info.stage;
+						state.visibleStages |= info.stage;
+					}
+
+					state.readStages |= info.stage;
+				}
+			}
+
+			for (const auto& access : pass->m_accesses)
+			{
+				const auto& resource = m_resources[access.resource];
+				if (!resource.imported && resource.lastPass == pass->m_index)
+				{
+					m_blocks[resource.block].lastStages = resource.state.writeStages | resource.state.readStages;
+					m_blocks[resource.block].lastAccess = resource.state.writeAccess;
+				}
+			}
+
+			if (!pass->m_barriers.empty())
+			{
+				m_stats.barrierCount++;
+				m_stats.imageBarrierCount += static_cast<uint32_t>(pass->m_barriers.size());
+			}
+		}
+
+		for (auto& resource : m_resources)
+		{
+			if (!resource.imported || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED
+				|| resource.finalLayout == resource.state.layout)
+			{
+				continue;
+			}
+
+			m_finalBarriers.push_back(makeImageBarrier(resource.image, resource.aspect,
+				resource.state.layout, resource.finalLayout, resource.state.writeAccess, 0));
+			m_finalSrcStages |= resource.state.writeStages | resource.state.readStages;
+		}
+
+		if (!m_finalBarriers.empty())
+		{
+			m_stats.barrierCount++;
+			m_stats.imageBarrierCount += static_cast<uint32_t>(m_finalBarriers.size());
+		}
+	}
+
+	void RenderGraph::buildRenderPasses()
+	{
+		for (auto& pass : m_passes)
+		{
+			pass->m_renderPass = VK_NULL_HANDLE;
+			pass->m_framebuffer = VK_NULL_HANDLE;
+
+			if (pass->m_culled || !pass->isRaster())
+			{
+				continue;
+			}
+
+			//framebuffer中颜色附件在前，然后是resolve目标，深度附件在最后，与RenderpassCache的约定一致
+			std::vector<RGResource> attachments;
+			for (const auto& output : pass->m_colorOutputs)
+			{
+				attachments.push_back(output.resource);
+			}
+			for (const auto& output : pass->m_colorOutputs)
+			{
+				if (output.resolve == RG_INVALID_RESOURCE)
+				{
+					continue;
+				}
+
+				if (m_resources[output.resource].desc.samples == VK_SAMPLE_COUNT_1_BIT
+					|| m_resources[output.resolve].desc.samples != VK_SAMPLE_COUNT_1_BIT)
+				{
+					throw std::runtime_error("Pass " + pass->m_name + " resolves from a single-sampled "
+											 "or into a multisampled texture.");
+				}
+				attachments.push_back(output.resolve);
+			}
+
+			//同一个子流程的附件采样数必须一致
+			const VkSampleCountFlagBits samples = m_resources[attachments.front()].desc.samples;
+			for (const auto& output : pass->m_colorOutputs)
+			{
+				if (m_resources[output.resource].desc.samples != samples)
+				{
+					throw std::runtime_error("Color outputs of pass " + pass->m_name + " have different sample counts.");
+				}
+			}
+			if (pass->m_depthOutput.resource != RG_INVALID_RESOURCE
+				&& m_resources[pass->m_depthOutput.resource].desc.samples != samples)
+			{
+				throw std::runtime_error("Depth output of pass " + pass->m_name + " has a different sample count.");
+			}
+			if (pass->m_depthOutput.resource != RG_INVALID_RESOURCE)
+			{
+				attachments.push_back(pass->m_depthOutput.resource);
+			}
+
+			const auto& first = m_resources[attachments.front()].desc;
+			pass->m_extent = { first.width, first.height };
+
+			std::vector<VkImageView> views;
+			for (RGResource attachment : attachments)
+			{
+				const auto& resource = m_resources[attachment];
+				if (resource.desc.width != first.width || resource.desc.height != first.height)
+				{
+					throw std::runtime_error("Attachments of pass " + pass->m_name + " have different extents.");
+				}
+				views.push_back(resource.imageView);
+			}
+
+			if (m_dynamicRendering)
+			{
+				continue;
+			}
+
+			pass->m_renderPass = getRenderPass(*pass);
+			pass->m_framebuffer = m_framebufferCache->get(pass->m_renderPass, views, pass->m_extent);
+		}
+	}
+
+	VkRenderPass RenderGraph::getRenderPass(const RenderGraphPass& pass)
+	{
+		//布局转换都由图的barrier完成，renderpass内部不再转换
+		RenderpassDesc desc{};
+		for (const auto& output : pass.m_colorOutputs)
+		{
+			const auto& textureDesc = m_resources[output.resource].desc;
+
+			VkAttachmentDescription attachmentDes{};
+			attachmentDes.format = textureDesc.format;
+			attachmentDes.samples = textureDesc.samples;
+			attachmentDes.loadOp = output.vkLoadOp;
+			attachmentDes.storeOp = output.vkStoreOp;
+			attachmentDes.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachmentDes.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachmentDes.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachmentDes.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			desc.colorAttachments.push_back(attachmentDes);
+		}
+
+		const bool hasResolve = std::any_of(pass.m_colorOutputs.begin(), pass.m_colorOutputs.end(),
+			[](const RenderGraphPass::ColorOutput& output) {
+				return output.resolve != RG_INVALID_RESOURCE;
+			});
+		for (const auto& output : pass.m_colorOutputs)
+		{
+			if (!hasResolve)
+			{
+				break;
+			}
+
+			//不resolve的颜色附件在对应位置放一个UNDEFINED格式的占位
+			VkAttachmentDescription attachmentDes{};
+			attachmentDes.format = VK_FORMAT_UNDEFINED;
+			if (output.resolve != RG_INVALID_RESOURCE)
+			{
+				attachmentDes.format = m_resources[output.resolve].desc.format;
+				attachmentDes.samples = VK_SAMPLE_COUNT_1_BIT;
+				attachmentDes.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				attachmentDes.storeOp = output.vkResolveStoreOp;
+				attachmentDes.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				attachmentDes.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				attachmentDes.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				attachmentDes.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			}
+			desc.resolveAttachments.push_back(attachmentDes);
+		}
+
+		if (pass.m_depthOutput.resource != RG_INVALID_RESOURCE)
+		{
+			const auto& output = pass.m_depthOutput;
+			const auto& textureDesc = m_resources[output.resource].desc;
+
+			//不使用模板，模板部分和深度一起清除或丢弃
+			VkAttachmentDescription attachmentDes{};
+			attachmentDes.format = textureDesc.format;
+			attachmentDes.samples = textureDesc.samples;
+			attachmentDes.loadOp = output.vkLoadOp;
+			attachmentDes.storeOp = output.vkStoreOp;
+			attachmentDes.stencilLoadOp = output.vkLoadOp == VK_ATTACHMENT_LOAD_OP_LOAD
+										  ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachmentDes.stencilStoreOp = output.vkStoreOp;
+			attachmentDes.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			attachmentDes.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			desc.depthAttachment = attachmentDes;
+		}
+
+		return m_renderpassCache->get(desc)->getRenderPass();
+	}
+
+	void RenderGraph::execute(const CommandBufferPtr& commandBuffer)
+	{
+		if (!m_compiled)
+		{
+			throw std::runtime_error("Render graph must be compiled before execute.");
+		}
+
+		std::vector<VkClearValue> clearValues;
+		for (const auto& pass : m_passes)
+		{
+			if (pass->m_culled)
+			{
+				continue;
+			}
+
+			GpuScope scope(m_profiler, commandBuffer, pass->m_name);
+
+			commandBuffer->pipelineBarrier(
+				pass->m_srcStages == 0 ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) : pass->m_srcStages,
+				pass->m_dstStages, pass->m_barriers);
+
+			if (!pass->isRaster())
+			{
+				if (pass->m_execute)
+				{
+					pass->m_execute(commandBuffer);
+				}
+				continue;
+			}
+
+			if (m_dynamicRendering)
+			{
+				executeDynamic(*pass, commandBuffer);
+				continue;
+			}
+
+			clearValues.clear();
+			for (const auto& output : pass->m_colorOutputs)
+			{
+				VkClearValue clearValue{};
+				clearValue.color = output.clearColor;
+				clearValues.push_back(clearValue);
+			}
+			//clear value按附件下标索引，resolve附件的值不会被使用
+			for (const auto& output : pass->m_colorOutputs)
+			{
+				if (output.resolve != RG_INVALID_RESOURCE)
+				{
+					clearValues.push_back({});
+				}
+			}
+			if (pass->m_depthOutput.resource != RG_INVALID_RESOURCE)
+			{
+				VkClearValue clearValue{};
+				clearValue.depthStencil = { pass->m_depthOutput.clearDepth, 0 };
+				clearValues.push_back(clearValue);
+			}
+
+			VkRenderPassBeginInfo renderPassInfo{};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassInfo.renderPass = pass->m_renderPass;
+			renderPassInfo.framebuffer = pass->m_framebuffer;
+			renderPassInfo.renderArea.offset = { 0, 0 };
+			renderPassInfo.renderArea.extent = pass->m_extent;
+			renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+			renderPassInfo.pClearValues = clearValues.data();
+
+			commandBuffer->beginRenderPass(renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			if (pass->m_execute)
+			{
+				pass->m_execute(commandBuffer);
+			}
+			commandBuffer->endRenderPass();
+		}
+
+		commandBuffer->pipelineBarrier(
+			m_finalSrcStages == 0 ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) : m_finalSrcStages,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_finalBarriers);
+	}
+
+	void RenderGraph::executeDynamic(const RenderGraphPass& pass, const CommandBufferPtr& commandBuffer)
+	{
+		//布局在pass之前已经由barrier转换好，load/store与renderpass路径推导的结果相同
+		std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+		colorAttachments.reserve(pass.m_colorOutputs.size());
+		for (const auto& output : pass.m_colorOutputs)
+		{
+			VkRenderingAttachmentInfoKHR attachment{};
+			attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+			attachment.imageView = m_resources[output.resource].imageView;
+			attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+			attachment.loadOp = output.vkLoadOp;
+			attachment.storeOp = output.vkStoreOp;
+			attachment.clearValue.color = output.clearColor;
+
+			//浮点/归一化格式取平均，整数格式不支持AVERAGE，取第0个采样
+			if (output.resolve != RG_INVALID_RESOURCE)
+			{
+				attachment.resolveMode = isIntegerFormat(m_resources[output.resource].desc.format)
+					? VK_RESOLVE_MODE_SAMPLE_ZERO_BIT : VK_RESOLVE_MODE_AVERAGE_BIT;
+				attachment.resolveImageView = m_resources[output.resolve].imageView;
+				attachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			}
+			colorAttachments.push_back(attachment);
+		}
+
+		VkRenderingInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = pass.m_extent;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+		renderingInfo.pColorAttachments = colorAttachments.empty() ? nullptr : colorAttachments.data();
+
+		//带模板的深度格式同一个视图同时作为模板附件，与管线的stencilAttachmentFormat对应
+		VkRenderingAttachmentInfoKHR depthAttachment{};
+		if (pass.m_depthOutput.resource != RG_INVALID_RESOURCE)
+		{
+			const auto& output = pass.m_depthOutput;
+			const auto& resource = m_resources[output.resource];
+			depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+			depthAttachment.imageView = resource.imageView;
+			depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
+			depthAttachment.loadOp = output.vkLoadOp;
+			depthAttachment.storeOp = output.vkStoreOp;
+			depthAttachment.clearValue.depthStencil = { output.clearDepth, 0 };
+
+			renderingInfo.pDepthAttachment = &depthAttachment;
+			if (resource.aspect & VK_IMAGE_ASPECT_STENCIL_BIT)
+			{
+				renderingInfo.pStencilAttachment = &depthAttachment;
+			}
+		}
+
+		commandBuffer->beginRendering(renderingInfo);
+		if (pass.m_execute)
+		{
+			pass.m_execute(commandBuffer);
+		}
+		commandBuffer->endRendering();
+	}
+
+	void RenderGraph::setDynamicRendering(bool enable)
+	{
+		if (enable && !vkContext.vk_dynamicRenderingSupported)
+		{
+			LOG_W("Dynamic rendering is not supported, render graph keeps using renderpasses.");
+			enable = false;
+		}
+
+		if (enable != m_dynamicRendering)
+		{
+			m_dynamicRendering = enable;
+			m_compiled = false;
+		}
+	}
+
+	VkImageView RenderGraph::getImageView(RGResource resource) const
+	{
+		if (resource >= m_resources.size())
+		{
+			return VK_NULL_HANDLE;
+		}
+
+		return m_resources[resource].imageView;
+	}
+
+	void RenderGraph::releasePhysical(bool immediately)
+	{
+		//framebuffer引用了临时纹理的视图，需要一起释放
+		std::vector<VkImageView> views;
+		for (const auto& image : m_physicalImages)
+		{
+			views.push_back(image->getImageView());
+		}
+		m_framebufferCache->evictViews(views);
+
+		if (immediately)
+		{
+			m_physicalImages.clear();
+			for (auto& block : m_blocks)
+			{
+				vkFreeMemory(m_device, block.memory, nullptr);
+			}
+		}
+		else if (!m_physicalImages.empty() || !m_blocks.empty())
+		{
+			Retired retired{};
+			retired.images = std::move(m_physicalImages);
+			for (auto& block : m_blocks)
+			{
+				retired.memories.push_back(block.memory);
+			}
+			retired.framesLeft = m_framesInFlight + 1;
+			m_retired.push_back(std::move(retired));
+		}
+
+		m_physicalImages.clear();
+		m_physicalBlocks.clear();
+		m_blocks.clear();
+		m_physicalKey = 0;
+	}
+
+	void RenderGraph::destroyRetired(Retired& retired)
+	{
+		//先销毁图像再释放它绑定的内存
+		retired.images.clear();
+		for (auto memory : retired.memories)
+		{
+			vkFreeMemory(m_device, memory, nullptr);
+		}
+		retired.memories.clear();
+	}
+
+	RenderGraph::UsageInfo RenderGraph::getUsageInfo(RenderGraphPass::Usage usage)
+	{
+		switch (usage)
+		{
+		case RenderGraphPass::Usage::ColorAttachment:
+		case RenderGraphPass::Usage::ResolveAttachment:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					 VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+		case RenderGraphPass::Usage::DepthAttachment:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+					 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+		case RenderGraphPass::Usage::Sampled:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					 VK_ACCESS_SHADER_READ_BIT };
+		case RenderGraphPass::Usage::TransferSrc:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					 VK_ACCESS_TRANSFER_READ_BIT };
+		default:
+			return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					 VK_ACCESS_TRANSFER_WRITE_BIT };
+		}
+	}
+
+	VkImageUsageFlags RenderGraph::getImageUsage(RenderGraphPass::Usage usage)
+	{
+		switch (usage)
+		{
+		case RenderGraphPass::Usage::ColorAttachment:
+		case RenderGraphPass::Usage::ResolveAttachment:
+			return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case RenderGraphPass::Usage::DepthAttachment:
+			return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case RenderGraphPass::Usage::Sampled:
+			return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case RenderGraphPass::Usage::TransferSrc:
+			return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		default:
+			return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		}
+	}
+
+} // ToyEngine
@@ -23,14 +23,21 @@ namespace ToyEngine
 		m_inputAttachmentReferences.push_back(ref);
 	}
 
+	void Subpass::addResolveAttachmentReference(VkAttachmentReference& ref)
+	{
+		m_resolveAttachmentReferences.push_back(ref);
+	}
+
 	void Subpass::setDepthStencilAttachmentReference(VkAttachmentReference& ref)
 	{
 		m_depthStencilAttachmentReference = ref;
+		m_hasDepthStencil = true;
 	}
 
 	void Subpass::buildSubpassDescription()
 	{
-		if (m_colorAttachmentReferences.empty())
+		//只有深度的子流程(例如阴影)可以没有颜色附件
+		if (m_colorAttachmentReferences.empty() && !m_hasDepthStencil)
 		{
 			LOG_E("Color attachment reference is empty.");
 			throw std::runtime_error("Color attachment reference is empty.");
@@ -38,7 +45,8 @@ namespace ToyEngine
 
 		m_subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 		m_subpassDescription.colorAttachmentCount = static_cast<uint32_t>(m_colorAttachmentReferences.size());
-		m_subpassDescription.pColorAttachments = m_colorAttachmentReferences.data();
+		m_subpassDescription.pColorAttachments =
+			m_colorAttachmentReferences.empty() ? nullptr : m_colorAttachmentReferences.data();
 		m_subpassDescription.inputAttachmentCount = static_cast<uint32_t>(m_inputAttachmentReferences.size());
 
 		if (m_inputAttachmentReferences.empty())
@@ -50,13 +58,28 @@ namespace ToyEngine
 			m_subpassDescription.pInputAttachments = m_inputAttachmentReferences.data();
 		}
 
-		//m_subpassDescription.pDepthStencilAttachment = &m_depthStencilAttachmentReference;
-		m_subpassDescription.pDepthStencilAttachment = nullptr;
+		if (!m_resolveAttachmentReferences.empty()
+			&& m_resolveAttachmentReferences.size() != m_colorAttachmentReferences.size())
+		{
+			LOG_E("Resolve attachment references do not match color attachment references.");
+			throw std::runtime_error("Resolve attachment references do not match color attachment references.");
+		}
+		m_subpassDescription.pResolveAttachments =
+			m_resolveAttachmentReferences.empty() ? nullptr : m_resolveAttachmentReferences.data();
+
+		m_subpassDescription.pDepthStencilAttachment = m_hasDepthStencil ? &m_depthStencilAttachmentReference : nullptr;
 	}
 
 	VkSubpassDescription Subpass::getSubpassDescription() const
 	{
-		return m_subpassDescription;
+		//Subpass按值拷贝进Renderpass，指针要指向自己的数组而不是被拷贝的那个对象
+		VkSubpassDescription description = m_subpassDescription;
+		description.pColorAttachments = m_colorAttachmentReferences.empty() ? nullptr : m_colorAttachmentReferences.data();
+		description.pInputAttachments = m_inputAttachmentReferences.empty() ? nullptr : m_inputAttachmentReferences.data();
+		description.pResolveAttachments =
+			m_resolveAttachmentReferences.empty() ? nullptr : m_resolveAttachmentReferences.data();
+		description.pDepthStencilAttachment = m_hasDepthStencil ? &m_depthStencilAttachmentReference : nullptr;
+		return description;
 	}
 
 	RenderpassPtr Renderpass::create(VkDevice const& device)
@@ -94,9 +117,10 @@ namespace ToyEngine
 
 	void Renderpass::buildRenderpass()
 	{
-		if (m_subpasses.empty() || m_attachmentDescriptions.empty() || m_dependencies.empty())
+		//依赖可以为空：由RenderGraph在renderpass之外用barrier同步
+		if (m_subpasses.empty() || m_attachmentDescriptions.empty())
 		{
-			LOG_E("Subpass, attachment descriptions or dependencies is empty.");
+			LOG_E("Subpass or attachment descriptions is empty.");
 			throw std::runtime_error("Not enough element to build renderpass.");
 		}
 
@@ -112,7 +136,7 @@ namespace ToyEngine
 		renderPassInfo.attachmentCount = static_cast<uint32_t>(m_attachmentDescriptions.size());
 		renderPassInfo.pAttachments = m_attachmentDescriptions.data();
 		renderPassInfo.dependencyCount = static_cast<uint32_t>(m_dependencies.size());
-		renderPassInfo.pDependencies = m_dependencies.data();
+		renderPassInfo.pDependencies = m_dependencies.empty() ? nullptr : m_dependencies.data();
 		renderPassInfo.subpassCount = static_cast<uint32_t>(subpassDescriptions.size());
 		renderPassInfo.pSubpasses = subpassDescriptions.data();
 
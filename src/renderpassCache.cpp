@@ -0,0 +1,121 @@
+#include "renderpassCache.h"
+#include "logger.h"
+#include "tool.h"
+
+namespace ToyEngine
+{
+	RenderpassCachePtr RenderpassCache::create(const VkDevice& device)
+	{
+		return std::make_shared<RenderpassCache>(device);
+	}
+
+	RenderpassCache::RenderpassCache(const VkDevice& device)
+	{
+		m_device = device;
+	}
+
+	RenderpassPtr RenderpassCache::get(const RenderpassDesc& desc)
+	{
+		if (desc.colorAttachments.empty() && !desc.depthAttachment)
+		{
+			throw std::runtime_error("Renderpass needs at least one attachment.");
+		}
+
+		if (!desc.resolveAttachments.empty() && desc.resolveAttachments.size() != desc.colorAttachments.size())
+		{
+			throw std::runtime_error("Renderpass resolve attachments do not match color attachments.");
+		}
+
+		auto key = makeKey(desc);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_renderpasses.find(key);
+		if (it != m_renderpasses.end())
+		{
+			return it->second;
+		}
+
+		auto renderpass = Renderpass::create(m_device);
+		Subpass subpass{};
+		for (uint32_t i = 0; i < desc.colorAttachments.size(); i++)
+		{
+			renderpass->addAttachmentDescription(desc.colorAttachments[i]);
+
+			VkAttachmentReference attachmentRef{};
+			attachmentRef.attachment = i;
+			attachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			subpass.addColorAttachmentReference(attachmentRef);
+		}
+		uint32_t attachmentCount = static_cast<uint32_t>(desc.colorAttachments.size());
+		for (const auto& resolve : desc.resolveAttachments)
+		{
+			VkAttachmentReference resolveRef{};
+			resolveRef.attachment = VK_ATTACHMENT_UNUSED;
+			resolveRef.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			if (resolve.format != VK_FORMAT_UNDEFINED)
+			{
+				renderpass->addAttachmentDescription(resolve);
+				resolveRef.attachment = attachmentCount++;
+				resolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			}
+			subpass.addResolveAttachmentReference(resolveRef);
+		}
+
+		if (desc.depthAttachment)
+		{
+			renderpass->addAttachmentDescription(*desc.depthAttachment);
+
+			VkAttachmentReference depthRef{};
+			depthRef.attachment = attachmentCount;
+			depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			subpass.setDepthStencilAttachmentReference(depthRef);
+		}
+		subpass.buildSubpassDescription();
+		renderpass->addSubpass(subpass);
+		renderpass->buildRenderpass();
+
+		m_renderpasses.emplace(key, renderpass);
+		return renderpass;
+	}
+
+	RenderpassCache::RenderpassKey RenderpassCache::makeKey(const RenderpassDesc& desc)
+	{
+		RenderpassKey key{};
+		key.values.reserve((desc.colorAttachments.size() + desc.resolveAttachments.size() + 1) * 9 + 3);
+		key.values.push_back(static_cast<uint32_t>(desc.colorAttachments.size()));
+		key.values.push_back(static_cast<uint32_t>(desc.resolveAttachments.size()));
+		key.values.push_back(desc.depthAttachment ? 1 : 0);
+
+		std::vector<VkAttachmentDescription> attachments = desc.colorAttachments;
+		attachments.insert(attachments.end(), desc.resolveAttachments.begin(), desc.resolveAttachments.end());
+		if (desc.depthAttachment)
+		{
+			attachments.push_back(*desc.depthAttachment);
+		}
+
+		for (const auto& attachment : attachments)
+		{
+			key.values.push_back(attachment.flags);
+			key.values.push_back(attachment.format);
+			key.values.push_back(attachment.samples);
+			key.values.push_back(attachment.loadOp);
+			key.values.push_back(attachment.storeOp);
+			key.values.push_back(attachment.stencilLoadOp);
+			key.values.push_back(attachment.stencilStoreOp);
+			key.values.push_back(attachment.initialLayout);
+			key.values.push_back(attachment.finalLayout);
+		}
+		return key;
+	}
+
+	size_t RenderpassCache::RenderpassKeyHash::operator()(const RenderpassKey& key) const
+	{
+		uint64_t hash = 0;
+		for (uint32_t value : key.values)
+		{
+			hashCombine(hash, value);
+		}
+
+		return static_cast<size_t>(hash);
+	}
+} // ToyEngine
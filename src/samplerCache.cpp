@@ -0,0 +1,118 @@
+#include "samplerCache.h"
+#include "logger.h"
+#include "tool.h"
+
+namespace ToyEngine
+{
+	SamplerCachePtr SamplerCache::create(const VkDevice& device)
+	{
+		return std::make_shared<SamplerCache>(device);
+	}
+
+	SamplerCache::SamplerCache(const VkDevice& device)
+	{
+		m_device = device;
+	}
+
+	SamplerCache::~SamplerCache()
+	{
+		for (auto& [key, sampler] : m_samplers)
+		{
+			vkDestroySampler(m_device, sampler, nullptr);
+		}
+		m_samplers.clear();
+	}
+
+	VkSampler SamplerCache::get(const VkSamplerCreateInfo& createInfo)
+	{
+		if (createInfo.pNext != nullptr)
+		{
+			LOG_W("SamplerCache ignores the pNext chain of VkSamplerCreateInfo.");
+		}
+
+		auto key = makeKey(createInfo);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_samplers.find(key);
+		if (it != m_samplers.end())
+		{
+			return it->second;
+		}
+
+		VkSampler sampler{ VK_NULL_HANDLE };
+		if (vkCreateSampler(m_device, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create sampler.");
+		}
+
+		m_samplers.emplace(key, sampler);
+		return sampler;
+	}
+
+	VkSampler SamplerCache::get(VkFilter filter, VkSamplerAddressMode addressMode, float maxLod)
+	{
+		return get(makeCreateInfo(filter, addressMode, maxLod));
+	}
+
+	VkSamplerCreateInfo SamplerCache::makeCreateInfo(VkFilter filter, VkSamplerAddressMode addressMode, float maxLod)
+	{
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = filter;
+		samplerInfo.minFilter = filter;
+		samplerInfo.mipmapMode = filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = addressMode;
+		samplerInfo.addressModeV = addressMode;
+		samplerInfo.addressModeW = addressMode;
+		samplerInfo.mipLodBias = 0.0f;
+		samplerInfo.anisotropyEnable = VK_FALSE;
+		samplerInfo.maxAnisotropy = 1.0f;
+		samplerInfo.compareEnable = VK_FALSE;
+		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = maxLod;
+		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+		samplerInfo.unnormalizedCoordinates = VK_FALSE;
+		return samplerInfo;
+	}
+
+	SamplerCache::SamplerKey SamplerCache::makeKey(const VkSamplerCreateInfo& createInfo)
+	{
+		auto floatBits = [](float value)
+		{
+		  uint32_t bits;
+		  std::memcpy(&bits, &value, sizeof(bits));
+		  return bits;
+		};
+
+		SamplerKey key{};
+		key.values[0] = createInfo.flags;
+		key.values[1] = createInfo.magFilter;
+		key.values[2] = createInfo.minFilter;
+		key.values[3] = createInfo.mipmapMode;
+		key.values[4] = createInfo.addressModeU;
+		key.values[5] = createInfo.addressModeV;
+		key.values[6] = createInfo.addressModeW;
+		key.values[7] = floatBits(createInfo.mipLodBias);
+		key.values[8] = createInfo.anisotropyEnable;
+		key.values[9] = createInfo.anisotropyEnable ? floatBits(createInfo.maxAnisotropy) : 0;
+		key.values[10] = createInfo.compareEnable;
+		key.values[11] = createInfo.compareEnable ? createInfo.compareOp : 0;
+		key.values[12] = floatBits(createInfo.minLod);
+		key.values[13] = floatBits(createInfo.maxLod);
+		key.values[14] = createInfo.borderColor;
+		key.values[15] = createInfo.unnormalizedCoordinates;
+		return key;
+	}
+
+	size_t SamplerCache::SamplerKeyHash::operator()(const SamplerKey& key) const
+	{
+		uint64_t hash = 0;
+		for (uint32_t value : key.values)
+		{
+			hashCombine(hash, value);
+		}
+
+		return static_cast<size_t>(hash);
+	}
+} // ToyEngine
@@ -0,0 +1,316 @@
+#include "spriteBatch.h"
+#include "tool.h"
+#include "logger.h"
+
+namespace ToyEngine
+{
+	SpriteBatch::SpriteBatch(size_t reserveCount)
+	{
+		reserve(reserveCount);
+	}
+
+	void SpriteBatch::reserve(size_t count)
+	{
+		m_positions.reserve(count);
+		m_sizes.reserve(count);
+		m_rotations.reserve(count);
+		m_uvRects.reserve(count);
+		m_colors.reserve(count);
+		m_textures.reserve(count);
+		m_layers.reserve(count);
+		m_pipelines.reserve(count);
+		m_depths.reserve(count);
+		m_sortItems.reserve(count);
+		m_sortScratch.reserve(count);
+	}
+
+	void SpriteBatch::clear()
+	{
+		//clear不释放容量，每帧重新填充不会再分配内存
+		m_positions.clear();
+		m_sizes.clear();
+		m_rotations.clear();
+		m_uvRects.clear();
+		m_colors.clear();
+		m_textures.clear();
+		m_layers.clear();
+		m_pipelines.clear();
+		m_depths.clear();
+		m_batches.clear();
+	}
+
+	uint32_t SpriteBatch::add(const glm::vec2& position,
+		const glm::vec2& size,
+		float rotation,
+		uint32_t color,
+		uint32_t textureIndex,
+		const glm::vec4& uvRect,
+		uint32_t layer,
+		uint16_t pipelineId,
+		float depth)
+	{
+		auto index = static_cast<uint32_t>(m_positions.size());
+		m_positions.push_back(position);
+		m_sizes.push_back(size);
+		m_rotations.push_back(rotation);
+		m_uvRects.push_back(uvRect);
+		m_colors.push_back(color);
+		m_textures.push_back(textureIndex);
+		m_layers.push_back(layer);
+		m_pipelines.push_back(pipelineId);
+		m_depths.push_back(depth);
+		return index;
+	}
+
+	uint32_t SpriteBatch::add(const glm::vec2& position,
+		const glm::vec2& size,
+		float rotation,
+		uint32_t color,
+		const AtlasRegion& region,
+		uint16_t pipelineId,
+		float depth)
+	{
+		return add(position, size, rotation, color, region.textureIndex, region.uvRect, region.layer, pipelineId,
+			depth);
+	}
+
+	size_t SpriteBatch::build(SpriteInstance* dst, size_t capacity, const std::vector<uint8_t>& transparentPipelines)
+	{
+		m_batches.clear();
+
+		size_t count = m_positions.size();
+		if (count > capacity)
+		{
+			LOG_EVERY_MS(W, 1000, "Sprite batch overflow: {} sprites, capacity {}.", count, capacity);
+			count = capacity;
+		}
+
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		//排序key，最高位区分不透明(0)和半透明(1)，低32位为texture(20位) | layer(12位)
+		//不透明：pipeline(15位) | 深度(16位，从前到后)
+		//半透明：深度(16位，从后到前) | pipeline(15位)
+		m_sortItems.resize(count);
+		m_sortScratch.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			uint16_t pipelineId = m_pipelines[i];
+			bool transparent = pipelineId < transparentPipelines.size() && transparentPipelines[pipelineId] != 0;
+			auto depth = static_cast<uint64_t>(glm::clamp(m_depths[i], 0.0f, 1.0f) * 65535.0f + 0.5f);
+			uint64_t pipeline = pipelineId & 0x7FFF;
+			uint64_t material = (static_cast<uint64_t>(m_textures[i] & 0xFFFFF) << 12) | (m_layers[i] & 0xFFF);
+
+			if (transparent)
+			{
+				m_sortItems[i].key = (1ull << 63) | ((0xFFFF - depth) << 47) | (pipeline << 32) | material;
+			}
+			else
+			{
+				m_sortItems[i].key = (pipeline << 48) | (depth << 32) | material;
+			}
+			m_sortItems[i].index = static_cast<uint32_t>(i);
+		}
+
+		radixSort(m_sortItems.data(), m_sortScratch.data(), count,
+			[](const SortItem& item)
+			{
+			  return item.key;
+			});
+
+		//按排序结果顺序写入，目标内存通常是write-combined，只做顺序写
+		uint32_t currentPipeline = UINT32_MAX;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t src = m_sortItems[i].index;
+
+			SpriteInstance& instance = dst[i];
+			instance.position = m_positions[src];
+			instance.size = m_sizes[src];
+			instance.uvRect = m_uvRects[src];
+			instance.rotation = m_rotations[src];
+			instance.color = m_colors[src];
+			instance.textureIndex = m_textures[src];
+			instance.layer = m_layers[src];
+			instance.depth = m_depths[src];
+
+			uint32_t pipelineId = m_pipelines[src];
+			if (pipelineId != currentPipeline)
+			{
+				m_batches.push_back({ pipelineId, static_cast<uint32_t>(i), 0 });
+				currentPipeline = pipelineId;
+			}
+			m_batches.back().instanceCount++;
+		}
+
+		return count;
+	}
+
+	SpriteRendererPtr SpriteRenderer::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		uint32_t framesInFlight,
+		uint32_t maxSprites,
+		const QuadIndexBufferPtr& quadIndexBuffer)
+	{
+		return std::make_shared<SpriteRenderer>(device, physicalDevice, bindlessHeap, framesInFlight, maxSprites,
+			quadIndexBuffer);
+	}
+
+	SpriteRenderer::SpriteRenderer(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		uint32_t framesInFlight,
+		uint32_t maxSprites,
+		const QuadIndexBufferPtr& quadIndexBuffer)
+	{
+		m_bindlessHeap = bindlessHeap;
+		//没有共用的index buffer时自己建一个只有一个四边形的
+		m_quadIndexBuffer = quadIndexBuffer ? quadIndexBuffer : QuadIndexBuffer::create(device, physicalDevice, 1);
+		m_maxSprites = maxSprites;
+		m_pushConstants.viewProjection = glm::mat4(1.0f);
+
+		//每个飞行帧独立一块，CPU写当前帧时GPU可能还在读上一帧
+		m_instanceBuffers.resize(framesInFlight);
+		for (auto& buffer : m_instanceBuffers)
+		{
+			buffer = Buffer::create(device, physicalDevice,
+				static_cast<VkDeviceSize>(maxSprites) * sizeof(SpriteInstance),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			buffer->map();
+		}
+	}
+
+	SpriteRenderer::~SpriteRenderer()
+	{
+		m_pipelines.clear();
+		m_instanceBuffers.clear();
+		m_quadIndexBuffer.reset();
+		m_bindlessHeap.reset();
+	}
+
+	uint16_t SpriteRenderer::addPipeline(const PipelinePtr& pipeline, bool transparent)
+	{
+		m_pipelines.push_back(pipeline);
+		m_transparentPipelines.push_back(transparent ? 1 : 0);
+		return static_cast<uint16_t>(m_pipelines.size() - 1);
+	}
+
+	void SpriteRenderer::setViewProjection(const glm::mat4& viewProjection)
+	{
+		m_pushConstants.viewProjection = viewProjection;
+	}
+
+	void SpriteRenderer::record(const CommandBufferPtr& commandBuffer, uint32_t frameIndex, SpriteBatch& batch)
+	{
+		const auto& instanceBuffer = m_instanceBuffers[frameIndex % m_instanceBuffers.size()];
+		if (buildInstances(frameIndex, batch) == 0)
+		{
+			return;
+		}
+
+		commandBuffer->bindVertexBuffer(0, instanceBuffer->getBuffer());
+		m_quadIndexBuffer->bind(commandBuffer);
+
+		for (const auto& drawBatch : batch.getBatches())
+		{
+			if (drawBatch.pipelineId >= m_pipelines.size())
+			{
+				LOG_EVERY_MS(E, 1000, "Sprite pipeline {} is not registered.", drawBatch.pipelineId);
+				continue;
+			}
+
+			//set与push constant重复绑定会被CommandBuffer过滤掉
+			const auto& pipeline = m_pipelines[drawBatch.pipelineId];
+			commandBuffer->bindGraphicPipeline(pipeline->getPipeline());
+			commandBuffer->bindDescriptorSet(pipeline->getPipelineLayout(), 0, m_bindlessHeap->getDescriptorSet());
+			commandBuffer->pushConstants(pipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, m_pushConstants);
+			commandBuffer->drawIndexed(QuadIndexBuffer::INDICES_PER_QUAD, drawBatch.instanceCount, 0, 0,
+				drawBatch.firstInstance);
+		}
+	}
+
+	void SpriteRenderer::submit(DrawStream& drawStream, uint32_t frameIndex, SpriteBatch& batch, uint32_t pass)
+	{
+		const auto& instanceBuffer = m_instanceBuffers[frameIndex % m_instanceBuffers.size()];
+		if (buildInstances(frameIndex, batch) == 0)
+		{
+			return;
+		}
+
+		const auto& batches = batch.getBatches();
+		const auto batchCount = static_cast<float>(batches.size());
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			const auto& drawBatch = batches[i];
+			if (drawBatch.pipelineId >= m_pipelines.size())
+			{
+				LOG_EVERY_MS(E, 1000, "Sprite pipeline {} is not registered.", drawBatch.pipelineId);
+				continue;
+			}
+
+			const auto& pipeline = m_pipelines[drawBatch.pipelineId];
+			DrawCommand command{};
+			command.pipeline = pipeline->getPipeline();
+			command.layout = pipeline->getPipelineLayout();
+			command.descriptorSet = m_bindlessHeap->getDescriptorSet();
+			command.vertexBuffer = instanceBuffer->getBuffer();
+			command.indexBuffer = m_quadIndexBuffer->getBuffer();
+			command.indexType = m_quadIndexBuffer->getIndexType();
+			command.pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT;
+			command.vertexCount = QuadIndexBuffer::INDICES_PER_QUAD;
+			command.instanceCount = drawBatch.instanceCount;
+			command.firstInstance = drawBatch.firstInstance;
+
+			//批次已经按SpriteBatch的规则排好，半透明批次用先后顺序作为深度保持从后到前
+			//批次数超过深度精度时key会相同，基数排序是稳定的，仍然保持提交顺序
+			uint64_t key = DrawKey::opaque(pass, drawBatch.pipelineId, 0, 0.0f, 0);
+			if (m_transparentPipelines[drawBatch.pipelineId] != 0)
+			{
+				float depth = 1.0f - static_cast<float>(i) / batchCount;
+				key = DrawKey::transparent(pass, drawBatch.pipelineId, 0, depth, 0);
+			}
+			drawStream.submit(key, command, m_pushConstants);
+		}
+	}
+
+	size_t SpriteRenderer::buildInstances(uint32_t frameIndex, SpriteBatch& batch)
+	{
+		const auto& instanceBuffer = m_instanceBuffers[frameIndex % m_instanceBuffers.size()];
+		auto* instances = static_cast<SpriteInstance*>(instanceBuffer->getMappedData());
+		size_t count = batch.build(instances, m_maxSprites, m_transparentPipelines);
+		m_lastUploadBytes = count * sizeof(SpriteInstance);
+		return count;
+	}
+
+	std::vector<VkVertexInputBindingDescription> SpriteRenderer::getBindingDescription()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+		bindingDescriptions.resize(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(SpriteInstance);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> SpriteRenderer::getAttributeDescription()
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+		attributeDescriptions.resize(8);
+
+		attributeDescriptions[0] = { 0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(SpriteInstance, position) };
+		attributeDescriptions[1] = { 1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(SpriteInstance, size) };
+		attributeDescriptions[2] = { 2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(SpriteInstance, uvRect) };
+		attributeDescriptions[3] = { 3, 0, VK_FORMAT_R32_SFLOAT, offsetof(SpriteInstance, rotation) };
+		attributeDescriptions[4] = { 4, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(SpriteInstance, color) };
+		attributeDescriptions[5] = { 5, 0, VK_FORMAT_R32_UINT, offsetof(SpriteInstance, textureIndex) };
+		attributeDescriptions[6] = { 6, 0, VK_FORMAT_R32_UINT, offsetof(SpriteInstance, layer) };
+		attributeDescriptions[7] = { 7, 0, VK_FORMAT_R32_SFLOAT, offsetof(SpriteInstance, depth) };
+
+		return attributeDescriptions;
+	}
+} // ToyEngine
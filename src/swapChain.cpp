@@ -96,11 +96,6 @@ namespace ToyEngine
 			vkDestroyImageView(vkContext.vk_device, imageView, nullptr);
 		}
 
-		for (auto framebuffer : m_framebuffers)
-		{
-			vkDestroyFramebuffer(vkContext.vk_device, framebuffer, nullptr);
-		}
-
 		if (m_swapChain != VK_NULL_HANDLE)
 		{
 			vkDestroySwapchainKHR(vkContext.vk_device, m_swapChain, nullptr);
@@ -242,28 +237,4 @@ namespace ToyEngine
 
 		return imageView;
 	}
-
-	void SwapChain::createFramebuffers(const RenderpassPtr& renderPass)
-	{
-		m_framebuffers.resize(m_imageCount);
-		for (size_t i = 0; i < m_imageCount; i++)
-		{
-			//framebuffer 保存了一帧的数据，n个colorAttachment，1个depthAttachment/stencilAttachment
-			VkImageView attachments[] = { m_imageViews[i] };
-
-			VkFramebufferCreateInfo framebufferInfo{};
-			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass->getRenderPass();
-			framebufferInfo.attachmentCount = static_cast<uint32_t>(std::size(attachments));
-			framebufferInfo.pAttachments = attachments;
-			framebufferInfo.width = m_extent.width;
-			framebufferInfo.height = m_extent.height;
-			framebufferInfo.layers = 1;
-
-			if (vkCreateFramebuffer(vkContext.vk_device, &framebufferInfo, nullptr, &m_framebuffers[i]) != VK_SUCCESS)
-			{
-				throw std::runtime_error("Failed to create framebuffer.");
-			}
-		}
-	}
 } // ToyEngine
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "textureAtlas.h"
+#include "commandpool.h"
+#include "logger.h"
+
+namespace ToyEngine
+{
+	static constexpr uint32_t ATLAS_TEXEL_SIZE = 4;
+
+	TextureAtlasPtr TextureAtlas::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		const SamplerCachePtr& samplerCache,
+		uint32_t framesInFlight,
+		uint32_t pageSize,
+		uint32_t maxPages)
+	{
+		return std::make_shared<TextureAtlas>(device, physicalDevice, bindlessHeap, samplerCache, framesInFlight, pageSize, maxPages);
+	}
+
+	TextureAtlas::TextureAtlas(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		const SamplerCachePtr& samplerCache,
+		uint32_t framesInFlight,
+		uint32_t pageSize,
+		uint32_t maxPages)
+	{
+		m_device = device;
+		m_physicalDevice = physicalDevice;
+		m_bindlessHeap = bindlessHeap;
+		m_pageSize = pageSize;
+		m_maxPages = std::min(maxPages, vkContext.vk_physicalDeviceProperties.limits.maxImageArrayLayers);
+		m_stagingBuffers.resize(std::max(framesInFlight, 1u));
+
+		ImageDesc desc{};
+		desc.width = m_pageSize;
+		desc.height = m_pageSize;
+		desc.arrayLayers = m_maxPages;
+		desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+		m_image = Image::create(m_device, m_physicalDevice, desc);
+
+		//bindless表中的描述符声明为SHADER_READ_ONLY，注册前图像必须已经处于这个布局
+		clearImage();
+
+		//图集不生成mip，线性过滤 + clamp
+		m_sampler = samplerCache->get(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, 0.0f);
+		m_textureIndex = m_bindlessHeap->registerTexture(m_image->getImageView(), m_sampler);
+	}
+
+	TextureAtlas::~TextureAtlas()
+	{
+		m_stagingBuffers.clear();
+
+		if (m_textureIndex != BindlessHeap::INVALID_INDEX)
+		{
+			m_bindlessHeap->releaseTexture(m_textureIndex);
+		}
+
+		m_image.reset();
+		m_bindlessHeap.reset();
+	}
+
+	std::optional<AtlasRegion> TextureAtlas::insert(const AtlasImage& image)
+	{
+		if (image.width > m_pageSize || image.height > m_pageSize)
+		{
+			LOG_W("Image {}x{} is larger than the atlas page {}.", image.width, image.height, m_pageSize);
+			return std::nullopt;
+		}
+
+		//先尝试已有页，都放不下时再开新页
+		for (uint32_t layer = 0; layer < m_pages.size(); layer++)
+		{
+			if (auto rect = m_pages[layer].insert(image.width, image.height))
+			{
+				queueUpload(layer, *rect, image.pixels);
+				return makeRegion(layer, *rect);
+			}
+		}
+
+		if (m_pages.size() >= m_maxPages)
+		{
+			return std::nullopt;
+		}
+
+		m_pages.emplace_back(m_pageSize, m_pageSize);
+		auto layer = static_cast<uint32_t>(m_pages.size() - 1);
+		auto rect = m_pages.back().insert(image.width, image.height);
+		if (!rect)
+		{
+			return std::nullopt;
+		}
+
+		queueUpload(layer, *rect, image.pixels);
+		return makeRegion(layer, *rect);
+	}
+
+	std::vector<std::optional<AtlasRegion>> TextureAtlas::insertBatch(const std::vector<AtlasImage>& images)
+	{
+		std::vector<size_t> order(images.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = i;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+		{
+		  return images[a].height > images[b].height;
+		});
+
+		std::vector<std::optional<AtlasRegion>> regions(images.size());
+		for (size_t index : order)
+		{
+			regions[index] = insert(images[index]);
+		}
+
+		return regions;
+	}
+
+	void TextureAtlas::updateRegion(const AtlasRegion& region, const void* pixels)
+	{
+		queueUpload(region.layer, region.rect, pixels);
+	}
+
+	float TextureAtlas::getOccupancy() const
+	{
+		if (m_pages.empty())
+		{
+			return 0.0f;
+		}
+
+		float sum = 0.0f;
+		for (const auto& page : m_pages)
+		{
+			sum += page.getOccupancy();
+		}
+
+		return sum / static_cast<float>(m_pages.size());
+	}
+
+	void TextureAtlas::beginFrame(uint32_t frameIndex)
+	{
+		m_currentSlot = frameIndex % static_cast<uint32_t>(m_stagingBuffers.size());
+		m_stagingBuffers[m_currentSlot].clear();
+	}
+
+	void TextureAtlas::recordUploads(const CommandBufferPtr& commandBuffer)
+	{
+		//同一帧内的多次上传都还没有提交，之前的staging不能被覆盖
+		auto staging = recordUploadCommands(commandBuffer);
+		if (staging != nullptr)
+		{
+			m_stagingBuffers[m_currentSlot].push_back(staging);
+		}
+	}
+
+	void TextureAtlas::flushSync()
+	{
+		if (!hasPendingUploads())
+		{
+			return;
+		}
+
+		auto commandPool = CommandPool::create(m_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+		auto commandBuffer = CommandBuffer::create(m_device, commandPool);
+
+		//staging需要保留到提交完成
+		commandBuffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		auto staging = recordUploadCommands(commandBuffer);
+		commandBuffer->end();
+
+		commandBuffer->submitSync(vkContext.vk_graphicsQueue, VK_NULL_HANDLE);
+	}
+
+	void TextureAtlas::clearImage()
+	{
+		auto commandPool = CommandPool::create(m_device, vkContext.vk_graphicsQueueFamilyIndex.value());
+		auto commandBuffer = CommandBuffer::create(m_device, commandPool);
+
+		//清空所有页，之后上传只覆盖子区域，padding和空白处采样结果为透明
+		commandBuffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		auto toTransfer = m_image->transition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+		commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			{ toTransfer });
+
+		VkClearColorValue clearColor{};
+		commandBuffer->clearColorImage(m_image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, clearColor,
+			toTransfer.subresourceRange);
+
+		auto toShader = m_image->transition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+		commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			{ toShader });
+		commandBuffer->end();
+
+		commandBuffer->submitSync(vkContext.vk_graphicsQueue, VK_NULL_HANDLE);
+	}
+
+	void TextureAtlas::queueUpload(uint32_t layer, const AtlasRect& rect, const void* pixels)
+	{
+		if (pixels == nullptr)
+		{
+			return;
+		}
+
+		size_t size = static_cast<size_t>(rect.width) * rect.height * ATLAS_TEXEL_SIZE;
+		size_t offset = m_pendingPixels.size();
+		m_pendingPixels.resize(offset + size);
+		std::memcpy(m_pendingPixels.data() + offset, pixels, size);
+
+		m_pendingUploads.push_back({ layer, rect, offset });
+	}
+
+	BufferPtr TextureAtlas::recordUploadCommands(const CommandBufferPtr& commandBuffer)
+	{
+		if (m_pendingUploads.empty())
+		{
+			return nullptr;
+		}
+
+		auto staging = Buffer::create(m_device, m_physicalDevice, m_pendingPixels.size(),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		staging->updateBufferByMap(m_pendingPixels.data(), m_pendingPixels.size());
+
+		//整张图一次barrier进入TRANSFER_DST，图像在创建时已经清空并处于SHADER_READ_ONLY
+		auto toTransfer = m_image->transition(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			{ toTransfer });
+
+		//所有脏矩形一次拷贝
+		std::vector<VkBufferImageCopy> regions;
+		regions.reserve(m_pendingUploads.size());
+		for (const auto& upload : m_pendingUploads)
+		{
+			VkBufferImageCopy region{};
+			region.bufferOffset = upload.offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = upload.layer;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { static_cast<int32_t>(upload.rect.x), static_cast<int32_t>(upload.rect.y), 0 };
+			region.imageExtent = { upload.rect.width, upload.rect.height, 1 };
+			regions.push_back(region);
+		}
+		commandBuffer->copyBufferToImage(staging->getBuffer(), m_image->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			regions);
+
+		auto toShader = m_image->transition(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+		commandBuffer->pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			{ toShader });
+
+		m_pendingUploads.clear();
+		m_pendingPixels.clear();
+
+		return staging;
+	}
+
+	AtlasRegion TextureAtlas::makeRegion(uint32_t layer, const AtlasRect& rect) const
+	{
+		const auto size = static_cast<float>(m_pageSize);
+
+		AtlasRegion region{};
+		region.textureIndex = m_textureIndex;
+		region.layer = layer;
+		region.rect = rect;
+		region.uvRect = { rect.x / size, rect.y / size, (rect.x + rect.width) / size, (rect.y + rect.height) / size };
+		return region;
+	}
+} // ToyEngine
@@ -0,0 +1,408 @@
+#include "textureDecoder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ToyEngine
+{
+	static uint8_t clampByte(int value)
+	{
+		return static_cast<uint8_t>(std::clamp(value, 0, 255));
+	}
+
+	static uint64_t readBigEndian64(const uint8_t* src)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			value = (value << 8) | src[i];
+		}
+		return value;
+	}
+
+	static uint32_t bits(uint64_t value, int high, int low)
+	{
+		return static_cast<uint32_t>((value >> low) & ((1ull << (high - low + 1)) - 1));
+	}
+
+	//----------------------------------------BC1/BC3----------------------------------------
+
+	static void decodeColor565(uint16_t color, int rgb[3])
+	{
+		int r = (color >> 11) & 0x1F;
+		int g = (color >> 5) & 0x3F;
+		int b = color & 0x1F;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	//block为16个RGBA8像素，按行排列；BC3中的颜色块总是四色模式
+	static void decodeBC1Color(const uint8_t* src, uint8_t* block, bool forceFourColor)
+	{
+		uint16_t c0 = static_cast<uint16_t>(src[0] | (src[1] << 8));
+		uint16_t c1 = static_cast<uint16_t>(src[2] | (src[3] << 8));
+		uint32_t indices = src[4] | (src[5] << 8) | (src[6] << 16) | (static_cast<uint32_t>(src[7]) << 24);
+
+		int palette[4][4];
+		decodeColor565(c0, palette[0]);
+		decodeColor565(c1, palette[1]);
+		palette[0][3] = 255;
+		palette[1][3] = 255;
+
+		if (c0 > c1 || forceFourColor)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			palette[2][3] = 255;
+			palette[3][3] = 255;
+		}
+		else
+		{
+			//三色模式，第四种为透明黑
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			palette[2][3] = 255;
+			palette[3][3] = 0;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			const int* color = palette[(indices >> (2 * i)) & 0x3];
+			for (int c = 0; c < 4; c++)
+			{
+				block[i * 4 + c] = static_cast<uint8_t>(color[c]);
+			}
+		}
+	}
+
+	static void decodeBC3Alpha(const uint8_t* src, uint8_t* block)
+	{
+		int a0 = src[0];
+		int a1 = src[1];
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(src[2 + i]) << (8 * i);
+		}
+
+		int palette[8];
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; i++)
+			{
+				palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+			{
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			block[i * 4 + 3] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 0x7]);
+		}
+	}
+
+	//----------------------------------------ETC2----------------------------------------
+
+	static const int ETC_MODIFIERS[8][2] = {
+		{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+	};
+
+	static const int ETC_DISTANCES[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+	static const int EAC_MODIFIERS[16][8] = {
+		{ -3, -6, -9, -15, 2, 5, 8, 14 },
+		{ -3, -7, -10, -13, 2, 6, 9, 12 },
+		{ -2, -5, -8, -13, 1, 4, 7, 12 },
+		{ -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 },
+		{ -3, -7, -9, -11, 2, 6, 8, 10 },
+		{ -4, -7, -8, -11, 3, 6, 7, 10 },
+		{ -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 },
+		{ -2, -5, -8, -10, 1, 4, 7, 9 },
+		{ -2, -4, -8, -10, 1, 3, 7, 9 },
+		{ -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 },
+		{ -1, -2, -3, -10, 0, 1, 2, 9 },
+		{ -4, -6, -8, -9, 3, 5, 7, 8 },
+		{ -3, -5, -7, -9, 2, 4, 6, 8 },
+	};
+
+	static int extend4(uint32_t value)
+	{
+		return static_cast<int>((value << 4) | value);
+	}
+
+	static int extend5(uint32_t value)
+	{
+		return static_cast<int>((value << 3) | (value >> 2));
+	}
+
+	static int extend6(uint32_t value)
+	{
+		return static_cast<int>((value << 2) | (value >> 4));
+	}
+
+	static int extend7(uint32_t value)
+	{
+		return static_cast<int>((value << 1) | (value >> 6));
+	}
+
+	static int signExtend3(uint32_t value)
+	{
+		return value >= 4 ? static_cast<int>(value) - 8 : static_cast<int>(value);
+	}
+
+	//ETC的像素下标按列排列：i = x * 4 + y，索引的高位在[31:16]，低位在[15:0]
+	static uint32_t etcPixelIndex(uint64_t block, int x, int y)
+	{
+		int i = x * 4 + y;
+		uint32_t msb = (block >> (16 + i)) & 1;
+		uint32_t lsb = (block >> i) & 1;
+		return (msb << 1) | lsb;
+	}
+
+	static void writePixel(uint8_t* block, int x, int y, int r, int g, int b)
+	{
+		uint8_t* pixel = block + (y * 4 + x) * 4;
+		pixel[0] = clampByte(r);
+		pixel[1] = clampByte(g);
+		pixel[2] = clampByte(b);
+		pixel[3] = 255;
+	}
+
+	static void decodeETC2Color(const uint8_t* src, uint8_t* block)
+	{
+		uint64_t value = readBigEndian64(src);
+		bool differential = bits(value, 33, 33) != 0;
+
+		int base[2][3];
+		if (differential)
+		{
+			int r = static_cast<int>(bits(value, 63, 59));
+			int g = static_cast<int>(bits(value, 55, 51));
+			int b = static_cast<int>(bits(value, 47, 43));
+			int r2 = r + signExtend3(bits(value, 58, 56));
+			int g2 = g + signExtend3(bits(value, 50, 48));
+			int b2 = b + signExtend3(bits(value, 42, 40));
+
+			if (r2 < 0 || r2 > 31)
+			{
+				//T模式
+				int c0[3] = { extend4((bits(value, 60, 59) << 2) | bits(value, 57, 56)),
+							  extend4(bits(value, 55, 52)), extend4(bits(value, 51, 48)) };
+				int c1[3] = { extend4(bits(value, 47, 44)), extend4(bits(value, 43, 40)), extend4(bits(value, 39, 36)) };
+				int d = ETC_DISTANCES[(bits(value, 35, 34) << 1) | bits(value, 32, 32)];
+
+				int paint[4][3];
+				for (int c = 0; c < 3; c++)
+				{
+					paint[0][c] = c0[c];
+					paint[1][c] = c1[c] + d;
+					paint[2][c] = c1[c];
+					paint[3][c] = c1[c] - d;
+				}
+
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						const int* color = paint[etcPixelIndex(value, x, y)];
+						writePixel(block, x, y, color[0], color[1], color[2]);
+					}
+				}
+				return;
+			}
+
+			if (g2 < 0 || g2 > 31)
+			{
+				//H模式
+				uint32_t r0 = bits(value, 62, 59);
+				uint32_t g0 = (bits(value, 58, 56) << 1) | bits(value, 52, 52);
+				uint32_t b0 = (bits(value, 51, 51) << 3) | bits(value, 49, 47);
+				uint32_t r1 = bits(value, 46, 43);
+				uint32_t g1 = bits(value, 42, 39);
+				uint32_t b1 = bits(value, 38, 35);
+
+				uint32_t order = ((r0 << 8) | (g0 << 4) | b0) >= ((r1 << 8) | (g1 << 4) | b1) ? 1 : 0;
+				int d = ETC_DISTANCES[(bits(value, 34, 34) << 2) | (bits(value, 32, 32) << 1) | order];
+
+				int c0[3] = { extend4(r0), extend4(g0), extend4(b0) };
+				int c1[3] = { extend4(r1), extend4(g1), extend4(b1) };
+				int paint[4][3];
+				for (int c = 0; c < 3; c++)
+				{
+					paint[0][c] = c0[c] + d;
+					paint[1][c] = c0[c] - d;
+					paint[2][c] = c1[c] + d;
+					paint[3][c] = c1[c] - d;
+				}
+
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						const int* color = paint[etcPixelIndex(value, x, y)];
+						writePixel(block, x, y, color[0], color[1], color[2]);
+					}
+				}
+				return;
+			}
+
+			if (b2 < 0 || b2 > 31)
+			{
+				//平面模式：三个角点颜色线性插值
+				int ro = extend6(bits(value, 62, 57));
+				int go = extend7((bits(value, 56, 56) << 6) | bits(value, 54, 49));
+				int bo = extend6((bits(value, 48, 48) << 5) | (bits(value, 44, 43) << 3) | bits(value, 41, 39));
+				int rh = extend6((bits(value, 38, 34) << 1) | bits(value, 32, 32));
+				int gh = extend7(bits(value, 31, 25));
+				int bh = extend6(bits(value, 24, 19));
+				int rv = extend6(bits(value, 18, 13));
+				int gv = extend7(bits(value, 12, 6));
+				int bv = extend6(bits(value, 5, 0));
+
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						writePixel(block, x, y,
+							(x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2,
+							(x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2,
+							(x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+					}
+				}
+				return;
+			}
+
+			base[0][0] = extend5(r);
+			base[0][1] = extend5(g);
+			base[0][2] = extend5(b);
+			base[1][0] = extend5(r2);
+			base[1][1] = extend5(g2);
+			base[1][2] = extend5(b2);
+		}
+		else
+		{
+			base[0][0] = extend4(bits(value, 63, 60));
+			base[1][0] = extend4(bits(value, 59, 56));
+			base[0][1] = extend4(bits(value, 55, 52));
+			base[1][1] = extend4(bits(value, 51, 48));
+			base[0][2] = extend4(bits(value, 47, 44));
+			base[1][2] = extend4(bits(value, 43, 40));
+		}
+
+		//两个子块各自一张修正表，flip决定左右(2x4)还是上下(4x2)划分
+		const int* tables[2] = { ETC_MODIFIERS[bits(value, 39, 37)], ETC_MODIFIERS[bits(value, 36, 34)] };
+		bool flip = bits(value, 32, 32) != 0;
+
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int sub = flip ? (y >= 2) : (x >= 2);
+				uint32_t index = etcPixelIndex(value, x, y);
+				int modifier = tables[sub][index & 1];
+				if (index & 2)
+				{
+					modifier = -modifier;
+				}
+				writePixel(block, x, y,
+					base[sub][0] + modifier, base[sub][1] + modifier, base[sub][2] + modifier);
+			}
+		}
+	}
+
+	static void decodeEACAlpha(const uint8_t* src, uint8_t* block)
+	{
+		uint64_t value = readBigEndian64(src);
+		int baseCodeword = static_cast<int>(bits(value, 63, 56));
+		int multiplier = static_cast<int>(bits(value, 55, 52));
+		const int* table = EAC_MODIFIERS[bits(value, 51, 48)];
+
+		for (int x = 0; x < 4; x++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				int i = x * 4 + y;
+				uint32_t index = bits(value, 47 - 3 * i, 45 - 3 * i);
+				block[(y * 4 + x) * 4 + 3] = clampByte(baseCodeword + table[index] * multiplier);
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------------
+
+	size_t getBlockSize(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+		case BlockFormat::ETC2_RGB8:
+			return 8;
+		case BlockFormat::BC3:
+		case BlockFormat::ETC2_RGBA8:
+			return 16;
+		}
+
+		return 0;
+	}
+
+	void decodeBlocks(BlockFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst)
+	{
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+		const size_t blockSize = getBlockSize(format);
+
+		uint8_t block[16 * 4];
+		for (uint32_t by = 0; by < blocksY; by++)
+		{
+			for (uint32_t bx = 0; bx < blocksX; bx++)
+			{
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					decodeBC1Color(src, block, false);
+					break;
+				case BlockFormat::BC3:
+					decodeBC1Color(src + 8, block, true);
+					decodeBC3Alpha(src, block);
+					break;
+				case BlockFormat::ETC2_RGB8:
+					decodeETC2Color(src, block);
+					break;
+				case BlockFormat::ETC2_RGBA8:
+					decodeETC2Color(src + 8, block);
+					decodeEACAlpha(src, block);
+					break;
+				}
+				src += blockSize;
+
+				//边缘块只拷贝图像范围内的像素
+				uint32_t columns = std::min(4u, width - bx * 4);
+				uint32_t rows = std::min(4u, height - by * 4);
+				for (uint32_t y = 0; y < rows; y++)
+				{
+					uint8_t* row = dst + ((static_cast<size_t>(by) * 4 + y) * width + bx * 4) * 4;
+					std::memcpy(row, block + y * 16, columns * 4);
+				}
+			}
+		}
+	}
+} // ToyEngine
@@ -0,0 +1,416 @@
+#include "textureStreamer.h"
+#include "logger.h"
+#include "jobSystem.h"
+#include <cmath>
+
+namespace ToyEngine
+{
+	TextureStreamerPtr TextureStreamer::create(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		const SamplerCachePtr& samplerCache,
+		uint32_t framesInFlight,
+		const TextureStreamerConfig& config)
+	{
+		return std::make_shared<TextureStreamer>(device, physicalDevice, bindlessHeap, samplerCache, framesInFlight, config);
+	}
+
+	TextureStreamer::TextureStreamer(const VkDevice& device,
+		VkPhysicalDevice const& physicalDevice,
+		const BindlessHeapPtr& bindlessHeap,
+		const SamplerCachePtr& samplerCache,
+		uint32_t framesInFlight,
+		const TextureStreamerConfig& config)
+	{
+		m_device = device;
+		m_physicalDevice = physicalDevice;
+		m_bindlessHeap = bindlessHeap;
+		m_sampler = samplerCache->get(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+		m_config = config;
+		m_framesInFlight = framesInFlight;
+		m_stagingBuffers.resize(framesInFlight);
+
+		updateBudget();
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		for (auto& texture : m_textures)
+		{
+			if (texture.loading)
+			{
+				JobSystem::getInstance().wait(texture.pending);
+			}
+
+			if (texture.detailIndex != BindlessHeap::INVALID_INDEX)
+			{
+				m_bindlessHeap->releaseTexture(texture.detailIndex);
+			}
+
+			if (texture.tailIndex != BindlessHeap::INVALID_INDEX)
+			{
+				m_bindlessHeap->releaseTexture(texture.tailIndex);
+			}
+		}
+
+		m_textures.clear();
+		m_retired.clear();
+		m_stagingBuffers.clear();
+		m_bindlessHeap.reset();
+	}
+
+	TextureStreamer::LoadResult TextureStreamer::loadLevels(const Ktx2FilePtr& file,
+		uint32_t firstLevel,
+		uint32_t levelCount)
+	{
+		LoadResult result{};
+		result.mipLevel = firstLevel;
+		result.levels.resize(levelCount);
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			if (!readKtx2Level(file, firstLevel + i, result.format, result.levels[i]))
+			{
+				result.levels.clear();
+				break;
+			}
+		}
+
+		return result;
+	}
+
+	std::vector<TextureStreamer::Handle> TextureStreamer::registerTextures(const std::vector<std::string>& basePaths)
+	{
+		//变体选择和tail读取在任务系统中并行
+		struct TailLoad
+		{
+			Ktx2FilePtr file;
+			uint32_t tailLevel;
+			LoadResult result;
+		};
+
+		const uint32_t tailSize = m_config.tailSize;
+		std::vector<TailLoad> loads(basePaths.size());
+		JobSystem::getInstance().parallelFor(0, static_cast<uint32_t>(basePaths.size()), 1,
+			[&basePaths, &loads, tailSize](uint32_t begin, uint32_t end)
+			{
+			  for (uint32_t i = begin; i < end; i++)
+			  {
+				  auto& load = loads[i];
+				  load.file = selectKtx2Variant(basePaths[i]);
+				  if (load.file == nullptr)
+				  {
+					  continue;
+				  }
+
+				  uint32_t levelCount = std::max(load.file->getLevelCount(), 1u);
+				  load.tailLevel = levelCount - 1;
+				  for (uint32_t level = 0; level < levelCount; level++)
+				  {
+					  if (std::max(load.file->getWidth() >> level, load.file->getHeight() >> level) <= tailSize)
+					  {
+						  load.tailLevel = level;
+						  break;
+					  }
+				  }
+
+				  load.result = loadLevels(load.file, load.tailLevel, levelCount - load.tailLevel);
+			  }
+			});
+
+		auto uploader = ImageUploader::create(m_device, m_physicalDevice);
+		std::vector<Handle> handles;
+		handles.reserve(basePaths.size());
+
+		for (auto& load : loads)
+		{
+
+			Handle handle = static_cast<Handle>(m_textures.size());
+			m_textures.emplace_back();
+			handles.push_back(handle);
+
+			auto& texture = m_textures.back();
+			texture.lruPosition = m_lru.insert(m_lru.end(), handle);
+			if (load.file == nullptr || load.result.levels.empty())
+			{
+				continue;
+			}
+
+			texture.file = load.file;
+			texture.width = load.file->getWidth();
+			texture.height = load.file->getHeight();
+			texture.levelCount = std::max(load.file->getLevelCount(), 1u);
+			texture.tailLevel = load.tailLevel;
+			texture.detailLevel = load.tailLevel;
+
+			ImageDesc desc{};
+			desc.width = std::max(texture.width >> texture.tailLevel, 1u);
+			desc.height = std::max(texture.height >> texture.tailLevel, 1u);
+			desc.arrayLayers = load.file->getLayerCount();
+			desc.format = load.result.format;
+			desc.mipLevels = texture.levelCount - texture.tailLevel;
+			texture.tail = Image::create(m_device, m_physicalDevice, desc);
+
+			for (uint32_t i = 0; i < load.result.levels.size(); i++)
+			{
+				const auto& level = load.result.levels[i];
+				uploader->enqueueLevel(texture.tail, i, level.data(), level.size());
+			}
+		}
+
+		uploader->flush();
+
+		for (Handle handle : handles)
+		{
+			auto& texture = m_textures[handle];
+			if (texture.tail != nullptr)
+			{
+				texture.tailIndex = m_bindlessHeap->registerTexture(texture.tail->getImageView(), m_sampler);
+			}
+		}
+
+		return handles;
+	}
+
+	void TextureStreamer::requestScreenSize(Handle handle, const glm::vec2& screenSize)
+	{
+		const auto& texture = m_textures[handle];
+		float ratio = std::max(texture.width / std::max(screenSize.x, 1.0f), texture.height / std::max(screenSize.y, 1.0f));
+		uint32_t mipLevel = ratio <= 1.0f ? 0 : static_cast<uint32_t>(std::floor(std::log2(ratio)));
+		requestMip(handle, mipLevel);
+	}
+
+	void TextureStreamer::requestMip(Handle handle, uint32_t mipLevel)
+	{
+		auto& texture = m_textures[handle];
+		texture.requestedLevel = std::min(texture.requestedLevel, std::min(mipLevel, texture.levelCount - 1));
+		touch(handle);
+	}
+
+	uint32_t TextureStreamer::getTextureIndex(Handle handle) const
+	{
+		const auto& texture = m_textures[handle];
+		return texture.detailIndex != BindlessHeap::INVALID_INDEX ? texture.detailIndex : texture.tailIndex;
+	}
+
+	uint32_t TextureStreamer::getResidentMip(Handle handle) const
+	{
+		return m_textures[handle].detailLevel;
+	}
+
+	void TextureStreamer::touch(Handle handle)
+	{
+		auto& texture = m_textures[handle];
+		texture.lastUsedFrame = m_frame;
+		m_lru.splice(m_lru.begin(), m_lru, texture.lruPosition);
+	}
+
+	void TextureStreamer::update(const CommandBufferPtr& commandBuffer, uint32_t frameIndex)
+	{
+		for (size_t i = 0; i < m_retired.size();)
+		{
+			if (--m_retired[i].framesLeft == 0)
+			{
+				m_retired[i] = std::move(m_retired.back());
+				m_retired.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		if (m_config.budgetQueryInterval != 0 && m_frame % m_config.budgetQueryInterval == 0)
+		{
+			updateBudget();
+		}
+
+		//上一次使用该槽位的帧已经执行完，旧的staging可以释放
+		auto& staging = m_stagingBuffers[frameIndex % m_stagingBuffers.size()];
+		staging = nullptr;
+		m_lastUploadBytes = 0;
+
+		//没有正在进行的读取时不会有新的上传
+		if (m_loadingCount > 0)
+		{
+			auto uploader = ImageUploader::create(m_device, m_physicalDevice);
+			finishLoads(uploader);
+			m_lastUploadBytes = uploader->getPendingBytes();
+			staging = uploader->record(commandBuffer);
+		}
+
+		startLoads();
+
+		for (auto& texture : m_textures)
+		{
+			texture.requestedLevel = UINT32_MAX;
+		}
+		m_frame++;
+	}
+
+	void TextureStreamer::finishLoads(const ImageUploaderPtr& uploader)
+	{
+		for (auto& texture : m_textures)
+		{
+			if (!texture.loading || texture.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				continue;
+			}
+
+			auto result = texture.pending.get();
+			texture.loading = false;
+			m_loadingCount--;
+
+			//读取期间可能已经有了同等或更高的精度
+			if (result.levels.empty() || result.mipLevel >= texture.detailLevel)
+			{
+				continue;
+			}
+
+			ImageDesc desc{};
+			desc.width = std::max(texture.width >> result.mipLevel, 1u);
+			desc.height = std::max(texture.height >> result.mipLevel, 1u);
+			desc.arrayLayers = texture.file->getLayerCount();
+			desc.format = result.format;
+			desc.mipLevels = texture.levelCount - result.mipLevel;
+
+			VkDeviceSize oldBytes = texture.detail != nullptr ? texture.detail->getMemorySize() : 0;
+			VkDeviceSize newBytes = estimateSize(texture, result.mipLevel);
+			if (newBytes > oldBytes && !makeRoom(newBytes - oldBytes))
+			{
+				continue;
+			}
+
+			auto image = Image::create(m_device, m_physicalDevice, desc);
+			for (uint32_t i = 0; i < result.levels.size(); i++)
+			{
+				const auto& level = result.levels[i];
+				uploader->enqueueLevel(image, i, level.data(), level.size());
+			}
+
+			evict(texture);
+			texture.detail = image;
+			texture.detailLevel = result.mipLevel;
+			texture.detailIndex = m_bindlessHeap->registerTexture(image->getImageView(), m_sampler);
+			m_residentBytes += image->getMemorySize();
+		}
+	}
+
+	void TextureStreamer::startLoads()
+	{
+		//缺得越多的纹理越先读取
+		std::vector<Handle> candidates;
+		for (Handle handle = 0; handle < m_textures.size(); handle++)
+		{
+			const auto& texture = m_textures[handle];
+			if (texture.file != nullptr && !texture.loading && texture.requestedLevel < texture.detailLevel)
+			{
+				candidates.push_back(handle);
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [this](Handle a, Handle b)
+		{
+		  const auto& ta = m_textures[a];
+		  const auto& tb = m_textures[b];
+		  return ta.detailLevel - ta.requestedLevel > tb.detailLevel - tb.requestedLevel;
+		});
+
+		for (Handle handle : candidates)
+		{
+			if (m_loadingCount >= m_config.maxConcurrentLoads)
+			{
+				break;
+			}
+
+			auto& texture = m_textures[handle];
+			if (estimateSize(texture, texture.requestedLevel) > m_budget)
+			{
+				continue;
+			}
+
+			uint32_t firstLevel = texture.requestedLevel;
+			auto file = texture.file;
+			uint32_t levelCount = texture.levelCount - firstLevel;
+			texture.pending = JobSystem::getInstance().async([file, firstLevel, levelCount]()
+			{
+			  return loadLevels(file, firstLevel, levelCount);
+			});
+			texture.loading = true;
+			m_loadingCount++;
+		}
+	}
+
+	bool TextureStreamer::makeRoom(VkDeviceSize bytes)
+	{
+		if (bytes > m_budget)
+		{
+			return false;
+		}
+
+		//从LRU尾部开始淘汰，本帧用到的纹理不淘汰
+		auto it = m_lru.end();
+		while (m_residentBytes + bytes > m_budget && it != m_lru.begin())
+		{
+			--it;
+			auto& texture = m_textures[*it];
+			if (texture.lastUsedFrame == m_frame)
+			{
+				return false;
+			}
+
+			if (texture.detail != nullptr)
+			{
+				evict(texture);
+			}
+		}
+
+		return m_residentBytes + bytes <= m_budget;
+	}
+
+	void TextureStreamer::evict(StreamedTexture& texture)
+	{
+		if (texture.detail == nullptr)
+		{
+			return;
+		}
+
+		m_residentBytes -= texture.detail->getMemorySize();
+		m_bindlessHeap->releaseTexture(texture.detailIndex);
+		retire(texture.detail);
+
+		texture.detail = nullptr;
+		texture.detailIndex = BindlessHeap::INVALID_INDEX;
+		texture.detailLevel = texture.tailLevel;
+	}
+
+	void TextureStreamer::retire(const ImagePtr& image)
+	{
+		m_retired.push_back({ image, m_framesInFlight + 1 });
+	}
+
+	void TextureStreamer::updateBudget()
+	{
+		auto memoryBudget = vkContext.queryDeviceLocalBudget();
+
+		//驱动报告的用量包含我们自己的detail，扣掉后才是其他资源占用
+		VkDeviceSize others = memoryBudget.usage > m_residentBytes ? memoryBudget.usage - m_residentBytes : 0;
+		VkDeviceSize available = memoryBudget.budget > others ? memoryBudget.budget - others : 0;
+		m_budget = std::min(m_config.budgetBytes, available);
+	}
+
+	VkDeviceSize TextureStreamer::estimateSize(const StreamedTexture& texture, uint32_t firstLevel) const
+	{
+		VkFormat format = texture.tail != nullptr ? texture.tail->getFormat() : texture.file->getFormat();
+		auto block = getFormatBlockInfo(format);
+
+		VkDeviceSize size = 0;
+		for (uint32_t level = firstLevel; level < texture.levelCount; level++)
+		{
+			VkDeviceSize blocksX = (std::max(texture.width >> level, 1u) + block.blockWidth - 1) / block.blockWidth;
+			VkDeviceSize blocksY = (std::max(texture.height >> level, 1u) + block.blockHeight - 1) / block.blockHeight;
+			size += blocksX * blocksY * block.bytesPerBlock;
+		}
+
+		return size * texture.file->getLayerCount();
+	}
+} // ToyEngine
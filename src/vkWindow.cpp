@@ -35,6 +35,11 @@ namespace ToyEngine
 		glfwPollEvents();
 	}
 
+	bool VkWindow::isKeyPressed(int key) const
+	{
+		return glfwGetKey(m_window, key) == GLFW_PRESS;
+	}
+
 	GLFWwindow* VkWindow::getWindow() const
 	{
 		return m_window;